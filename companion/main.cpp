@@ -27,6 +27,19 @@ char *ResolutionName[RESOLUTION_NUM] = {
   "1080i"
 };
 
+#define UPSCALER_NUM 2
+char *UpscalerName[UPSCALER_NUM] = {
+  "Disabled",
+  "FSR 1.0"
+};
+
+#define FXAA_QUALITY_NUM 3
+char *FxaaQualityName[FXAA_QUALITY_NUM] = {
+  "Low",
+  "Medium",
+  "High"
+};
+
 #define ANTI_ALIASING_NUM 3
 char *AntiAliasingName[ANTI_ALIASING_NUM] = {
   "Disabled",
@@ -75,17 +88,24 @@ typedef struct {
   int battle_fps;
   int debug_menu;
   int swap_confirm;
+  int dyn_res;
+  int upscaler;
+  int fxaa_quality;
 } config_opts;
 config_opts options;
 
 bool bilinear_filter;
 bool debug_menu;
 bool swap_confirm;
+bool dyn_res;
 
 void loadOptions() {
   char buffer[30];
   int value;
     
+  // Options added after a cfg got written keep their default
+  options.fxaa_quality = 1;
+
   FILE *f = fopen(CONFIG_FILE_PATH, "rb");
   if (f) {
     while (EOF != fscanf(f, "%[^=]=%d\n", buffer, &value)) {
@@ -98,6 +118,9 @@ void loadOptions() {
       else if (strcmp("battle_fps", buffer) == 0) options.battle_fps = value;
       else if (strcmp("debug_menu", buffer) == 0) options.debug_menu = value;
       else if (strcmp("swap_confirm", buffer) == 0) options.swap_confirm = value;
+      else if (strcmp("dynamic_resolution", buffer) == 0) options.dyn_res = value;
+      else if (strcmp("upscaler", buffer) == 0) options.upscaler = value;
+      else if (strcmp("fxaa_quality", buffer) == 0) options.fxaa_quality = value;
     }
   } else {
     options.res = 0;
@@ -109,17 +132,22 @@ void loadOptions() {
     options.battle_fps = 0;
     options.debug_menu = 0;
     options.swap_confirm = 0;
+    options.dyn_res = 0;
+    options.upscaler = 0;
   }
+  options.fxaa_quality = options.fxaa_quality < 0 ? 0 : options.fxaa_quality > 2 ? 2 : options.fxaa_quality;
     
   bilinear_filter = options.bilinear ? true : false;
   debug_menu = options.debug_menu ? true : false;
   swap_confirm = options.swap_confirm ? true : false;
+  dyn_res = options.dyn_res ? true : false;
 }
 
 void saveOptions(void) {
   options.bilinear = bilinear_filter ? 1 : 0;
   options.debug_menu = debug_menu ? 1 : 0;
   options.swap_confirm = swap_confirm ? 1 : 0;
+  options.dyn_res = dyn_res ? 1 : 0;
 
   FILE *config = fopen(CONFIG_FILE_PATH, "w+");
 
@@ -133,6 +161,9 @@ void saveOptions(void) {
     fprintf(config, "%s=%d\n", "battle_fps", options.battle_fps);
     fprintf(config, "%s=%d\n", "debug_menu", options.debug_menu);
     fprintf(config, "%s=%d\n", "swap_confirm", options.swap_confirm);
+    fprintf(config, "%s=%d\n", "dynamic_resolution", options.dyn_res);
+    fprintf(config, "%s=%d\n", "upscaler", options.upscaler);
+    fprintf(config, "%s=%d\n", "fxaa_quality", options.fxaa_quality);
     fclose(config);
   }
 }
@@ -146,7 +177,10 @@ char *options_descs[] = {
   "Enables usage of a post processing effect through shaders. May impact performances.\nThe default value is: Disabled.", // postfx
   "Alters the game framerate during battles.\nThe default value is: 15.", // battle_fps
   "When enabled, internal development debug menu is accessible by pressing SELECT + UP/DOWN.\nThe default value is: Disabled.", // debug_menu
-  "When enabled, functionalities of X and O buttons are swapped.\nThe default value is: Disabled." // swap_confirm
+  "When enabled, functionalities of X and O buttons are swapped.\nThe default value is: Disabled.", // swap_confirm
+  "When enabled, the game is rendered at a lower resolution during demanding scenes to keep its framerate steady. Anti-Aliasing is not applied in this mode.\nThe default value is: Disabled.", // dynamic_resolution
+  "Renders the game at 544p and reconstructs the selected resolution with an edge aware upscaler followed by a sharpening pass. Much lighter than native rendering at 720p or 1080i. Anti-Aliasing is not applied in this mode.\nThe default value is: Disabled.", // upscaler
+  "Quality preset of the FXAA PostFX effect. Low is the cheapest and leaves faint edges untouched, High smooths more edges and keeps them sharper at a higher GPU cost.\nThe default value is: Medium." // fxaa_quality
 };
 
 enum {
@@ -158,7 +192,10 @@ enum {
   OPT_POSTFX,
   OPT_BATTLE_FPS,
   OPT_DEBUG_MENU,
-  OPT_CONFIRM_SWAP
+  OPT_CONFIRM_SWAP,
+  OPT_DYN_RES,
+  OPT_UPSCALER,
+  OPT_FXAA_QUALITY
 };
 
 char *desc = nullptr;
@@ -230,7 +267,25 @@ int main(int argc, char *argv[]) {
     }
     SetDescription(OPT_RESOLUTION);
   
+    ImGui::Text("Upscaler:"); ImGui::SameLine();
+    if (ImGui::BeginCombo("##combo5", UpscalerName[options.upscaler])) {
+      for (int n = 0; n < UPSCALER_NUM; n++) {
+        bool is_selected = options.upscaler == n;
+        if (ImGui::Selectable(UpscalerName[n], is_selected))
+          options.upscaler = n;
+        SetDescription(OPT_UPSCALER);
+        if (is_selected)
+          ImGui::SetItemDefaultFocus();
+      }
+      ImGui::EndCombo();
+    }
+    SetDescription(OPT_UPSCALER);
+
     ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(0.0f, 0.0f));
+    ImGui::Text("Dynamic Resolution:"); ImGui::SameLine();
+    ImGui::Checkbox("##check4", &dyn_res);
+    SetDescription(OPT_DYN_RES);
+
     ImGui::Text("Bilinear Filter:"); ImGui::SameLine();
     ImGui::Checkbox("##check0", &bilinear_filter);
     SetDescription(OPT_BILINEAR);
@@ -264,6 +319,20 @@ int main(int argc, char *argv[]) {
     }
     SetDescription(OPT_POSTFX);
 
+    ImGui::Text("FXAA Quality:"); ImGui::SameLine();
+    if (ImGui::BeginCombo("##combo6", FxaaQualityName[options.fxaa_quality])) {
+      for (int n = 0; n < FXAA_QUALITY_NUM; n++) {
+        bool is_selected = options.fxaa_quality == n;
+        if (ImGui::Selectable(FxaaQualityName[n], is_selected))
+          options.fxaa_quality = n;
+        SetDescription(OPT_FXAA_QUALITY);
+        if (is_selected)
+          ImGui::SetItemDefaultFocus();
+      }
+      ImGui::EndCombo();
+    }
+    SetDescription(OPT_FXAA_QUALITY);
+
     ImGui::Separator();
     ImGui::TextColored(ImVec4(255, 255, 0, 255), "Misc");
 
@@ -17,12 +17,22 @@
 
 #include "config.h"
 #include "dialog.h"
+#include "draw_batch.h"
+#include "glyph_atlas.h"
+#include "font_batch.h"
+#include "font_source.h"
+#include "frame_pacer.h"
+#include "gl_state.h"
+#include "glyph_cache.h"
+#include "jni_pool.h"
+#include "obb.h"
+#include "tex_stage.h"
+#include "utf_conv.h"
 
 #include "shaders/movie_f.h"
 #include "shaders/movie_v.h"
 
 #define SAVE_FILENAME "ux0:/data/ff4"
-#define OBB_FILE "ux0:/data/ff4/main.obb"
 #define SAVE_FILE "ux0:data/ff4/save.bin"
 
 #define FB_ALIGNMENT 0x40000
@@ -139,6 +149,7 @@ void movie_player_draw(void) {
         sceGxmTextureSetMagFilter(movie_tex[movie_frame_idx], SCE_GXM_TEXTURE_FILTER_LINEAR);
       }
       if (movie_first_frame_drawn) {
+        draw_batch_flush();
         glUseProgram(movie_prog);
         glBindTexture(GL_TEXTURE_2D, movie_frame[movie_frame_idx]);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -149,6 +160,8 @@ void movie_player_draw(void) {
         glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, &postfx_texcoord[0]);
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
         glUseProgram(0);
+        tex_stage_resync();
+        gl_state_invalidate();
       }
     } else {
       player_state = PLAYER_STOP;
@@ -179,6 +192,7 @@ void movie_player_init() {
     movie_tex[i] = vglGetGxmTexture(GL_TEXTURE_2D);
     vglFree(vglGetTexDataPointer(GL_TEXTURE_2D));
   }
+  tex_stage_resync();
 
   movie_vs = glCreateShader(GL_VERTEX_SHADER);
   glShaderBinary(1, &movie_vs, 0, movie_v, size_movie_v);
@@ -239,186 +253,7 @@ uint8_t getMovieState() {
   return 1;
 }
 
-unsigned char *header = NULL;
-int header_length = 0;
-
-void decodeArray(unsigned char *bArr, int size, uint key) {
-  for (int n = 0; n < size; n++) {
-    key = key * 0x41c64e6d + 0x3039;
-    bArr[n] = bArr[n] ^ (unsigned char)(key >> 0x18);
-  }
-}
-
-static int getInt(unsigned char *bArr, int i) {
-  return *(unsigned int *)(&bArr[i]);
-}
-
-unsigned char *gzipRead(unsigned char *bArr, int *bArr_length) {
-  unsigned int readInt = __builtin_bswap32(getInt(bArr, 0));
-  unsigned char *bArr2 = calloc(readInt, sizeof(unsigned char));
-  unsigned char *bArr3 = &bArr[4];
-
-  z_stream infstream;
-  infstream.zalloc = Z_NULL;
-  infstream.zfree = Z_NULL;
-  infstream.opaque = Z_NULL;
-  // setup "b" as the input and "c" as the compressed output
-  infstream.avail_in = *bArr_length - 4; // size of input
-  infstream.next_in = bArr3;             // input char array
-  infstream.avail_out = readInt;         // size of output
-  infstream.next_out = bArr2;            // output char array
-
-  // the actual DE-compression work.
-  inflateInit2(&infstream, MAX_WBITS | 16);
-  inflate(&infstream, Z_FULL_FLUSH);
-  inflateEnd(&infstream);
-
-  *bArr_length = readInt;
-  return bArr2;
-}
-
-unsigned char *m476a(char *str, int *file_length) {
-  int i;
-
-  unsigned char *bArr = header;
-  if (bArr != NULL) {
-    int a = getInt(bArr, 0);
-    int i2 = 0;
-    i = 0;
-    while (a > i2) {
-      int i3 = (i2 + a) / 2;
-      int i4 = i3 * 12;
-      int a2 = getInt(header, i4 + 4);
-      int i5 = 0;
-      for (int i6 = 0; i6 < strlen(str) && i5 == 0; i6++) {
-        i5 = (header[a2 + i6] & 0xFF) - (str[i6] & 0xFF);
-      }
-      if (i5 == 0) {
-        i5 = header[a2 + strlen(str)] & 0xFF;
-      }
-      if (i5 == 0) {
-        i = i4 + 8;
-        a = i3;
-        i2 = a;
-      } else if (i5 > 0) {
-        a = i3;
-      } else {
-        i2 = i3 + 1;
-      }
-    }
-  } else {
-    i = 0;
-  }
-  if (i == 0) {
-    return NULL;
-  }
-
-  const char *a = OBB_FILE;
-  FILE *fp = fopen(a, "r");
-  int a3 = getInt(header, i);
-  fseek(fp, a3, SEEK_SET);
-
-  *file_length = getInt(header, i + 4);
-  unsigned char *bArr2 = malloc(*file_length);
-
-  for (int i7 = 0; i7 < *file_length;
-       i7 += fread(&bArr2[i7], sizeof(unsigned char), *file_length - i7, fp)) {
-  }
-
-  fclose(fp);
-
-  decodeArray(bArr2, *file_length, a3 + 419430400u);
-
-  unsigned char *a4 = gzipRead(bArr2, file_length);
-
-  free(bArr2);
-
-  return a4;
-}
-
-uint8_t isFileExist(char *str) {
-  int i;
-
-  unsigned char *bArr = header;
-  if (bArr != NULL) {
-    int a = getInt(bArr, 0);
-    int i2 = 0;
-    i = 0;
-    while (a > i2) {
-      int i3 = (i2 + a) / 2;
-      int i4 = i3 * 12;
-      int a2 = getInt(header, i4 + 4);
-      int i5 = 0;
-      for (int i6 = 0; i6 < strlen(str) && i5 == 0; i6++) {
-        i5 = (header[a2 + i6] & 0xFF) - (str[i6] & 0xFF);
-      }
-      if (i5 == 0) {
-        i5 = header[a2 + strlen(str)] & 0xFF;
-      }
-      if (i5 == 0) {
-        i = i4 + 8;
-        a = i3;
-        i2 = a;
-      } else if (i5 > 0) {
-        a = i3;
-      } else {
-        i2 = i3 + 1;
-      }
-    }
-  } else {
-    i = 0;
-  }
-  if (i == 0) {
-    return 0;
-  }
-  
-  return 1;
-}
-
-int readHeader() {
-  const char *a = OBB_FILE;
-  FILE *fp = fopen(a, "r");
-  fseek(fp, 0L, SEEK_END);
-  int length = ftell(fp);
-  fseek(fp, 0L, SEEK_SET);
-
-  unsigned char bArr[16];
-
-  for (int i = 0; i < 16;
-       i += fread(&bArr[i], sizeof(unsigned char), 16 - i, fp)) {
-  }
-
-  decodeArray(bArr, 16, 419430400u);
-
-  if (getInt(bArr, 0) != 826495553) {
-    printf("initFileTable: Header Error\n");
-    return 0;
-  } else if (length != getInt(bArr, 4)) {
-    printf("initFileTable: Size Error\n");
-    return 0;
-  } else {
-    unsigned int a2 = getInt(bArr, 8);
-    header_length = getInt(bArr, 12);
-    header = malloc(header_length);
-
-    fseek(fp, (long)(a2 - 16), SEEK_CUR);
-
-    for (int i = 0; i < header_length;
-         i += fread(&header[i], sizeof(unsigned char), header_length - i, fp)) {
-    }
-
-    decodeArray(header, header_length, a2 + 419430400u);
-
-    unsigned char *header2 = gzipRead(header, &header_length);
-
-    free(header);
-
-    header = header2;
-
-    fclose(fp);
-  }
-  return 1;
-}
+static const char *lang_codes[] = {"ja", "en", "fr", "de", "it", "es", "zh_CN", "zh_TW", "ko", "pt_BR", "ru", "th"};
 
 unsigned char *decodeString(unsigned char *bArr, int *bArr_length) {
   return bArr;
@@ -426,14 +261,13 @@ unsigned char *decodeString(unsigned char *bArr, int *bArr_length) {
 
 jni_bytearray *loadFile(char *str) {
   //printf("loadFile(%s)\n", str);
-  char *lang[] = {"ja", "en", "fr", "de", "it", "es", "zh_CN", "zh_TW", "ko", "pt_BR", "ru", "th"};
 
   char *substring = strrchr(str, 46);
 
   substring = substring == NULL ? str : substring;
   char temp_path[512];
   int file_length;
-  sprintf(temp_path, "%s.lproj/%s", lang[getCurrentLanguage()], str);
+  sprintf(temp_path, "%s.lproj/%s", lang_codes[getCurrentLanguage()], str);
   unsigned char *a = m476a(temp_path, &file_length);
   if (a == NULL) {
     sprintf(temp_path, "files/%s", str);
@@ -443,7 +277,7 @@ jni_bytearray *loadFile(char *str) {
     return NULL;
   }
 
-  jni_bytearray *result = malloc(sizeof(jni_bytearray));
+  jni_bytearray *result = jni_pool_alloc(sizeof(jni_bytearray));
   result->elements = a;
   result->size = file_length;
 
@@ -472,7 +306,7 @@ jni_bytearray *loadRawFile(char *str) {
     return NULL;
   }
 
-  jni_bytearray *result = malloc(sizeof(jni_bytearray));
+  jni_bytearray *result = jni_pool_alloc(sizeof(jni_bytearray));
   result->elements = a;
   result->size = file_length;
 
@@ -513,7 +347,7 @@ jni_bytearray *loadSound(char *str) {
     }
   }
 
-  jni_bytearray *result = malloc(sizeof(jni_bytearray));
+  jni_bytearray *result = jni_pool_alloc(sizeof(jni_bytearray));
   result->elements = a;
   result->size = file_length;
 
@@ -555,8 +389,8 @@ uint8_t isSoundFileExist(char *str) {
 jni_bytearray *getSaveFileName() {
 
   char *buffer = SAVE_FILENAME;
-  jni_bytearray *result = malloc(sizeof(jni_bytearray));
-  result->elements = malloc(strlen(buffer) + 1);
+  jni_bytearray *result = jni_pool_alloc(sizeof(jni_bytearray));
+  result->elements = jni_pool_alloc(strlen(buffer) + 1);
   // Sets the value
   strcpy((char *)result->elements, buffer);
   result->size = strlen(buffer) + 1;
@@ -567,8 +401,8 @@ jni_bytearray *getSaveFileName() {
 jni_bytearray *getSaveDataPath() {
 
   char *buffer = SAVE_FILE;
-  jni_bytearray *result = malloc(sizeof(jni_bytearray));
-  result->elements = malloc(strlen(buffer) + 1);
+  jni_bytearray *result = jni_pool_alloc(sizeof(jni_bytearray));
+  result->elements = jni_pool_alloc(strlen(buffer) + 1);
   // Sets the value
   strcpy((char *)result->elements, buffer);
   result->size = strlen(buffer) + 1;
@@ -592,27 +426,16 @@ void createAchieveFile(size_t size) {
 	free(buffer);
 }
 
-uint64_t j3 = 0;
-int32_t framerate = 30;
-
 void setFPS(int32_t i) {
   if (options.battle_fps && i == 15) {
-    framerate = options.battle_fps;
+    frame_pacer_set_rate(options.battle_fps);
   } else {
-    framerate = i;
+    frame_pacer_set_rate(i);
   }
 }
 
 uint64_t getCurrentFrame(uint64_t j) {
-
-  while (1) {
-    uint64_t j2 = sceKernelGetProcessTimeWide() * framerate / 1000000;
-    if (j2 != j3) {
-      j3 = j2;
-      return j2;
-    }
-    sceKernelDelayThread(1000);
-  }
+  return frame_pacer_wait();
 }
 
 #define RGBA8(r, g, b, a)                                                      \
@@ -621,14 +444,14 @@ uint64_t getCurrentFrame(uint64_t j) {
 
 jni_intarray *loadTexture(jni_bytearray *bArr) {
   //printf("loadTexture(%X)\n", bArr);
-  jni_intarray *texture = malloc(sizeof(jni_intarray));
+  jni_intarray *texture = jni_pool_alloc(sizeof(jni_intarray));
 
   int x, y, channels_in_file;
   unsigned char *temp = stbi_load_from_memory(bArr->elements, bArr->size, &x,
                                               &y, &channels_in_file, 4);
 
   texture->size = x * y + 2;
-  texture->elements = malloc(texture->size * sizeof(int));
+  texture->elements = jni_pool_alloc(texture->size * sizeof(int));
   texture->elements[0] = x;
   texture->elements[1] = y;
 
@@ -649,6 +472,18 @@ int isDeviceAndroidTV() { return 1; }
 
 stbtt_fontinfo *info = NULL;
 unsigned char *fontBuffer = NULL;
+long fontBufferSize = 0;
+
+#define MAX_FONT_SIZES 16
+int fontSizes[MAX_FONT_SIZES];
+int numFontSizes = 0;
+
+// Serializes drawFont() and the warm-up thread, the glyph cache and font source aren't thread safe
+static SceKernelLwMutexWork font_mutex;
+// Written by drawFont() and read by the warm-up thread, always go through the atomic builtins
+static uint64_t lastDrawFont = 0;
+// Signaled for every font size seen for the first time, wakes the warm-up thread up
+static SceUID warmupSema = -1;
 
 void initFont() {
 
@@ -656,34 +491,55 @@ void initFont() {
 
   if (info != NULL)
     return;
-  
-  char font_path[256];
+
+  sceKernelCreateLwMutex(&font_mutex, "font_mutex", 0, 0, NULL);
+
+  const char *font_name;
   switch (getCurrentLanguage()) {
   case 6:
   case 7:
-    strcpy(font_path, "app0:/NotoSansSC-Regular.ttf");
+    font_name = "NotoSansSC-Regular.ttf";
     break;
   case 8:
-    strcpy(font_path, "app0:/NotoSansKR-Regular.ttf");
+    font_name = "NotoSansKR-Regular.ttf";
     break;
   default:
-    strcpy(font_path, "app0:/NotoSansJP-Regular.ttf");
+    font_name = "NotoSansJP-Regular.ttf";
     break;
   }
-  FILE *fontFile = fopen(font_path, "rb");
-  
+
+  char font_path[256];
+  sprintf(font_path, "app0:/%s", font_name);
+
+  uint64_t start = sceKernelGetProcessTimeWide();
+  fontBuffer = font_source_open(font_path);
+
   // Debug
-  if (!fontFile)
-    fontFile = fopen("ux0:/data/ff4/NotoSansJP-Regular.ttf", "rb");
+  if (!fontBuffer && sceIoGetstat(font_path, &(SceIoStat){}) < 0) {
+    strcpy(font_path, "ux0:/data/ff4/NotoSansJP-Regular.ttf");
+    fontBuffer = font_source_open(font_path);
+  }
 
-  fseek(fontFile, 0, SEEK_END);
-  size = ftell(fontFile);       /* how long is the file ? */
-  fseek(fontFile, 0, SEEK_SET); /* reset */
+  if (fontBuffer) {
+    font_source_stats st;
+    font_source_get_stats(&st);
+    fontBufferSize = st.file_size;
+    printf("initFont: %u KB resident out of %u KB, opened in %llu us\n",
+           st.resident_size / 1024, st.file_size / 1024, sceKernelGetProcessTimeWide() - start);
+  } else {
+    // No glyf table to page in (CFF outlines), keep the whole font in RAM
+    FILE *fontFile = fopen(font_path, "rb");
+
+    fseek(fontFile, 0, SEEK_END);
+    size = ftell(fontFile);       /* how long is the file ? */
+    fseek(fontFile, 0, SEEK_SET); /* reset */
 
-  fontBuffer = malloc(size);
+    fontBuffer = malloc(size);
+    fontBufferSize = size;
 
-  fread(fontBuffer, size, 1, fontFile);
-  fclose(fontFile);
+    fread(fontBuffer, size, 1, fontFile);
+    fclose(fontFile);
+  }
 
   info = malloc(sizeof(stbtt_fontinfo));
 
@@ -693,106 +549,197 @@ void initFont() {
   }
 }
 
-static inline uint32_t utf8_decode_unsafe_2(const char *data)
-{
-  uint32_t codepoint;
-  codepoint = ((data[0] & 0x1F) << 6);
-  codepoint |= (data[1] & 0x3F);
-  return codepoint;
-}
+static void recordFontSize(int size) {
+  for (int i = 0; i < numFontSizes; i++) {
+    if (fontSizes[i] == size)
+      return;
+  }
+  if (numFontSizes == MAX_FONT_SIZES)
+    return;
+  fontSizes[numFontSizes++] = size;
+  if (warmupSema >= 0)
+    sceKernelSignalSema(warmupSema, 1);
 
-static inline uint32_t utf8_decode_unsafe_3(const char *data)
-{
-  uint32_t codepoint;
-  codepoint = ((data[0] & 0x0F) << 12);
-  codepoint |= (data[1] & 0x3F) << 6;
-  codepoint |= (data[2] & 0x3F);
-  return codepoint;
+  // Sizes seen this session get baked into the atlas on next boot
+  FILE *f = fopen(FONT_SIZES_FILE, "a");
+  if (f) {
+    fprintf(f, "%d\n", size);
+    fclose(f);
+  }
 }
 
-static inline uint32_t utf8_decode_unsafe_4(const char *data)
-{
-  uint32_t codepoint;
-  codepoint = ((data[0] & 0x07) << 18);
-  codepoint |= (data[1] & 0x3F) << 12;
-  codepoint |= (data[2] & 0x3F) << 6;
-  codepoint |= (data[3] & 0x3F);
-  return codepoint;
-}
+static char atlasPath[256];
+static int atlasStale = 0;
 
-jni_intarray *drawFont(char *word, int size, int i2, int i3) {
-  jni_intarray *texture = malloc(sizeof(jni_intarray));
-  texture->size = size * size + 5;
-  texture->elements = malloc(texture->size * sizeof(int));
+void initGlyphAtlas() {
+  sprintf(atlasPath, GLYPH_ATLAS_FILE, lang_codes[getCurrentLanguage()]);
 
-  int b_w = size; /* bitmap width */
-  int b_h = size; /* bitmap height */
+  FILE *f = fopen(FONT_SIZES_FILE, "r");
+  if (f) {
+    int size;
+    while (numFontSizes < MAX_FONT_SIZES && fscanf(f, "%d\n", &size) == 1)
+      fontSizes[numFontSizes++] = size;
+    fclose(f);
+  }
 
-  /* calculate font scaling */
-  float scale = stbtt_ScaleForPixelHeight(info, size);
+  int up_to_date = glyph_atlas_load(atlasPath, info, fontBufferSize);
+  for (int i = 0; i < numFontSizes && up_to_date; i++) {
+    up_to_date = glyph_atlas_has_size(fontSizes[i]);
+  }
+  // Baking takes seconds with CJK fonts, the warm-up thread does it in the background
+  atlasStale = !up_to_date && numFontSizes;
+}
 
-  int ascent, descent, lineGap;
-  stbtt_GetFontVMetrics(info, &ascent, &descent, &lineGap);
+static uint64_t warmupSliceStart = 0;
 
-  int i = 0;
-  while (word[i]) {
-    i++;
-    if (i == 4)
-      break;
+// Backs off while the game is drawing text and keeps each slice within its budget
+static void warmupYield(void) {
+  if (sceKernelGetProcessTimeWide() - warmupSliceStart > GLYPH_WARMUP_BUDGET_US) {
+    sceKernelDelayThread(GLYPH_WARMUP_PERIOD_US - GLYPH_WARMUP_BUDGET_US);
+    warmupSliceStart = sceKernelGetProcessTimeWide();
   }
-  
-  int codepoint;
-  switch (i) {
-  case 0: // This should never happen
-    codepoint = 32;
-    break;
-  case 2:
-    codepoint = utf8_decode_unsafe_2(word);
-    break;
-  case 3:
-    codepoint = utf8_decode_unsafe_3(word);
-    break;
-  case 4:
-    codepoint = utf8_decode_unsafe_4(word);
-    break;
-  default:
-    codepoint = word[0];
-    break;
+  while (sceKernelGetProcessTimeWide() - __atomic_load_n(&lastDrawFont, __ATOMIC_RELAXED) < GLYPH_WARMUP_PERIOD_US) {
+    sceKernelDelayThread(GLYPH_WARMUP_PERIOD_US);
+    warmupSliceStart = sceKernelGetProcessTimeWide();
   }
+}
 
-  int ax;
-  int lsb;
-  stbtt_GetCodepointHMetrics(info, codepoint, &ax, &lsb);
-
-  if (codepoint == 32) {
-    texture->elements[0] = roundf(ax * scale);
-    return texture;
+// Takes the font for the warm-up thread, away from the game drawing text and within its CPU budget
+static void warmupLock(int lock) {
+  if (lock) {
+    warmupYield();
+    while (sceKernelTryLockLwMutex(&font_mutex, 1) < 0) {
+      sceKernelDelayThread(GLYPH_WARMUP_PERIOD_US);
+      warmupSliceStart = sceKernelGetProcessTimeWide();
+      warmupYield();
+    }
+  } else {
+    sceKernelUnlockLwMutex(&font_mutex, 1);
+  }
+}
+
+static int glyphWarmupThread(SceSize args, void *argp) {
+  charset cs;
+  warmupSliceStart = sceKernelGetProcessTimeWide();
+  if (!charset_build(lang_codes[getCurrentLanguage()], &cs, warmupYield)) {
+    charset_free(&cs);
+    return sceKernelExitDeleteThread(0);
+  }
+
+  if (atlasStale) {
+    int sizes[MAX_FONT_SIZES], num;
+    sceKernelLockLwMutex(&font_mutex, 1, NULL);
+    num = numFontSizes;
+    memcpy(sizes, fontSizes, num * sizeof(int));
+    sceKernelUnlockLwMutex(&font_mutex, 1);
+
+    uint64_t start = sceKernelGetProcessTimeWide();
+    int n = glyph_atlas_bake(info, &cs, sizes, num, fontBufferSize, atlasPath, warmupLock);
+    printf("glyphWarmupThread: baked %d glyphs in %llu ms\n", n, (sceKernelGetProcessTimeWide() - start) / 1000);
+    sceKernelLockLwMutex(&font_mutex, 1, NULL);
+    glyph_atlas_load(atlasPath, info, fontBufferSize);
+    sceKernelUnlockLwMutex(&font_mutex, 1);
+  }
+
+  charset_sort_by_frequency(&cs);
+  int num = cs.num < GLYPH_WARMUP_GLYPHS ? cs.num : GLYPH_WARMUP_GLYPHS;
+
+  int warmed[MAX_FONT_SIZES];
+  int numWarmed = 0;
+  while (numWarmed < MAX_FONT_SIZES) {
+    // Sizes known at boot go first, then wait for drawFont() to meet new ones the atlas doesn't cover
+    int size = 0;
+    sceKernelLockLwMutex(&font_mutex, 1, NULL);
+    int more = numFontSizes < MAX_FONT_SIZES;
+    for (int i = 0; i < numFontSizes && !size; i++) {
+      size = fontSizes[i];
+      for (int j = 0; j < numWarmed; j++) {
+        if (warmed[j] == size)
+          size = 0;
+      }
+      if (size && glyph_atlas_has_size(size))
+        size = 0;
+    }
+    sceKernelUnlockLwMutex(&font_mutex, 1);
+    if (!size) {
+      if (!more)
+        break;
+      sceKernelWaitSema(warmupSema, 1, NULL);
+      continue;
+    }
+    warmed[numWarmed++] = size;
+
+    uint64_t start = sceKernelGetProcessTimeWide();
+    warmupSliceStart = start;
+    int n = 0;
+    for (int i = 0; i < num; i++) {
+      warmupLock(1);
+      glyph_cache_stats st;
+      glyph_cache_get_stats(&st);
+      int full = st.bytes > GLYPH_CACHE_MAX_KB * 1024 / 2; // leave room for what the game draws
+      if (!full && !glyph_cache_peek(cs.entries[i].codepoint, size))
+        n += glyph_cache_rasterize(info, cs.entries[i].codepoint, size) != NULL;
+      warmupLock(0);
+      if (full)
+        break;
+    }
+    printf("glyphWarmupThread: %d glyphs at size %d in %llu ms\n", n, size, (sceKernelGetProcessTimeWide() - start) / 1000);
   }
-  
-  /* create a bitmap for the phrase */
-  unsigned char *bitmap = calloc(b_w * b_h, sizeof(unsigned char));
 
-  /* get bounding box for character (may be offset to account for chars that dip above or below the line) */
-  int c_x1, c_y1, c_x2, c_y2;
-  stbtt_GetCodepointBitmapBox(info, codepoint, scale, scale, &c_x1, &c_y1, &c_x2, &c_y2);
+  charset_free(&cs);
+  return sceKernelExitDeleteThread(0);
+}
+
+void startGlyphWarmup() {
+  warmupSema = sceKernelCreateSema("glyph_warmup", 0, 0, MAX_FONT_SIZES, NULL);
+  if (warmupSema < 0)
+    return;
+  SceUID thid = sceKernelCreateThread("glyph_warmup_thread", glyphWarmupThread, 0x10000100 + 20, 0x4000, 0, SCE_KERNEL_CPU_MASK_USER_2, NULL);
+  if (thid >= 0)
+    sceKernelStartThread(thid, 0, NULL);
+}
 
-  /* compute y (different characters have different heights) */
-  int y = roundf(ascent * scale) + c_y1 - (200 * scale);
+jni_intarray *drawFont(char *word, int size, int i2, int i3) {
+  jni_intarray *texture = jni_pool_alloc(sizeof(jni_intarray));
+  texture->size = size * size + 5;
+  texture->elements = jni_pool_alloc(texture->size * sizeof(int));
 
-  /* render character (stride and offset is important here) */
-  int byteOffset = roundf(lsb * scale) + (y * b_w);
+  int len = 0;
+  while (len < 4 && word[len])
+    len++;
 
-  stbtt_MakeCodepointBitmap(info, bitmap + byteOffset, c_x2 - c_x1, c_y2 - c_y1, b_w, scale, scale, codepoint);
+  uint32_t codepoint = 32; // empty string, this should never happen
+  if (len)
+    utf8_decode((uint8_t *)word, len, &codepoint);
 
-  texture->elements[0] = (c_x2 - c_x1 + roundf(lsb * scale));
-  texture->elements[1] = 0;
-  texture->elements[2] = 0;
+  sceKernelLockLwMutex(&font_mutex, 1, NULL);
+  uint64_t now = sceKernelGetProcessTimeWide();
+  __atomic_store_n(&lastDrawFont, now, __ATOMIC_RELAXED);
+
+  font_batch_next(info, codepoint, size, now);
+  glyph_entry *g = glyph_cache_lookup(codepoint, size);
+  if (!g)
+    g = glyph_atlas_fetch(codepoint, size);
+  if (!g) {
+    recordFontSize(size);
+    g = glyph_cache_rasterize(info, codepoint, size);
+  }
+  glyph_entry blank;
+  if (!g) {
+    // Out of memory for the coverage, at least advance the pen
+    glyph_measure(info, codepoint, size, &blank);
+    blank.w = blank.h = 0;
+    g = &blank;
+  }
 
-  for (int n = 0; n < size * size; n++) {
-    texture->elements[5 + n] = RGBA8(bitmap[n], bitmap[n], bitmap[n], bitmap[n]);
+  texture->elements[0] = g->advance;
+  if (codepoint != 32) {
+    texture->elements[1] = 0;
+    texture->elements[2] = 0;
+    glyph_expand(g, size, (uint32_t *)&texture->elements[5]);
   }
+  sceKernelUnlockLwMutex(&font_mutex, 1);
 
-  free(bitmap);
   return texture;
 }
 
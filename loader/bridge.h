@@ -18,7 +18,6 @@ uint8_t isSoundFileExist(char *str);
 void setFPS(int32_t i);
 void createSaveFile(size_t size);
 uint64_t getCurrentFrame(uint64_t j);
-int readHeader();
 
 typedef struct {
   int *elements;
@@ -32,6 +31,8 @@ jni_intarray *drawFont(char *str, int i, int i2, int i3);
 void createEditText(char *str);
 char *getEditText();
 void initFont();
+void initGlyphAtlas();
+void startGlyphWarmup();
 
 int getCurrentLanguage();
 
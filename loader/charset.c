@@ -0,0 +1,89 @@
+/* charset.c -- code points used by the game's message files
+ *
+ * Walks every .msd entry under <lang>.lproj in main.obb and counts the code
+ * points found in it. Message files are stored as plain UTF-8, any byte
+ * sequence that does not decode is simply skipped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "charset.h"
+#include "obb.h"
+#include "utf_conv.h"
+
+#define CHARSET_MAX_CODEPOINT 0x10000 // the game never displays anything outside the BMP
+
+int charset_build(const char *lang, charset *cs, charset_yield_fn yield) {
+  char prefix[32];
+  sprintf(prefix, "%s.lproj/", lang);
+  int prefix_len = strlen(prefix);
+
+  uint32_t *counts = calloc(CHARSET_MAX_CODEPOINT, sizeof(uint32_t));
+
+  // Always keep printable ASCII around, numbers and names are built at runtime
+  for (uint32_t c = 0x20; c < 0x7F; c++)
+    counts[c] = 1;
+
+  int num_files = obb_get_file_count();
+  for (int i = 0; i < num_files; i++) {
+    const char *name = obb_get_file_name(i);
+    int name_len = strlen(name);
+    if (strncmp(name, prefix, prefix_len) || name_len < 4 || strcmp(&name[name_len - 4], ".msd"))
+      continue;
+
+    if (yield)
+      yield();
+
+    int len;
+    unsigned char *data = m476a((char *)name, &len);
+    if (!data)
+      continue;
+
+    for (int n = 0; n < len;) {
+      uint32_t cp;
+      n += utf8_decode(&data[n], len - n, &cp);
+      if (cp >= 0x20 && cp < CHARSET_MAX_CODEPOINT && cp != UTF_REPLACEMENT)
+        counts[cp]++;
+    }
+    free(data);
+  }
+
+  cs->num = 0;
+  for (uint32_t c = 0; c < CHARSET_MAX_CODEPOINT; c++) {
+    if (counts[c])
+      cs->num++;
+  }
+
+  cs->entries = malloc(cs->num * sizeof(charset_entry));
+  int n = 0;
+  for (uint32_t c = 0; c < CHARSET_MAX_CODEPOINT; c++) {
+    if (counts[c]) {
+      cs->entries[n].codepoint = c;
+      cs->entries[n].count = counts[c];
+      n++;
+    }
+  }
+
+  free(counts);
+  return cs->num;
+}
+
+static int charset_cmp_count(const void *a, const void *b) {
+  const charset_entry *ea = (const charset_entry *)a;
+  const charset_entry *eb = (const charset_entry *)b;
+  if (ea->count != eb->count)
+    return ea->count < eb->count ? 1 : -1;
+  return ea->codepoint < eb->codepoint ? -1 : 1;
+}
+
+void charset_sort_by_frequency(charset *cs) {
+  qsort(cs->entries, cs->num, sizeof(charset_entry), charset_cmp_count);
+}
+
+void charset_free(charset *cs) {
+  free(cs->entries);
+  cs->entries = NULL;
+  cs->num = 0;
+}
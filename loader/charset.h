@@ -0,0 +1,23 @@
+#ifndef __CHARSET_H__
+#define __CHARSET_H__
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t codepoint;
+  uint32_t count;
+} charset_entry;
+
+typedef struct {
+  charset_entry *entries;
+  int num;
+} charset;
+
+// Called between message files so long builds can give the CPU back
+typedef void (*charset_yield_fn)(void);
+
+int charset_build(const char *lang, charset *cs, charset_yield_fn yield);
+void charset_sort_by_frequency(charset *cs);
+void charset_free(charset *cs);
+
+#endif
@@ -5,11 +5,21 @@
 
 #define MEMORY_NEWLIB_MB 256
 #define MEMORY_VITAGL_THRESHOLD_MB 8
+#define GLYPH_CACHE_MAX_KB 4096
+#define GLYPH_WARMUP_GLYPHS 1024     // most frequent code points rasterized ahead of time
+#define GLYPH_WARMUP_BUDGET_US 2000  // warm-up CPU time allowed per GLYPH_WARMUP_PERIOD_US
+#define GLYPH_WARMUP_PERIOD_US 16667
+#define FRAME_PACER_VBLANK_ALIGN 0    // start frames on the vblank closest to their deadline
+#define DYN_RES_MIN_LEVEL 16          // lowest dynamic resolution scale, in 32nds of the display size
+#define DYN_RES_TARGET_PCT 85         // share of the frame budget the dynamic resolution aims for
+#define UPSCALE_SHARPNESS_STOPS 0.2f  // FSR sharpening strength, 0 is the strongest
 
 #define DATA_PATH "ux0:data/ff4"
 #define SO_PATH DATA_PATH "/" "libff4.so"
 #define CONFIG_FILE_PATH "ux0:data/ff4/options.cfg"
 #define TROPHIES_FILE "ux0:data/ff4/trophies.chk"
+#define FONT_SIZES_FILE DATA_PATH "/font_sizes.txt"
+#define GLYPH_ATLAS_FILE DATA_PATH "/glyphs_%s.atlas"
 
 #define DEF_SCREEN_W 960
 #define DEF_SCREEN_H 544
@@ -24,6 +34,9 @@ typedef struct {
   int battle_fps;
   int debug_menu;
   int swap_confirm;
+  int dyn_res;
+  int upscaler;
+  int fxaa_quality;
 } config_opts;
 extern config_opts options;
 
@@ -0,0 +1,55 @@
+/* crt_lut.c -- lookup tables for the CRT PostFX
+ *
+ * Everything 5_CRT_f.cg computes per pixel that does not depend on time
+ * only depends on the pixel position, so 7_CRTFast_f.cg reads it from two
+ * textures filled here once for the output resolution:
+ *  - warp: the curved screen coordinate, 16 bits per axis (RGBA8, x in
+ *    R/G and y in B/A, high byte first)
+ *  - shade: vignette times aperture mask, 0 outside the tube (8 bits)
+ * Rows follow texture order, the first one being the bottom of the screen.
+ */
+
+#include <math.h>
+
+#include "crt_lut.h"
+
+static void curve(float *x, float *y) {
+  float u = (*x - 0.5f) * 2.0f * 1.1f;
+  float v = (*y - 0.5f) * 2.0f * 1.1f;
+  u *= 1.0f + powf(fabsf(v) / 5.0f, 2.0f);
+  v *= 1.0f + powf(fabsf(u) / 4.0f, 2.0f);
+  *x = (u / 2.0f + 0.5f) * 0.92f + 0.04f;
+  *y = (v / 2.0f + 0.5f) * 0.92f + 0.04f;
+}
+
+static void pack16(float v, uint8_t *out) {
+  v = v < 0.0f ? 0.0f : v > 1.0f ? 1.0f : v;
+  uint32_t q = (uint32_t)(v * 65535.0f + 0.5f);
+  out[0] = q >> 8;
+  out[1] = q & 0xFF;
+}
+
+void crt_lut_build(int width, int height, uint8_t *warp, uint8_t *shade) {
+  for (int j = 0; j < height; j++) {
+    for (int i = 0; i < width; i++) {
+      // Same window coordinates as the WPOS input of 5_CRT_f.cg, origin at the top left
+      float frag_x = i + 0.5f, frag_y = height - (j + 0.5f);
+      float x = (width - frag_x) / width, y = (height - frag_y) / height;
+      curve(&x, &y);
+      x = 1.0f - x;
+
+      float s = 0.0f;
+      if (x >= 0.0f && x <= 1.0f && y >= 0.0f && y <= 1.0f) {
+        float vig = 16.0f * x * y * (1.0f - x) * (1.0f - y);
+        s = powf(vig, 0.3f);
+        if (i & 1)
+          s *= 0.35f;
+      }
+
+      pack16(x, &warp[0]);
+      pack16(y, &warp[2]);
+      *shade++ = (uint8_t)(s * 255.0f + 0.5f);
+      warp += 4;
+    }
+  }
+}
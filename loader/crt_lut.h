@@ -0,0 +1,10 @@
+#ifndef __CRT_LUT_H__
+#define __CRT_LUT_H__
+
+#include <stdint.h>
+
+#define CRT_LUT_SCANLINE_RES 544.0f // scanline frequency of 5_CRT, kept whatever the resolution
+
+void crt_lut_build(int width, int height, uint8_t *warp, uint8_t *shade);
+
+#endif
@@ -16,51 +16,12 @@
 #include <stdarg.h>
 
 #include "dialog.h"
+#include "utf_conv.h"
 
 static uint16_t ime_title_utf16[SCE_IME_DIALOG_MAX_TITLE_LENGTH];
 static uint16_t ime_initial_text_utf16[SCE_IME_DIALOG_MAX_TEXT_LENGTH];
 static uint16_t ime_input_text_utf16[SCE_IME_DIALOG_MAX_TEXT_LENGTH + 1];
-static uint8_t ime_input_text_utf8[SCE_IME_DIALOG_MAX_TEXT_LENGTH + 1];
-
-void utf16_to_utf8(const uint16_t *src, uint8_t *dst) {
-  for (int i = 0; src[i]; i++) {
-    if ((src[i] & 0xFF80) == 0) {
-      *(dst++) = src[i] & 0xFF;
-    } else if((src[i] & 0xF800) == 0) {
-      *(dst++) = ((src[i] >> 6) & 0xFF) | 0xC0;
-      *(dst++) = (src[i] & 0x3F) | 0x80;
-    } else if((src[i] & 0xFC00) == 0xD800 && (src[i + 1] & 0xFC00) == 0xDC00) {
-      *(dst++) = (((src[i] + 64) >> 8) & 0x3) | 0xF0;
-      *(dst++) = (((src[i] >> 2) + 16) & 0x3F) | 0x80;
-      *(dst++) = ((src[i] >> 4) & 0x30) | 0x80 | ((src[i + 1] << 2) & 0xF);
-      *(dst++) = (src[i + 1] & 0x3F) | 0x80;
-      i += 1;
-    } else {
-      *(dst++) = ((src[i] >> 12) & 0xF) | 0xE0;
-      *(dst++) = ((src[i] >> 6) & 0x3F) | 0x80;
-      *(dst++) = (src[i] & 0x3F) | 0x80;
-    }
-  }
-
-  *dst = '\0';
-}
-
-void utf8_to_utf16(const uint8_t *src, uint16_t *dst) {
-  for (int i = 0; src[i];) {
-    if ((src[i] & 0xE0) == 0xE0) {
-      *(dst++) = ((src[i] & 0x0F) << 12) | ((src[i + 1] & 0x3F) << 6) | (src[i + 2] & 0x3F);
-      i += 3;
-    } else if ((src[i] & 0xC0) == 0xC0) {
-      *(dst++) = ((src[i] & 0x1F) << 6) | (src[i + 1] & 0x3F);
-      i += 2;
-    } else {
-      *(dst++) = src[i];
-      i += 1;
-    }
-  }
-
-  *dst = '\0';
-}
+static uint8_t ime_input_text_utf8[SCE_IME_DIALOG_MAX_TEXT_LENGTH * 3 + 1];
 
 int init_ime_dialog(const char *title, const char *initial_text) {
   memset(ime_title_utf16, 0, sizeof(ime_title_utf16));
@@ -68,8 +29,8 @@ int init_ime_dialog(const char *title, const char *initial_text) {
   memset(ime_input_text_utf16, 0, sizeof(ime_input_text_utf16));
   memset(ime_input_text_utf8, 0, sizeof(ime_input_text_utf8));
 
-  utf8_to_utf16((uint8_t *)title, ime_title_utf16);
-  utf8_to_utf16((uint8_t *)initial_text, ime_initial_text_utf16);
+  utf8_to_utf16((uint8_t *)title, -1, ime_title_utf16, SCE_IME_DIALOG_MAX_TITLE_LENGTH);
+  utf8_to_utf16((uint8_t *)initial_text, -1, ime_initial_text_utf16, SCE_IME_DIALOG_MAX_TEXT_LENGTH);
 
   SceImeDialogParam param;
   sceImeDialogParamInit(&param);
@@ -93,7 +54,7 @@ char *get_ime_dialog_result(void) {
   memset(&result, 0, sizeof(SceImeDialogResult));
   sceImeDialogGetResult(&result);
   if (result.button == SCE_IME_DIALOG_BUTTON_ENTER)
-    utf16_to_utf8(ime_input_text_utf16, ime_input_text_utf8);
+    utf16_to_utf8(ime_input_text_utf16, -1, ime_input_text_utf8, sizeof(ime_input_text_utf8));
   sceImeDialogTerm();
   // For some reason analog stick stops working after ime
   sceCtrlSetSamplingModeExt(SCE_CTRL_MODE_ANALOG_WIDE);
@@ -0,0 +1,292 @@
+/* draw_batch.c -- merging of the game's small client array draws
+ *
+ * The game draws its 2D layers one sprite or glyph at a time, each a
+ * glDrawArrays of a few vertices that vitaGL copies and validates on its
+ * own. Draws are instead appended to a batch as triangle lists, and the
+ * batch is drawn at once when the game changes any state that would affect
+ * it (the hooks of gl_hooks.c call draw_batch_flush() once gl_state.c let
+ * the change through), before the loader draws anything of its own and at
+ * the end of the game's frame.
+ *
+ * Modelview changes don't split a batch: vertices are stored as given
+ * while the batch has a single modelview, and moved to eye space on the
+ * CPU once a draw with a different one joins, the batch then being drawn
+ * with an identity modelview. Projection and texture matrix changes flush.
+ * The game's matrices are read from matrix_stack.c.
+ */
+
+#include <vitasdk.h>
+#include <vitaGL.h>
+#include <string.h>
+
+#include "draw_batch.h"
+#include "ffp_cache.h"
+#include "gl_hooks.h"
+#include "matrix_stack.h"
+#include "tex_stage.h"
+
+enum {
+  ARRAY_VERTEX,
+  ARRAY_COLOR,
+  ARRAY_TEXCOORD,
+  ARRAY_NORMAL,
+  ARRAY_COUNT
+};
+
+typedef struct {
+  GLint size;
+  GLenum type;
+  GLsizei stride;
+  const uint8_t *pointer;
+} client_array;
+
+static const GLenum array_names[ARRAY_COUNT] = {GL_VERTEX_ARRAY, GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY, GL_NORMAL_ARRAY};
+
+// The game's view of the client arrays
+static client_array arrays[ARRAY_COUNT];
+static int enabled = 0;
+
+// Batch being built
+static GLfloat pos[DRAW_BATCH_MAX_VERTS][3];
+static uint8_t color[DRAW_BATCH_MAX_VERTS][4];
+static GLfloat texcoord[DRAW_BATCH_MAX_VERTS][2];
+static int num_verts = 0;
+static int batch_arrays = 0;
+static int batch_eye = 0; // vertices already in eye space
+static GLfloat batch_modelview[16];
+
+static draw_batch_stats cur, last;
+
+static const GLfloat identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+static int array_index(GLenum array) {
+  for (int i = 0; i < ARRAY_COUNT; i++) {
+    if (array_names[i] == array)
+      return i;
+  }
+  return -1;
+}
+
+static int is_affine(const GLfloat *m) {
+  return m[3] == 0.0f && m[7] == 0.0f && m[11] == 0.0f && m[15] == 1.0f;
+}
+
+static float fetch(GLenum type, const uint8_t *p) {
+  switch (type) {
+  case GL_FLOAT:
+    return *(const GLfloat *)p;
+  case GL_SHORT:
+    return *(const GLshort *)p;
+  case GL_BYTE:
+    return *(const GLbyte *)p;
+  default: // GL_FIXED
+    return *(const GLfixed *)p / 65536.0f;
+  }
+}
+
+static int type_size(GLenum type) {
+  return type == GL_BYTE || type == GL_UNSIGNED_BYTE ? 1 : type == GL_SHORT ? 2 : 4;
+}
+
+static int batchable(GLenum mode) {
+  if (mode != GL_TRIANGLES && mode != GL_TRIANGLE_STRIP && mode != GL_TRIANGLE_FAN)
+    return 0;
+  if (!(enabled & (1 << ARRAY_VERTEX)) || (enabled & (1 << ARRAY_NORMAL)))
+    return 0;
+
+  const client_array *v = &arrays[ARRAY_VERTEX], *c = &arrays[ARRAY_COLOR], *t = &arrays[ARRAY_TEXCOORD];
+  if (v->size > 3 || v->type == GL_UNSIGNED_BYTE)
+    return 0;
+  if ((enabled & (1 << ARRAY_COLOR)) && (c->size != 4 || (c->type != GL_UNSIGNED_BYTE && c->type != GL_FLOAT)))
+    return 0;
+  if ((enabled & (1 << ARRAY_TEXCOORD)) && (t->size != 2 || t->type == GL_UNSIGNED_BYTE))
+    return 0;
+  return 1;
+}
+
+static void transform(const float *m, GLfloat *p) {
+  GLfloat x = p[0], y = p[1], z = p[2];
+  p[0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+  p[1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+  p[2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+}
+
+static void append_vertex(int v) {
+  const client_array *a = &arrays[ARRAY_VERTEX];
+  const uint8_t *p = a->pointer + v * (a->stride ? a->stride : a->size * type_size(a->type));
+  GLfloat *out = pos[num_verts];
+  int n = type_size(a->type);
+  out[0] = fetch(a->type, p);
+  out[1] = fetch(a->type, p + n);
+  out[2] = a->size == 3 ? fetch(a->type, p + n * 2) : 0.0f;
+  if (batch_eye)
+    transform(matrix_stack_top(MATRIX_MODELVIEW), out);
+
+  if (batch_arrays & (1 << ARRAY_COLOR)) {
+    a = &arrays[ARRAY_COLOR];
+    p = a->pointer + v * (a->stride ? a->stride : 4 * type_size(a->type));
+    if (a->type == GL_UNSIGNED_BYTE) {
+      memcpy(color[num_verts], p, 4);
+    } else {
+      for (int i = 0; i < 4; i++) {
+        GLfloat c = ((const GLfloat *)p)[i];
+        color[num_verts][i] = c <= 0.0f ? 0 : c >= 1.0f ? 255 : (uint8_t)(c * 255.0f + 0.5f);
+      }
+    }
+  }
+
+  if (batch_arrays & (1 << ARRAY_TEXCOORD)) {
+    a = &arrays[ARRAY_TEXCOORD];
+    n = type_size(a->type);
+    p = a->pointer + v * (a->stride ? a->stride : 2 * n);
+    texcoord[num_verts][0] = fetch(a->type, p);
+    texcoord[num_verts][1] = fetch(a->type, p + n);
+  }
+
+  num_verts++;
+}
+
+static int triangle_count(GLenum mode, GLsizei count) {
+  if (count < 3)
+    return 0;
+  return mode == GL_TRIANGLES ? count / 3 : count - 2;
+}
+
+int draw_batch_add(GLenum mode, GLint first, GLsizei count) {
+  if (!batchable(mode)) {
+    draw_batch_flush();
+    cur.draws_requested++;
+    cur.draws_issued++;
+    return 0;
+  }
+
+  int verts = triangle_count(mode, count) * 3;
+  const float *modelview = matrix_stack_top(MATRIX_MODELVIEW);
+
+  if (num_verts) {
+    if (batch_arrays != enabled || num_verts + verts > DRAW_BATCH_MAX_VERTS) {
+      draw_batch_flush();
+    } else if (!batch_eye && memcmp(modelview, batch_modelview, sizeof(batch_modelview))) {
+      // Move what the batch holds to eye space, new vertices will follow
+      if (is_affine(modelview) && is_affine(batch_modelview)) {
+        for (int i = 0; i < num_verts; i++)
+          transform(batch_modelview, pos[i]);
+        batch_eye = 1;
+      } else {
+        draw_batch_flush();
+      }
+    } else if (batch_eye && !is_affine(modelview)) {
+      draw_batch_flush();
+    }
+  }
+
+  cur.draws_requested++;
+  if (verts > DRAW_BATCH_MAX_VERTS) {
+    cur.draws_issued++;
+    return 0;
+  }
+
+  if (!num_verts) {
+    memcpy(batch_modelview, modelview, sizeof(batch_modelview));
+    batch_arrays = enabled;
+    batch_eye = 0;
+  } else {
+    cur.batched++;
+  }
+
+  // Everything is stored as triangle lists, keeping the winding of strips
+  if (mode == GL_TRIANGLES) {
+    for (int i = 0; i < verts; i++)
+      append_vertex(first + i);
+  } else if (mode == GL_TRIANGLE_STRIP) {
+    for (int i = 0; i < count - 2; i++) {
+      append_vertex(first + i + (i & 1));
+      append_vertex(first + i + 1 - (i & 1));
+      append_vertex(first + i + 2);
+    }
+  } else {
+    for (int i = 1; i < count - 1; i++) {
+      append_vertex(first);
+      append_vertex(first + i);
+      append_vertex(first + i + 1);
+    }
+  }
+  return 1;
+}
+
+static void set_pointer(int i, GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  ffp_cache_pointer(array_names[i], size, type, stride, pointer);
+  switch (i) {
+  case ARRAY_VERTEX:
+    glVertexPointer(size, type, stride, pointer);
+    break;
+  case ARRAY_COLOR:
+    glColorPointer(size, type, stride, pointer);
+    break;
+  case ARRAY_TEXCOORD:
+    glTexCoordPointer(size, type, stride, pointer);
+    break;
+  }
+}
+
+void draw_batch_flush(void) {
+  if (!num_verts)
+    return;
+
+  set_pointer(ARRAY_VERTEX, 3, GL_FLOAT, 0, pos);
+  if (batch_arrays & (1 << ARRAY_COLOR))
+    set_pointer(ARRAY_COLOR, 4, GL_UNSIGNED_BYTE, 0, color);
+  if (batch_arrays & (1 << ARRAY_TEXCOORD))
+    set_pointer(ARRAY_TEXCOORD, 2, GL_FLOAT, 0, texcoord);
+
+  // The game may have moved on to another modelview, it is handed back on its next draw
+  gl_hooks_sync_matrices();
+  const GLfloat *m = batch_eye ? identity : batch_modelview;
+  if (memcmp(m, matrix_stack_top(MATRIX_MODELVIEW), sizeof(batch_modelview))) {
+    glLoadMatrixf(m);
+    matrix_stack_touch(MATRIX_MODELVIEW);
+  }
+
+  ffp_cache_draw();
+  tex_stage_flush_bound();
+  glDrawArrays(GL_TRIANGLES, 0, num_verts);
+  cur.draws_issued++;
+
+  // vitaGL copied the vertices, the game's own arrays go back in place
+  for (int i = ARRAY_VERTEX; i <= ARRAY_TEXCOORD; i++) {
+    if ((batch_arrays & (1 << i)) && arrays[i].size)
+      set_pointer(i, arrays[i].size, arrays[i].type, arrays[i].stride, arrays[i].pointer);
+  }
+
+  num_verts = 0;
+}
+
+void draw_batch_client_state(GLenum array, GLboolean on) {
+  int i = array_index(array);
+  if (i >= 0)
+    enabled = on ? (enabled | (1 << i)) : (enabled & ~(1 << i));
+}
+
+void draw_batch_pointer(GLenum array, GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  int i = array_index(array);
+  if (i < 0)
+    return;
+  arrays[i].size = size;
+  arrays[i].type = type;
+  arrays[i].stride = stride;
+  arrays[i].pointer = pointer;
+}
+
+void draw_batch_matrix_op(void) {
+  if (matrix_stack_get_mode() != MATRIX_MODELVIEW)
+    draw_batch_flush();
+}
+
+void draw_batch_end_frame(void) {
+  last = cur;
+  memset(&cur, 0, sizeof(cur));
+}
+
+void draw_batch_get_stats(draw_batch_stats *stats) {
+  *stats = last;
+}
@@ -0,0 +1,25 @@
+#ifndef __DRAW_BATCH_H__
+#define __DRAW_BATCH_H__
+
+#include <stdint.h>
+#include <vitaGL.h>
+
+#define DRAW_BATCH_MAX_VERTS 6144 // 1024 quads
+
+typedef struct {
+  uint32_t draws_requested; // glDrawArrays calls issued by the game during the last frame
+  uint32_t draws_issued;    // draws that reached vitaGL
+  uint32_t batched;         // game draws merged into another one
+} draw_batch_stats;
+
+int draw_batch_add(GLenum mode, GLint first, GLsizei count);
+void draw_batch_flush(void);
+
+void draw_batch_client_state(GLenum array, GLboolean on);
+void draw_batch_pointer(GLenum array, GLint size, GLenum type, GLsizei stride, const void *pointer);
+void draw_batch_matrix_op(void);
+
+void draw_batch_end_frame(void);
+void draw_batch_get_stats(draw_batch_stats *stats);
+
+#endif
@@ -0,0 +1,206 @@
+/* dyn_res.c -- dynamic resolution scaling
+ *
+ * The game renders into an offscreen target instead of the display, and
+ * only fills its bottom-left level / DYN_RES_STEPS part: the viewport and
+ * scissor rectangles it sets are scaled on their way to vitaGL. That corner
+ * is then stretched over the whole screen with the same full-screen quad
+ * PostFX draws, bilinearly or through the FSR passes of upscale.c, so
+ * changing the level never reallocates anything. The target only needs to
+ * be as large as the highest level, which a fixed 544p internal render
+ * for the FSR upscaler sets below the full size.
+ *
+ * vitaGL has no GPU timer queries. The controller is fed the time each
+ * frame kept the loader busy, vglSwapBuffers() included and the frame
+ * pacer's sleep excluded, which is the GPU time whenever the GPU is the
+ * bottleneck. It drops the level at once in proportion to the overshoot
+ * and raises it one step at a time once the frame is comfortably under
+ * budget.
+ */
+
+#include <vitasdk.h>
+#include <vitaGL.h>
+#include <math.h>
+#include <string.h>
+
+#include "config.h"
+#include "dyn_res.h"
+#include "shader_cache.h"
+#include "upscale.h"
+
+extern float postfx_pos[8];
+
+static const char *resolve_vert =
+  "void main(float2 position, float2 texcoord, out float4 vPosition : POSITION, out float2 vTexcoord : TEXCOORD0) {\n"
+  "  vPosition = float4(position, 1.f, 1.f);\n"
+  "  vTexcoord = texcoord;\n"
+  "}\n";
+
+static const char *resolve_frag =
+  "float4 main(float2 vTexcoord : TEXCOORD0, uniform float2 uvMax, uniform sampler2D tex : TEXUNIT0) : COLOR {\n"
+  "  return float4(tex2D(tex, min(vTexcoord, uvMax)).xyz, 1.f);\n"
+  "}\n";
+
+static int enabled = 0, dynamic = 0;
+static int full_w, full_h, tex_w, tex_h;
+static int level = DYN_RES_STEPS, max_level = DYN_RES_STEPS;
+static int cooldown = 0;
+static uint32_t busy_avg = 0;
+
+static GLuint dyn_fb, dyn_tex, resolve_prog;
+static GLint uv_max_unif;
+
+// Last rectangles requested by the game, in display coordinates
+static GLint viewport[4], scissor[4];
+
+static void scaled_rect(const GLint *r, GLint *out) {
+  GLint x0 = r[0] * level / DYN_RES_STEPS, y0 = r[1] * level / DYN_RES_STEPS;
+  out[0] = x0;
+  out[1] = y0;
+  out[2] = (r[0] + r[2]) * level / DYN_RES_STEPS - x0;
+  out[3] = (r[1] + r[3]) * level / DYN_RES_STEPS - y0;
+}
+
+void dyn_res_init(int width, int height, int max, int dyn) {
+  full_w = width;
+  full_h = height;
+  level = max_level = max;
+  dynamic = dyn;
+  tex_w = width * max / DYN_RES_STEPS;
+  tex_h = height * max / DYN_RES_STEPS;
+  viewport[2] = scissor[2] = width;
+  viewport[3] = scissor[3] = height;
+
+  glGenTextures(1, &dyn_tex);
+  glBindTexture(GL_TEXTURE_2D, dyn_tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex_w, tex_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glGenFramebuffers(1, &dyn_fb);
+  glBindFramebuffer(GL_FRAMEBUFFER, dyn_fb);
+  glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, dyn_tex, 0);
+
+  GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+  shader_cache_compile(vs, resolve_vert, strlen(resolve_vert));
+  GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+  shader_cache_compile(fs, resolve_frag, strlen(resolve_frag));
+
+  resolve_prog = glCreateProgram();
+  glAttachShader(resolve_prog, vs);
+  glAttachShader(resolve_prog, fs);
+  glBindAttribLocation(resolve_prog, 0, "position");
+  glBindAttribLocation(resolve_prog, 1, "texcoord");
+  glLinkProgram(resolve_prog);
+  uv_max_unif = glGetUniformLocation(resolve_prog, "uvMax");
+
+  if (options.upscaler == UPSCALER_FSR)
+    upscale_init(width, height);
+
+  enabled = 1;
+}
+
+int dyn_res_enabled(void) {
+  return enabled;
+}
+
+void dyn_res_begin_frame(void) {
+  if (!enabled)
+    return;
+
+  // The resolve pass and the HUD leave their own viewport behind, and the level may have changed
+  GLint r[4];
+  glBindFramebuffer(GL_FRAMEBUFFER, dyn_fb);
+  scaled_rect(viewport, r);
+  glViewport(r[0], r[1], r[2], r[3]);
+  scaled_rect(scissor, r);
+  glScissor(r[0], r[1], r[2], r[3]);
+}
+
+void dyn_res_resolve(GLuint target) {
+  if (!enabled)
+    return;
+
+  int w, h;
+  dyn_res_get_size(&w, &h);
+  if (options.upscaler == UPSCALER_FSR) {
+    upscale_fsr(dyn_tex, w, h, tex_w, tex_h, target);
+    return;
+  }
+
+  float sx = (float)w / tex_w, sy = (float)h / tex_h;
+  float texcoord[8] = {
+    0.0f, sy,
+    0.0f, 0.0f,
+    sx, sy,
+    sx, 0.0f
+  };
+
+  glBindFramebuffer(GL_FRAMEBUFFER, target);
+  glViewport(0, 0, full_w, full_h);
+  glBindTexture(GL_TEXTURE_2D, dyn_tex);
+  glUseProgram(resolve_prog);
+  // Keep the bilinear taps inside the rendered part, the rest of the target holds older frames
+  glUniform2f(uv_max_unif, (w - 0.5f) / tex_w, (h - 0.5f) / tex_h);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, &postfx_pos[0]);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, &texcoord[0]);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  glUseProgram(0);
+}
+
+void dyn_res_end_frame(uint32_t busy_us, uint32_t budget_us) {
+  if (!dynamic)
+    return;
+
+  busy_avg = busy_avg ? (busy_avg * 3 + busy_us) / 4 : busy_us;
+  if (cooldown > 0) {
+    cooldown--;
+    return;
+  }
+
+  uint32_t target = budget_us * DYN_RES_TARGET_PCT / 100;
+  if (busy_avg > target && level > DYN_RES_MIN_LEVEL) {
+    // Fill cost follows the area, so the side shrinks with the square root of the overshoot
+    int next = (int)(level * sqrtf((float)target / busy_avg));
+    if (next >= level)
+      next = level - 1;
+    level = next < DYN_RES_MIN_LEVEL ? DYN_RES_MIN_LEVEL : next;
+    cooldown = 4;
+  } else if (busy_avg < target * 3 / 4 && level < max_level) {
+    level++;
+    cooldown = 15;
+  }
+}
+
+void dyn_res_get_size(int *width, int *height) {
+  *width = full_w * level / DYN_RES_STEPS;
+  *height = full_h * level / DYN_RES_STEPS;
+}
+
+void dyn_res_viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  viewport[0] = x;
+  viewport[1] = y;
+  viewport[2] = width;
+  viewport[3] = height;
+  if (enabled) {
+    GLint r[4];
+    scaled_rect(viewport, r);
+    glViewport(r[0], r[1], r[2], r[3]);
+  } else {
+    glViewport(x, y, width, height);
+  }
+}
+
+void dyn_res_scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+  scissor[0] = x;
+  scissor[1] = y;
+  scissor[2] = width;
+  scissor[3] = height;
+  if (enabled) {
+    GLint r[4];
+    scaled_rect(scissor, r);
+    glScissor(r[0], r[1], r[2], r[3]);
+  } else {
+    glScissor(x, y, width, height);
+  }
+}
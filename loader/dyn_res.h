@@ -0,0 +1,19 @@
+#ifndef __DYN_RES_H__
+#define __DYN_RES_H__
+
+#include <stdint.h>
+#include <vitaGL.h>
+
+#define DYN_RES_STEPS 32 // scale granularity, the render size is level / DYN_RES_STEPS of the display
+
+void dyn_res_init(int width, int height, int max_level, int dynamic);
+int dyn_res_enabled(void);
+void dyn_res_begin_frame(void);
+void dyn_res_resolve(GLuint target);
+void dyn_res_end_frame(uint32_t busy_us, uint32_t budget_us);
+void dyn_res_get_size(int *width, int *height);
+
+void dyn_res_viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void dyn_res_scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+#endif
@@ -0,0 +1,238 @@
+/* ffp_cache.c -- fixed function state permutations seen by the game
+ *
+ * vitaGL builds a shader for each combination of fixed function state it
+ * is asked to draw with, the first time that combination shows up, so new
+ * effects hitch while it compiles. Every combination libff4.so draws with
+ * is recorded in FFP_CACHE_FILE; at boot each recorded one is set up again
+ * and drawn as a degenerate triangle, which makes vitaGL build and link the
+ * matching shaders (out of the shader cache after the first session)
+ * before the game renders its first frame.
+ */
+
+#include <vitasdk.h>
+#include <vitaGL.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "ffp_cache.h"
+#include "tex_stage.h"
+
+#define FFP_CACHE_MAGIC 0x50464646 // FFFP
+#define FFP_CACHE_SLOTS (FFP_CACHE_MAX_STATES * 2)
+
+enum {
+  ARRAY_VERTEX,
+  ARRAY_COLOR,
+  ARRAY_TEXCOORD,
+  ARRAY_NORMAL,
+  ARRAY_COUNT
+};
+
+typedef struct {
+  uint16_t caps;             // bits of ffp_caps
+  uint8_t arrays;            // enabled client arrays
+  uint8_t alpha_func;        // offset from GL_NEVER
+  uint16_t fog_mode;
+  uint8_t size[ARRAY_COUNT]; // layout of the enabled arrays
+  uint16_t type[ARRAY_COUNT];
+} ffp_state;
+
+static const GLenum ffp_caps[] = {
+  GL_TEXTURE_2D, GL_ALPHA_TEST, GL_FOG, GL_LIGHTING, GL_COLOR_MATERIAL,
+  GL_LIGHT0, GL_LIGHT1, GL_LIGHT2, GL_LIGHT3, GL_LIGHT4, GL_LIGHT5, GL_LIGHT6, GL_LIGHT7
+};
+
+static const GLenum ffp_arrays[] = {GL_VERTEX_ARRAY, GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY, GL_NORMAL_ARRAY};
+
+static ffp_state cur = {0, 0, GL_ALWAYS - GL_NEVER, GL_EXP, {4, 4, 4, 3}, {GL_FLOAT, GL_FLOAT, GL_FLOAT, GL_FLOAT}};
+static int dirty = 1;
+
+// The rest of the tracked state, only needed to put it back after the warm-up
+static GLfloat alpha_ref = 0.0f;
+static GLsizei strides[ARRAY_COUNT];
+static const void *pointers[ARRAY_COUNT];
+
+static ffp_state states[FFP_CACHE_MAX_STATES];
+static int16_t slots[FFP_CACHE_SLOTS]; // index + 1 into states, 0 when free
+static int num_states = 0;
+
+static int cap_bit(GLenum cap) {
+  for (int i = 0; i < sizeof(ffp_caps) / sizeof(*ffp_caps); i++) {
+    if (ffp_caps[i] == cap)
+      return 1 << i;
+  }
+  return 0;
+}
+
+static int array_index(GLenum array) {
+  for (int i = 0; i < ARRAY_COUNT; i++) {
+    if (ffp_arrays[i] == array)
+      return i;
+  }
+  return -1;
+}
+
+static uint32_t state_hash(const ffp_state *s) {
+  const uint8_t *p = (const uint8_t *)s;
+  uint32_t h = 0x811C9DC5;
+  for (int i = 0; i < sizeof(*s); i++) {
+    h ^= p[i];
+    h *= 0x01000193;
+  }
+  return h;
+}
+
+// Returns 1 if the state was not known yet
+static int insert_state(const ffp_state *s) {
+  uint32_t slot = state_hash(s) % FFP_CACHE_SLOTS;
+  while (slots[slot]) {
+    if (!memcmp(&states[slots[slot] - 1], s, sizeof(*s)))
+      return 0;
+    slot = (slot + 1) % FFP_CACHE_SLOTS;
+  }
+  if (num_states == FFP_CACHE_MAX_STATES)
+    return 0;
+  states[num_states++] = *s;
+  slots[slot] = num_states;
+  return 1;
+}
+
+void ffp_cache_enable(GLenum cap, GLboolean on) {
+  int bit = cap_bit(cap);
+  if (bit) {
+    cur.caps = on ? (cur.caps | bit) : (cur.caps & ~bit);
+    dirty = 1;
+  }
+}
+
+void ffp_cache_client_state(GLenum array, GLboolean on) {
+  int i = array_index(array);
+  if (i >= 0) {
+    cur.arrays = on ? (cur.arrays | (1 << i)) : (cur.arrays & ~(1 << i));
+    dirty = 1;
+  }
+}
+
+void ffp_cache_alpha_func(GLenum func, GLfloat ref) {
+  cur.alpha_func = func - GL_NEVER;
+  alpha_ref = ref;
+  dirty = 1;
+}
+
+void ffp_cache_fog_mode(GLenum mode) {
+  cur.fog_mode = mode;
+  dirty = 1;
+}
+
+void ffp_cache_pointer(GLenum array, GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  int i = array_index(array);
+  if (i < 0)
+    return;
+  strides[i] = stride;
+  pointers[i] = pointer;
+  if (cur.size[i] != size || cur.type[i] != type) {
+    cur.size[i] = size;
+    cur.type[i] = type;
+    dirty = 1;
+  }
+}
+
+void ffp_cache_draw(void) {
+  if (!dirty)
+    return;
+  dirty = 0;
+
+  // Layouts of disabled arrays don't reach the shader
+  ffp_state key;
+  memset(&key, 0, sizeof(key));
+  key.caps = cur.caps;
+  key.arrays = cur.arrays;
+  key.alpha_func = cur.alpha_func;
+  key.fog_mode = cur.fog_mode;
+  for (int i = 0; i < ARRAY_COUNT; i++) {
+    if (cur.arrays & (1 << i)) {
+      key.size[i] = cur.size[i];
+      key.type[i] = cur.type[i];
+    }
+  }
+  if (!insert_state(&key))
+    return;
+
+  FILE *f = fopen(FFP_CACHE_FILE, "ab");
+  if (f) {
+    fseek(f, 0, SEEK_END);
+    if (ftell(f) == 0) {
+      uint32_t hdr[2] = {FFP_CACHE_MAGIC, sizeof(ffp_state)};
+      fwrite(hdr, sizeof(hdr), 1, f);
+    }
+    fwrite(&key, sizeof(key), 1, f);
+    fclose(f);
+  }
+}
+
+static void apply_state(const ffp_state *s, GLfloat ref, const GLsizei *stride, const void **data) {
+  for (int i = 0; i < sizeof(ffp_caps) / sizeof(*ffp_caps); i++) {
+    if (s->caps & (1 << i))
+      glEnable(ffp_caps[i]);
+    else
+      glDisable(ffp_caps[i]);
+  }
+  for (int i = 0; i < ARRAY_COUNT; i++) {
+    if (s->arrays & (1 << i))
+      glEnableClientState(ffp_arrays[i]);
+    else
+      glDisableClientState(ffp_arrays[i]);
+  }
+  glAlphaFunc(GL_NEVER + s->alpha_func, ref);
+  glFogf(GL_FOG_MODE, s->fog_mode);
+  glVertexPointer(s->size[ARRAY_VERTEX], s->type[ARRAY_VERTEX], stride[ARRAY_VERTEX], data[ARRAY_VERTEX]);
+  glColorPointer(s->size[ARRAY_COLOR], s->type[ARRAY_COLOR], stride[ARRAY_COLOR], data[ARRAY_COLOR]);
+  glTexCoordPointer(s->size[ARRAY_TEXCOORD], s->type[ARRAY_TEXCOORD], stride[ARRAY_TEXCOORD], data[ARRAY_TEXCOORD]);
+  glNormalPointer(s->type[ARRAY_NORMAL], stride[ARRAY_NORMAL], data[ARRAY_NORMAL]);
+}
+
+void ffp_cache_warmup(void) {
+  FILE *f = fopen(FFP_CACHE_FILE, "rb");
+  if (!f)
+    return;
+
+  uint32_t hdr[2];
+  ffp_state s;
+  if (fread(hdr, sizeof(hdr), 1, f) == 1 && hdr[0] == FFP_CACHE_MAGIC && hdr[1] == sizeof(ffp_state)) {
+    while (fread(&s, sizeof(s), 1, f) == 1)
+      insert_state(&s);
+  }
+  fclose(f);
+  if (!num_states)
+    return;
+
+  uint64_t start = sceKernelGetProcessTimeWide();
+
+  // Three vertices at the origin in every layout, so nothing gets rasterized
+  static const uint32_t zero[16] = {0};
+  static const uint32_t white = 0xFFFFFFFF;
+  static const GLsizei zero_strides[ARRAY_COUNT] = {0};
+  const void *zero_pointers[ARRAY_COUNT] = {zero, zero, zero, zero};
+  GLuint tex;
+  glGenTextures(1, &tex);
+  glBindTexture(GL_TEXTURE_2D, tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white);
+
+  for (int i = 0; i < num_states; i++) {
+    apply_state(&states[i], 0.0f, zero_strides, zero_pointers);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+  }
+
+  // Leave whatever the game set up during its init as it was
+  apply_state(&cur, alpha_ref, strides, pointers);
+  tex_stage_resync();
+  glDeleteTextures(1, &tex);
+  dirty = 1;
+
+  printf("Warmed up %d fixed function states in %llu ms\n", num_states, (sceKernelGetProcessTimeWide() - start) / 1000);
+}
+
+int ffp_cache_get_count(void) {
+  return num_states;
+}
@@ -0,0 +1,19 @@
+#ifndef __FFP_CACHE_H__
+#define __FFP_CACHE_H__
+
+#include <vitaGL.h>
+
+#define FFP_CACHE_FILE DATA_PATH "/ffp_states.bin"
+#define FFP_CACHE_MAX_STATES 256
+
+void ffp_cache_enable(GLenum cap, GLboolean on);
+void ffp_cache_client_state(GLenum array, GLboolean on);
+void ffp_cache_alpha_func(GLenum func, GLfloat ref);
+void ffp_cache_fog_mode(GLenum mode);
+void ffp_cache_pointer(GLenum array, GLint size, GLenum type, GLsizei stride, const void *pointer);
+void ffp_cache_draw(void);
+
+void ffp_cache_warmup(void);
+int ffp_cache_get_count(void);
+
+#endif
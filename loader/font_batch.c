@@ -0,0 +1,129 @@
+/* font_batch.c -- whole-string glyph rasterization
+ *
+ * The game asks drawFont() for one character at a time. The characters it
+ * requests back to back at one size are recorded as a string, which ends
+ * when the size changes, the game pauses for FONT_BATCH_GAP_US or the frame
+ * is swapped. Strings are remembered by their whole text. Once the
+ * characters requested so far match the start of a remembered string, the
+ * glyphs of it missing from the glyph cache are rasterized ahead into the
+ * cache, FONT_BATCH_GLYPHS_PER_CALL at most per drawFont() call so no call
+ * stalls, and the following calls become plain cache hits, this frame and
+ * the next ones.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "font_batch.h"
+#include "glyph_atlas.h"
+
+typedef struct {
+  uint32_t hash;
+  int size;
+  int num;
+  uint32_t *cp;
+} font_run;
+
+static font_run runs[FONT_BATCH_RUNS];
+static int next_run = 0;
+
+// String being recorded
+static uint32_t run_cp[FONT_BATCH_MAX_CHARS];
+static int run_chars = 0, run_size = 0;
+static uint64_t run_last = 0;
+
+// Remembered string the one being recorded follows, already rasterized
+static font_run *active = NULL;
+static int ahead = 0; // code points of active gone through by font_batch_rasterize()
+static font_batch_stats stats;
+
+static uint32_t run_hash(const uint32_t *cp, int num, int size) {
+  uint32_t h = 2166136261u ^ (uint32_t)size;
+  for (int i = 0; i < num; i++)
+    h = (h ^ cp[i]) * 16777619u;
+  return h;
+}
+
+// Goes through codepoints until max glyphs missing from the cache got rasterized, returns how many it went through
+int font_batch_rasterize(const stbtt_fontinfo *info, const uint32_t *codepoints, int num, int size, int max) {
+  int i, n = 0;
+  for (i = 0; i < num && n < max; i++) {
+    // Peeking leaves the hit rate to the lookup drawFont() does
+    uint32_t cp = codepoints[i];
+    if (glyph_cache_peek(cp, size) || glyph_atlas_fetch(cp, size))
+      continue;
+    if (!glyph_cache_rasterize(info, cp, size))
+      break;
+    n++;
+  }
+  stats.rasterized += n;
+  return i;
+}
+
+static void end_run(void) {
+  // A string of two characters or less has nothing left to rasterize once recognized
+  if (run_chars > 2) {
+    uint32_t hash = run_hash(run_cp, run_chars, run_size);
+    font_run *r = NULL;
+    for (int i = 0; i < FONT_BATCH_RUNS && !r; i++) {
+      if (runs[i].cp && runs[i].hash == hash && runs[i].size == run_size && runs[i].num == run_chars &&
+          !memcmp(runs[i].cp, run_cp, run_chars * sizeof(uint32_t)))
+        r = &runs[i];
+    }
+    if (!r) {
+      r = &runs[next_run];
+      next_run = (next_run + 1) % FONT_BATCH_RUNS;
+      free(r->cp);
+      r->cp = malloc(run_chars * sizeof(uint32_t));
+      if (r->cp) {
+        memcpy(r->cp, run_cp, run_chars * sizeof(uint32_t));
+        r->hash = hash;
+        r->size = run_size;
+        r->num = run_chars;
+      }
+    }
+  }
+  run_chars = 0;
+  active = NULL;
+}
+
+static int follows(const font_run *r) {
+  return r->size == run_size && r->num > run_chars && !memcmp(r->cp, run_cp, run_chars * sizeof(uint32_t));
+}
+
+void font_batch_next(const stbtt_fontinfo *info, uint32_t codepoint, int size, uint64_t now) {
+  if (run_chars && (size != run_size || now - run_last > FONT_BATCH_GAP_US || run_chars == FONT_BATCH_MAX_CHARS))
+    end_run();
+  run_last = now;
+  run_size = size;
+  run_cp[run_chars++] = codepoint;
+
+  if (run_chars < 2)
+    return;
+
+  if (!active || !follows(active)) {
+    // Left the remembered string or none yet, look for one starting with everything requested so far
+    active = NULL;
+    for (int i = 0; i < FONT_BATCH_RUNS && !active; i++) {
+      if (runs[i].cp && follows(&runs[i]))
+        active = &runs[i];
+    }
+    if (!active)
+      return;
+    stats.batches++;
+    ahead = run_chars - 1;
+  }
+
+  // Spread the rest of the string over the following calls rather than stalling this one
+  if (ahead < run_chars - 1)
+    ahead = run_chars - 1;
+  ahead += font_batch_rasterize(info, &active->cp[ahead], active->num - ahead, size, FONT_BATCH_GLYPHS_PER_CALL);
+}
+
+void font_batch_end_frame(void) {
+  end_run();
+}
+
+void font_batch_get_stats(font_batch_stats *out) {
+  *out = stats;
+}
@@ -0,0 +1,24 @@
+#ifndef __FONT_BATCH_H__
+#define __FONT_BATCH_H__
+
+#include <stdint.h>
+
+#include "glyph_cache.h"
+
+#define FONT_BATCH_MAX_CHARS 128
+#define FONT_BATCH_RUNS 64
+#define FONT_BATCH_GAP_US 2000 // pause between drawFont() calls ending a string
+#define FONT_BATCH_GLYPHS_PER_CALL 4 // glyphs rasterized ahead by each drawFont() call at most
+
+typedef struct {
+  uint32_t batches;        // remembered strings recognized
+  uint32_t rasterized;     // glyphs they put in the glyph cache ahead of drawFont()
+} font_batch_stats;
+
+int font_batch_rasterize(const stbtt_fontinfo *info, const uint32_t *codepoints, int num, int size, int max);
+
+void font_batch_next(const stbtt_fontinfo *info, uint32_t codepoint, int size, uint64_t now);
+void font_batch_end_frame(void);
+void font_batch_get_stats(font_batch_stats *stats);
+
+#endif
@@ -0,0 +1,287 @@
+/* font_source.c -- paged TrueType font loading
+ *
+ * Instead of reading the whole font in RAM, only the tables stb_truetype
+ * needs to map codepoints and compute metrics (cmap, head, hhea, hmtx, maxp)
+ * are loaded and rebuilt into a small synthetic font. Its glyf table is a
+ * tiny window the requested outline is paged into, through a block cache,
+ * right before stb_truetype looks at it; loca is rewritten (in long format)
+ * so that only the paged glyphs point inside the window.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "font_source.h"
+
+#define FONT_BLOCK_SIZE 4096
+#define FONT_NUM_BLOCKS 32
+#define FONT_GLYF_WINDOW (64 * 1024)
+#define FONT_MAX_PAGED 16
+
+enum {
+  TABLE_CMAP,
+  TABLE_HEAD,
+  TABLE_HHEA,
+  TABLE_HMTX,
+  TABLE_MAXP,
+  TABLE_LOCA,
+  TABLE_GLYF,
+  NUM_TABLES
+};
+
+static const char *table_tags[NUM_TABLES] = {"cmap", "head", "hhea", "hmtx", "maxp", "loca", "glyf"};
+
+typedef struct {
+  uint32_t index;
+  uint32_t last_use;
+  uint8_t data[FONT_BLOCK_SIZE];
+} font_block;
+
+static FILE *font_file = NULL;
+static unsigned char *font_data = NULL;
+static uint32_t *glyf_offsets = NULL; // original loca, numGlyphs + 1 entries
+static uint32_t glyf_base = 0;        // file offset of the original glyf table
+static uint32_t loca_off = 0;         // offsets inside font_data
+static uint32_t window_off = 0;
+static int num_glyphs = 0;
+
+static font_block blocks[FONT_NUM_BLOCKS];
+static uint32_t block_clock = 0;
+
+static int paged[FONT_MAX_PAGED * 2];
+static int num_paged = 0;
+static uint32_t prepared_codepoint = 0xFFFFFFFF;
+
+static font_source_stats stats;
+
+static inline uint16_t rd16(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t rd32(const uint8_t *p) {
+  return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline void wr16(uint8_t *p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v;
+}
+
+static inline void wr32(uint8_t *p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static int read_at(uint32_t offset, void *dst, uint32_t len) {
+  fseek(font_file, offset, SEEK_SET);
+  return fread(dst, 1, len, font_file) == len;
+}
+
+static font_block *get_block(uint32_t index) {
+  font_block *victim = &blocks[0];
+  for (int i = 0; i < FONT_NUM_BLOCKS; i++) {
+    if (blocks[i].last_use && blocks[i].index == index) {
+      blocks[i].last_use = ++block_clock;
+      stats.block_hits++;
+      return &blocks[i];
+    }
+    if (blocks[i].last_use < victim->last_use)
+      victim = &blocks[i];
+  }
+
+  stats.block_misses++;
+  fseek(font_file, index * FONT_BLOCK_SIZE, SEEK_SET);
+  fread(victim->data, 1, FONT_BLOCK_SIZE, font_file);
+  victim->index = index;
+  victim->last_use = ++block_clock;
+  return victim;
+}
+
+static void read_cached(uint32_t offset, uint8_t *dst, uint32_t len) {
+  while (len) {
+    font_block *b = get_block(offset / FONT_BLOCK_SIZE);
+    uint32_t start = offset % FONT_BLOCK_SIZE;
+    uint32_t chunk = FONT_BLOCK_SIZE - start < len ? FONT_BLOCK_SIZE - start : len;
+    memcpy(dst, &b->data[start], chunk);
+    dst += chunk;
+    offset += chunk;
+    len -= chunk;
+  }
+}
+
+unsigned char *font_source_open(const char *path) {
+  font_file = fopen(path, "rb");
+  if (!font_file)
+    return NULL;
+
+  fseek(font_file, 0, SEEK_END);
+  stats.file_size = ftell(font_file);
+
+  uint8_t offset_table[12];
+  if (!read_at(0, offset_table, 12) || rd32(offset_table) != 0x00010000)
+    goto fail; // CFF flavoured or collection, no glyf table to page
+
+  int num_records = rd16(&offset_table[4]);
+  uint8_t *dir = malloc(num_records * 16);
+  if (!dir)
+    goto fail;
+  if (!read_at(12, dir, num_records * 16)) {
+    free(dir);
+    goto fail;
+  }
+
+  uint32_t offsets[NUM_TABLES] = {0}, lengths[NUM_TABLES] = {0};
+  for (int i = 0; i < num_records; i++) {
+    for (int t = 0; t < NUM_TABLES; t++) {
+      if (!memcmp(&dir[i * 16], table_tags[t], 4)) {
+        offsets[t] = rd32(&dir[i * 16 + 8]);
+        lengths[t] = rd32(&dir[i * 16 + 12]);
+      }
+    }
+  }
+  free(dir);
+
+  for (int t = 0; t < NUM_TABLES; t++) {
+    if (!offsets[t])
+      goto fail;
+  }
+
+  uint8_t head[54], maxp[6];
+  if (!read_at(offsets[TABLE_HEAD], head, sizeof(head)) || !read_at(offsets[TABLE_MAXP], maxp, sizeof(maxp)))
+    goto fail;
+  num_glyphs = rd16(&maxp[4]);
+  int short_loca = rd16(&head[50]) == 0;
+  if (lengths[TABLE_LOCA] < (num_glyphs + 1) * (short_loca ? 2 : 4))
+    goto fail;
+
+  glyf_base = offsets[TABLE_GLYF];
+  glyf_offsets = malloc((num_glyphs + 1) * sizeof(uint32_t));
+  uint8_t *loca = malloc(lengths[TABLE_LOCA]);
+  if (!glyf_offsets || !loca || !read_at(offsets[TABLE_LOCA], loca, lengths[TABLE_LOCA])) {
+    free(loca);
+    goto fail;
+  }
+  for (int i = 0; i <= num_glyphs; i++) {
+    glyf_offsets[i] = short_loca ? rd16(&loca[i * 2]) * 2 : rd32(&loca[i * 4]);
+  }
+  free(loca);
+
+  // Synthetic font: offset table, directory, resident tables, long loca, glyf window
+  lengths[TABLE_LOCA] = (num_glyphs + 1) * 4;
+  lengths[TABLE_GLYF] = FONT_GLYF_WINDOW;
+  uint32_t table_pos[NUM_TABLES];
+  uint32_t size = 12 + NUM_TABLES * 16;
+  for (int t = 0; t < NUM_TABLES; t++) {
+    table_pos[t] = size;
+    size += (lengths[t] + 3) & ~3;
+  }
+
+  font_data = calloc(size, 1);
+  if (!font_data)
+    goto fail;
+  wr32(&font_data[0], 0x00010000);
+  wr16(&font_data[4], NUM_TABLES);
+  for (int t = 0; t < NUM_TABLES; t++) {
+    uint8_t *rec = &font_data[12 + t * 16];
+    memcpy(rec, table_tags[t], 4);
+    wr32(&rec[8], table_pos[t]);
+    wr32(&rec[12], lengths[t]);
+    if (t != TABLE_LOCA && t != TABLE_GLYF && !read_at(offsets[t], &font_data[table_pos[t]], lengths[t]))
+      goto fail;
+  }
+  wr16(&font_data[table_pos[TABLE_HEAD] + 50], 1); // indexToLocFormat: long
+
+  loca_off = table_pos[TABLE_LOCA];
+  window_off = table_pos[TABLE_GLYF];
+  stats.resident_size = size + (num_glyphs + 1) * sizeof(uint32_t) + sizeof(blocks);
+
+  return font_data;
+
+fail:
+  // The caller falls back to reading the whole font
+  free(font_data);
+  font_data = NULL;
+  free(glyf_offsets);
+  glyf_offsets = NULL;
+  fclose(font_file);
+  font_file = NULL;
+  return NULL;
+}
+
+static int collect_components(int gid, int *set, int num) {
+  for (int i = 0; i < num; i++) {
+    if (set[i] == gid)
+      return num;
+  }
+  if (num == FONT_MAX_PAGED || gid >= num_glyphs)
+    return num;
+  set[num++] = gid;
+
+  uint32_t len = glyf_offsets[gid + 1] - glyf_offsets[gid];
+  if (len < 10)
+    return num;
+
+  uint8_t hdr[2];
+  read_cached(glyf_base + glyf_offsets[gid], hdr, 2);
+  if ((int16_t)rd16(hdr) >= 0)
+    return num;
+
+  // Composite glyph, walk its components
+  uint32_t pos = glyf_base + glyf_offsets[gid] + 10;
+  uint16_t flags;
+  do {
+    uint8_t comp[4];
+    read_cached(pos, comp, 4);
+    flags = rd16(comp);
+    num = collect_components(rd16(&comp[2]), set, num);
+    pos += 4 + ((flags & 0x0001) ? 4 : 2);
+    if (flags & 0x0008)
+      pos += 2;
+    else if (flags & 0x0040)
+      pos += 4;
+    else if (flags & 0x0080)
+      pos += 8;
+  } while (flags & 0x0020);
+
+  return num;
+}
+
+static int cmp_int(const void *a, const void *b) {
+  return *(const int *)a - *(const int *)b;
+}
+
+void font_source_prepare(const stbtt_fontinfo *info, uint32_t codepoint) {
+  if (!font_data || codepoint == prepared_codepoint)
+    return;
+  prepared_codepoint = codepoint;
+
+  for (int i = 0; i < num_paged; i++) {
+    wr32(&font_data[loca_off + paged[i] * 4], 0);
+  }
+  num_paged = 0;
+
+  int set[FONT_MAX_PAGED];
+  int num = collect_components(stbtt_FindGlyphIndex(info, codepoint), set, 0);
+  qsort(set, num, sizeof(int), cmp_int);
+
+  uint32_t pos = 0;
+  for (int i = 0; i < num; i++) {
+    int gid = set[i];
+    uint32_t len = glyf_offsets[gid + 1] - glyf_offsets[gid];
+    if (pos + len > FONT_GLYF_WINDOW)
+      break;
+    read_cached(glyf_base + glyf_offsets[gid], &font_data[window_off + pos], len);
+    wr32(&font_data[loca_off + gid * 4], pos);
+    wr32(&font_data[loca_off + (gid + 1) * 4], pos + len);
+    paged[num_paged++] = gid;
+    paged[num_paged++] = gid + 1;
+    pos += len;
+  }
+}
+
+void font_source_get_stats(font_source_stats *out) {
+  *out = stats;
+}
@@ -0,0 +1,19 @@
+#ifndef __FONT_SOURCE_H__
+#define __FONT_SOURCE_H__
+
+#include <stdint.h>
+
+#include "stb_truetype.h"
+
+typedef struct {
+  uint32_t file_size;      // size of the font on storage
+  uint32_t resident_size;  // tables kept in RAM plus the outline window and block cache
+  uint32_t block_hits;
+  uint32_t block_misses;
+} font_source_stats;
+
+unsigned char *font_source_open(const char *path);
+void font_source_prepare(const stbtt_fontinfo *info, uint32_t codepoint);
+void font_source_get_stats(font_source_stats *stats);
+
+#endif
@@ -0,0 +1,108 @@
+/* frame_pacer.c -- deadline based pacing for getCurrentFrame()
+ *
+ * Frame n starts at ceil(n * 1000000 / fps) us of process time, the same
+ * frame numbering the old polling loop produced. Instead of waking up every
+ * millisecond to look at the clock, the caller sleeps once up to the exact
+ * deadline of the next frame. With FRAME_PACER_VBLANK_ALIGN, rates dividing
+ * the 60 Hz refresh wait for the vblank closest to the deadline instead, so
+ * frames start in step with the display. Changing the rate renumbers the
+ * last frame at the new rate, so the next deadline stays one frame away.
+ */
+
+#include <vitasdk.h>
+#include <stdio.h>
+
+#include "config.h"
+#include "frame_pacer.h"
+
+#define VBLANK_US 16667
+
+static int rate = 30;
+static uint64_t last_frame = 0;
+static uint64_t last_return = 0;
+static frame_pacer_stats stats;
+
+static inline uint64_t frame_deadline(uint64_t frame) {
+  return (frame * 1000000 + rate - 1) / rate;
+}
+
+void frame_pacer_set_rate(int fps) {
+  if (fps <= 0 || fps == rate)
+    return;
+
+  // Frame numbers depend on the rate, renumber the last frame so the next deadline is one frame away at the new one
+  rate = fps;
+  last_frame = sceKernelGetProcessTimeWide() * rate / 1000000;
+}
+
+int frame_pacer_get_rate(void) {
+  return rate;
+}
+
+uint64_t frame_pacer_wait(void) {
+  uint64_t now = sceKernelGetProcessTimeWide();
+  uint64_t frame = now * rate / 1000000;
+
+  if (frame <= last_frame) {
+    frame = last_frame + 1;
+    uint64_t deadline = frame_deadline(frame);
+    uint64_t wait_start = now;
+    int aligned = 0;
+#if FRAME_PACER_VBLANK_ALIGN
+    if (60 % rate == 0 && deadline - now > VBLANK_US / 2) {
+      // Sleep to half a refresh before the deadline, the next vblank is then the closest one
+      sceKernelDelayThread(deadline - now - VBLANK_US / 2);
+      sceDisplayWaitVblankStart();
+      now = sceKernelGetProcessTimeWide();
+      aligned = 1;
+    }
+#endif
+    while (!aligned && now < deadline) {
+      sceKernelDelayThread(deadline - now);
+      now = sceKernelGetProcessTimeWide();
+    }
+    stats.slept_us += now - wait_start;
+    // An aligned frame may start slightly ahead of its deadline, it still gets the frame number it was meant for
+    uint32_t over = now > deadline ? now - deadline : 0;
+    stats.overshoot[over / 100 < FRAME_PACER_BUCKETS ? over / 100 : FRAME_PACER_BUCKETS - 1]++;
+  } else {
+    stats.late++;
+  }
+
+  if (last_return) {
+    uint32_t ms = (now - last_return) / 1000;
+    stats.frame_time[ms < FRAME_PACER_BUCKETS ? ms : FRAME_PACER_BUCKETS - 1]++;
+    stats.last_frame_us = now - last_return;
+  }
+  stats.frames++;
+  last_return = now;
+  last_frame = frame;
+
+  return frame;
+}
+
+uint64_t frame_pacer_slept_us(void) {
+  return stats.slept_us;
+}
+
+void frame_pacer_get_stats(frame_pacer_stats *out) {
+  *out = stats;
+}
+
+void frame_pacer_dump(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return;
+
+  fprintf(f, "%u frames at %d fps, %u late\n\nframe time:\n", stats.frames, rate, stats.late);
+  for (int i = 0; i < FRAME_PACER_BUCKETS; i++) {
+    if (stats.frame_time[i])
+      fprintf(f, "%s%2d ms: %u\n", i == FRAME_PACER_BUCKETS - 1 ? ">=" : "  ", i, stats.frame_time[i]);
+  }
+  fprintf(f, "\novershoot:\n");
+  for (int i = 0; i < FRAME_PACER_BUCKETS; i++) {
+    if (stats.overshoot[i])
+      fprintf(f, "%s%4d us: %u\n", i == FRAME_PACER_BUCKETS - 1 ? ">=" : "  ", i * 100, stats.overshoot[i]);
+  }
+  fclose(f);
+}
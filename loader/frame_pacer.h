@@ -0,0 +1,25 @@
+#ifndef __FRAME_PACER_H__
+#define __FRAME_PACER_H__
+
+#include <stdint.h>
+
+#define FRAME_PACER_FILE DATA_PATH "/frame_pacing.txt"
+#define FRAME_PACER_BUCKETS 64 // frame time buckets are 1 ms wide, overshoot ones 100 us
+
+typedef struct {
+  uint32_t frames;
+  uint32_t late;                          // frames returned without sleeping, the game was behind
+  uint32_t last_frame_us;
+  uint64_t slept_us;                      // total time spent waiting for deadlines
+  uint32_t frame_time[FRAME_PACER_BUCKETS];
+  uint32_t overshoot[FRAME_PACER_BUCKETS];  // wake up time past the deadline
+} frame_pacer_stats;
+
+void frame_pacer_set_rate(int fps);
+int frame_pacer_get_rate(void);
+uint64_t frame_pacer_wait(void);
+uint64_t frame_pacer_slept_us(void);
+void frame_pacer_get_stats(frame_pacer_stats *stats);
+void frame_pacer_dump(const char *path);
+
+#endif
@@ -0,0 +1,257 @@
+/* gl_hooks.c -- interposers for the GL functions imported by libff4.so
+ */
+
+#include "draw_batch.h"
+#include "dyn_res.h"
+#include "ffp_cache.h"
+#include "gl_hooks.h"
+#include "gl_state.h"
+#include "matrix_stack.h"
+#include "tex_stage.h"
+
+void glAlphaFuncHook(GLenum func, GLfloat ref) {
+  if (!gl_state_alpha_func(func, ref))
+    return;
+  draw_batch_flush();
+  ffp_cache_alpha_func(func, ref);
+  glAlphaFunc(func, ref);
+}
+
+void glBindTextureHook(GLenum target, GLuint texture) {
+  if (!gl_state_bind_texture(target, texture))
+    return;
+  draw_batch_flush();
+  if (target == GL_TEXTURE_2D)
+    tex_stage_bind(texture);
+  glBindTexture(target, texture);
+}
+
+void glBlendFuncHook(GLenum sfactor, GLenum dfactor) {
+  if (!gl_state_blend_func(sfactor, dfactor))
+    return;
+  draw_batch_flush();
+  glBlendFunc(sfactor, dfactor);
+}
+
+void glColor4ubHook(GLubyte r, GLubyte g, GLubyte b, GLubyte a) {
+  if (!gl_state_color(r, g, b, a))
+    return;
+  draw_batch_flush();
+  glColor4ub(r, g, b, a);
+}
+
+void glCullFaceHook(GLenum mode) {
+  if (!gl_state_cull_face(mode))
+    return;
+  draw_batch_flush();
+  glCullFace(mode);
+}
+
+void glClearHook(GLbitfield mask) {
+  draw_batch_flush();
+  glClear(mask);
+}
+
+void glDeleteTexturesHook(GLsizei n, const GLuint *textures) {
+  draw_batch_flush();
+  for (int i = 0; i < n; i++) {
+    tex_stage_discard(textures[i], -1);
+  }
+  gl_state_delete_textures(n, textures);
+  glDeleteTextures(n, textures);
+}
+
+void glDepthFuncHook(GLenum func) {
+  if (!gl_state_depth_func(func))
+    return;
+  draw_batch_flush();
+  glDepthFunc(func);
+}
+
+void glDepthMaskHook(GLboolean flag) {
+  if (!gl_state_depth_mask(flag))
+    return;
+  draw_batch_flush();
+  glDepthMask(flag);
+}
+
+void gl_hooks_sync_matrices(void) {
+  static const GLenum modes[MATRIX_STACKS] = {GL_MODELVIEW, GL_PROJECTION, GL_TEXTURE};
+  uint32_t dirty = matrix_stack_dirty();
+  if (!dirty)
+    return;
+
+  // vitaGL is left in GL_MODELVIEW, nothing else sets its matrices
+  for (int i = MATRIX_STACKS - 1; i >= 0; i--) {
+    if (dirty & (1 << i)) {
+      glMatrixMode(modes[i]);
+      glLoadMatrixf(matrix_stack_top(i));
+    }
+  }
+  if (!(dirty & (1 << MATRIX_MODELVIEW)))
+    glMatrixMode(GL_MODELVIEW);
+  matrix_stack_clean(dirty);
+}
+
+void glDrawArraysHook(GLenum mode, GLint first, GLsizei count) {
+  gl_state_draw();
+  if (draw_batch_add(mode, first, count))
+    return;
+  gl_hooks_sync_matrices();
+  ffp_cache_draw();
+  tex_stage_flush_bound();
+  glDrawArrays(mode, first, count);
+}
+
+void glEnableHook(GLenum cap) {
+  if (!gl_state_enable(cap, GL_TRUE))
+    return;
+  draw_batch_flush();
+  ffp_cache_enable(cap, GL_TRUE);
+  glEnable(cap);
+}
+
+void glDisableHook(GLenum cap) {
+  if (!gl_state_enable(cap, GL_FALSE))
+    return;
+  draw_batch_flush();
+  ffp_cache_enable(cap, GL_FALSE);
+  glDisable(cap);
+}
+
+void glEnableClientStateHook(GLenum array) {
+  draw_batch_flush();
+  gl_state_client_state(array, GL_TRUE);
+  draw_batch_client_state(array, GL_TRUE);
+  ffp_cache_client_state(array, GL_TRUE);
+  glEnableClientState(array);
+}
+
+void glDisableClientStateHook(GLenum array) {
+  draw_batch_flush();
+  gl_state_client_state(array, GL_FALSE);
+  draw_batch_client_state(array, GL_FALSE);
+  ffp_cache_client_state(array, GL_FALSE);
+  glDisableClientState(array);
+}
+
+void glFogfHook(GLenum pname, GLfloat param) {
+  if (!gl_state_fog(pname, &param, 1))
+    return;
+  draw_batch_flush();
+  if (pname == GL_FOG_MODE)
+    ffp_cache_fog_mode((GLenum)param);
+  glFogf(pname, param);
+}
+
+void glFogfvHook(GLenum pname, const GLfloat *params) {
+  if (!gl_state_fog(pname, params, pname == GL_FOG_COLOR ? 4 : 1))
+    return;
+  draw_batch_flush();
+  if (pname == GL_FOG_MODE)
+    ffp_cache_fog_mode((GLenum)params[0]);
+  glFogfv(pname, params);
+}
+
+void glLightfvHook(GLenum light, GLenum pname, const GLfloat *params) {
+  draw_batch_flush();
+  // Positions and directions are taken in eye space with the current modelview
+  gl_hooks_sync_matrices();
+  glLightfv(light, pname, params);
+}
+
+void glLoadIdentityHook(void) {
+  draw_batch_matrix_op();
+  matrix_stack_load_identity();
+}
+
+void glLoadMatrixfHook(const GLfloat *m) {
+  draw_batch_matrix_op();
+  matrix_stack_load(m);
+}
+
+void glMaterialfvHook(GLenum face, GLenum pname, const GLfloat *params) {
+  draw_batch_flush();
+  glMaterialfv(face, pname, params);
+}
+
+void glMatrixModeHook(GLenum mode) {
+  if (!gl_state_matrix_mode(mode))
+    return;
+  matrix_stack_mode(mode == GL_PROJECTION ? MATRIX_PROJECTION : mode == GL_TEXTURE ? MATRIX_TEXTURE : MATRIX_MODELVIEW);
+}
+
+void glMultMatrixfHook(const GLfloat *m) {
+  draw_batch_matrix_op();
+  matrix_stack_mult(m);
+}
+
+void glOrthofHook(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat near, GLfloat far) {
+  draw_batch_matrix_op();
+  matrix_stack_ortho(left, right, bottom, top, near, far);
+}
+
+void glPopMatrixHook(void) {
+  draw_batch_matrix_op();
+  matrix_stack_pop();
+}
+
+void glPushMatrixHook(void) {
+  matrix_stack_push();
+}
+
+void glTranslatefHook(GLfloat x, GLfloat y, GLfloat z) {
+  draw_batch_matrix_op();
+  matrix_stack_translate(x, y, z);
+}
+
+void glVertexPointerHook(GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  ffp_cache_pointer(GL_VERTEX_ARRAY, size, type, stride, pointer);
+  draw_batch_pointer(GL_VERTEX_ARRAY, size, type, stride, pointer);
+  glVertexPointer(size, type, stride, pointer);
+}
+
+void glColorPointerHook(GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  ffp_cache_pointer(GL_COLOR_ARRAY, size, type, stride, pointer);
+  draw_batch_pointer(GL_COLOR_ARRAY, size, type, stride, pointer);
+  glColorPointer(size, type, stride, pointer);
+}
+
+void glTexCoordPointerHook(GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  ffp_cache_pointer(GL_TEXTURE_COORD_ARRAY, size, type, stride, pointer);
+  draw_batch_pointer(GL_TEXTURE_COORD_ARRAY, size, type, stride, pointer);
+  glTexCoordPointer(size, type, stride, pointer);
+}
+
+void glNormalPointerHook(GLenum type, GLsizei stride, const void *pointer) {
+  ffp_cache_pointer(GL_NORMAL_ARRAY, 3, type, stride, pointer);
+  draw_batch_pointer(GL_NORMAL_ARRAY, 3, type, stride, pointer);
+  glNormalPointer(type, stride, pointer);
+}
+
+void glTexImage2DHook(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels) {
+  draw_batch_flush();
+  // A full respecification supersedes whatever was still staged for this level
+  if (target == GL_TEXTURE_2D)
+    tex_stage_discard(tex_stage_get_bound(), level);
+  glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+void glTexSubImage2DHook(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels) {
+  // Pending draws sample the texture as it was
+  draw_batch_flush();
+  if (!tex_stage_sub_image(target, level, xoffset, yoffset, width, height, format, type, pixels)) {
+    tex_stage_flush_bound();
+    glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+  }
+}
+
+void glScissorHook(GLint x, GLint y, GLsizei width, GLsizei height) {
+  draw_batch_flush();
+  dyn_res_scissor(x, y, width, height);
+}
+
+void glViewportHook(GLint x, GLint y, GLsizei width, GLsizei height) {
+  draw_batch_flush();
+  dyn_res_viewport(x, y, width, height);
+}
@@ -0,0 +1,43 @@
+#ifndef __GL_HOOKS_H__
+#define __GL_HOOKS_H__
+
+#include <vitaGL.h>
+
+void glAlphaFuncHook(GLenum func, GLfloat ref);
+void glBindTextureHook(GLenum target, GLuint texture);
+void glBlendFuncHook(GLenum sfactor, GLenum dfactor);
+void glColor4ubHook(GLubyte r, GLubyte g, GLubyte b, GLubyte a);
+void glClearHook(GLbitfield mask);
+void glColorPointerHook(GLint size, GLenum type, GLsizei stride, const void *pointer);
+void glCullFaceHook(GLenum mode);
+void glDeleteTexturesHook(GLsizei n, const GLuint *textures);
+void glDepthFuncHook(GLenum func);
+void glDepthMaskHook(GLboolean flag);
+void glDisableHook(GLenum cap);
+void glDisableClientStateHook(GLenum array);
+void glDrawArraysHook(GLenum mode, GLint first, GLsizei count);
+void glEnableHook(GLenum cap);
+void glEnableClientStateHook(GLenum array);
+void glFogfHook(GLenum pname, GLfloat param);
+void glFogfvHook(GLenum pname, const GLfloat *params);
+void glLightfvHook(GLenum light, GLenum pname, const GLfloat *params);
+void glLoadIdentityHook(void);
+void glLoadMatrixfHook(const GLfloat *m);
+void glMaterialfvHook(GLenum face, GLenum pname, const GLfloat *params);
+void glMatrixModeHook(GLenum mode);
+void glMultMatrixfHook(const GLfloat *m);
+void glNormalPointerHook(GLenum type, GLsizei stride, const void *pointer);
+void glOrthofHook(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat near, GLfloat far);
+void glPopMatrixHook(void);
+void glPushMatrixHook(void);
+void glTranslatefHook(GLfloat x, GLfloat y, GLfloat z);
+void glTexCoordPointerHook(GLint size, GLenum type, GLsizei stride, const void *pointer);
+void glTexImage2DHook(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels);
+void glScissorHook(GLint x, GLint y, GLsizei width, GLsizei height);
+void glVertexPointerHook(GLint size, GLenum type, GLsizei stride, const void *pointer);
+void glViewportHook(GLint x, GLint y, GLsizei width, GLsizei height);
+void glTexSubImage2DHook(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+
+void gl_hooks_sync_matrices(void);
+
+#endif
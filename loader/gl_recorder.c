@@ -0,0 +1,518 @@
+/* gl_recorder.c -- capture of the GL calls made by libff4.so
+ *
+ * Built with -DGL_RECORDER=ON, the GL imports of libff4.so resolve to the
+ * wrappers below, which forward to the usual functions and, while a
+ * capture runs, append each call to a memory buffer in the gl_stream.h
+ * format. Draws carry the vertices they read and texture uploads their
+ * pixels, so tools/gl_replay can run the stream on its own. Textures
+ * uploaded before the capture are only referenced by name, and the client
+ * array setup is the only state written up front, the rest starts from
+ * what the capture sees being set.
+ *
+ * The buffer is written to GL_RECORDER_FILE once GL_RECORDER_FRAMES frames
+ * are captured, so the file I/O doesn't end up in the recorded timings.
+ */
+
+#include <vitasdk.h>
+#include <vitaGL.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "gl_hooks.h"
+#include "gl_recorder.h"
+#include "gl_stream.h"
+
+#define BUFFER_SIZE (GL_RECORDER_BUFFER_MB * 1024 * 1024)
+
+void glTexParameteriHook(GLenum target, GLenum pname, GLint param); // main.c
+
+static uint8_t *buf = NULL;
+static uint32_t buf_len = 0, frame_mark = 0;
+static int frames_left = 0, overflow = 0;
+
+static struct {
+  int enabled;
+  GLint size;
+  GLenum type;
+  GLsizei stride;
+  const uint8_t *pointer;
+} arrays[GL_STREAM_ARRAY_COUNT];
+
+static void put(const void *data, uint32_t size) {
+  if (overflow)
+    return;
+  if (buf_len + size > BUFFER_SIZE) {
+    overflow = 1;
+    return;
+  }
+  memcpy(&buf[buf_len], data, size);
+  buf_len += size;
+}
+
+static void put_u8(uint8_t v) {
+  put(&v, sizeof(v));
+}
+
+static void put_u32(uint32_t v) {
+  put(&v, sizeof(v));
+}
+
+static void put_f32(float v) {
+  put(&v, sizeof(v));
+}
+
+static void put_floats(const GLfloat *v, int n) {
+  put_u32(n);
+  put(v, n * sizeof(*v));
+}
+
+static void put_blob(const void *data, uint32_t size) {
+  put_u32(data ? size : 0);
+  if (data)
+    put(data, size);
+}
+
+static int array_index(GLenum array) {
+  switch (array) {
+  case GL_VERTEX_ARRAY:
+    return GL_STREAM_ARRAY_VERTEX;
+  case GL_COLOR_ARRAY:
+    return GL_STREAM_ARRAY_COLOR;
+  case GL_TEXTURE_COORD_ARRAY:
+    return GL_STREAM_ARRAY_TEXCOORD;
+  case GL_NORMAL_ARRAY:
+    return GL_STREAM_ARRAY_NORMAL;
+  default:
+    return -1;
+  }
+}
+
+static void put_pointer(int i) {
+  static const uint8_t ops[] = {GL_OP_VERTEX_POINTER, GL_OP_COLOR_POINTER, GL_OP_TEX_COORD_POINTER, GL_OP_NORMAL_POINTER};
+  put_u8(ops[i]);
+  if (i != GL_STREAM_ARRAY_NORMAL)
+    put_u32(arrays[i].size);
+  put_u32(arrays[i].type);
+  put_u32(arrays[i].stride);
+  put_u32((uintptr_t)arrays[i].pointer);
+}
+
+static void set_pointer(int i, GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  arrays[i].size = size;
+  arrays[i].type = type;
+  arrays[i].stride = stride;
+  arrays[i].pointer = pointer;
+  if (frames_left)
+    put_pointer(i);
+}
+
+void gl_recorder_start(int width, int height) {
+  if (frames_left)
+    return;
+
+  buf = malloc(BUFFER_SIZE);
+  if (!buf) {
+    printf("GL recorder: could not allocate %d MB\n", GL_RECORDER_BUFFER_MB);
+    return;
+  }
+  buf_len = 0;
+  overflow = 0;
+  frames_left = GL_RECORDER_FRAMES;
+
+  put_u32(GL_STREAM_MAGIC);
+  put_u32(GL_STREAM_VERSION);
+  put_u32(width);
+  put_u32(height);
+  frame_mark = buf_len;
+
+  // Client arrays are commonly set up once, the draws can't be replayed without them
+  static const GLenum names[] = {GL_VERTEX_ARRAY, GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY, GL_NORMAL_ARRAY};
+  for (int i = 0; i < GL_STREAM_ARRAY_COUNT; i++) {
+    if (arrays[i].pointer)
+      put_pointer(i);
+    if (arrays[i].enabled) {
+      put_u8(GL_OP_ENABLE_CLIENT_STATE);
+      put_u32(names[i]);
+    }
+  }
+}
+
+void gl_recorder_end_frame(uint32_t frame_us) {
+  if (!frames_left)
+    return;
+
+  put_u8(GL_OP_FRAME_END);
+  put_u32(frame_us);
+  if (!overflow)
+    frame_mark = buf_len;
+  if (--frames_left > 0 && !overflow)
+    return;
+
+  FILE *f = fopen(GL_RECORDER_FILE, "wb");
+  if (f) {
+    fwrite(buf, 1, frame_mark, f);
+    fclose(f);
+  }
+  printf("GL recorder: %u KB written to %s%s\n", frame_mark / 1024, GL_RECORDER_FILE,
+         overflow ? ", cut short by the buffer size" : "");
+  free(buf);
+  buf = NULL;
+  frames_left = 0;
+}
+
+void rec_glAlphaFunc(GLenum func, GLfloat ref) {
+  if (frames_left) {
+    put_u8(GL_OP_ALPHA_FUNC);
+    put_u32(func);
+    put_f32(ref);
+  }
+  glAlphaFuncHook(func, ref);
+}
+
+void rec_glBindTexture(GLenum target, GLuint texture) {
+  if (frames_left) {
+    put_u8(GL_OP_BIND_TEXTURE);
+    put_u32(target);
+    put_u32(texture);
+  }
+  glBindTextureHook(target, texture);
+}
+
+void rec_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+  if (frames_left) {
+    put_u8(GL_OP_BLEND_FUNC);
+    put_u32(sfactor);
+    put_u32(dfactor);
+  }
+  glBlendFuncHook(sfactor, dfactor);
+}
+
+void rec_glClear(GLbitfield mask) {
+  if (frames_left) {
+    put_u8(GL_OP_CLEAR);
+    put_u32(mask);
+  }
+  glClearHook(mask);
+}
+
+void rec_glClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+  if (frames_left) {
+    put_u8(GL_OP_CLEAR_COLOR);
+    put_f32(r);
+    put_f32(g);
+    put_f32(b);
+    put_f32(a);
+  }
+  glClearColor(r, g, b, a);
+}
+
+void rec_glColor4ub(GLubyte r, GLubyte g, GLubyte b, GLubyte a) {
+  if (frames_left) {
+    put_u8(GL_OP_COLOR4UB);
+    put_u8(r);
+    put_u8(g);
+    put_u8(b);
+    put_u8(a);
+  }
+  glColor4ubHook(r, g, b, a);
+}
+
+void rec_glColorPointer(GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  set_pointer(GL_STREAM_ARRAY_COLOR, size, type, stride, pointer);
+  glColorPointerHook(size, type, stride, pointer);
+}
+
+void rec_glCullFace(GLenum mode) {
+  if (frames_left) {
+    put_u8(GL_OP_CULL_FACE);
+    put_u32(mode);
+  }
+  glCullFaceHook(mode);
+}
+
+void rec_glDeleteTextures(GLsizei n, const GLuint *textures) {
+  if (frames_left) {
+    put_u8(GL_OP_DELETE_TEXTURES);
+    put_u32(n);
+    put(textures, n * sizeof(*textures));
+  }
+  glDeleteTexturesHook(n, textures);
+}
+
+void rec_glDepthFunc(GLenum func) {
+  if (frames_left) {
+    put_u8(GL_OP_DEPTH_FUNC);
+    put_u32(func);
+  }
+  glDepthFuncHook(func);
+}
+
+void rec_glDepthMask(GLboolean flag) {
+  if (frames_left) {
+    put_u8(GL_OP_DEPTH_MASK);
+    put_u8(flag);
+  }
+  glDepthMaskHook(flag);
+}
+
+void rec_glDisable(GLenum cap) {
+  if (frames_left) {
+    put_u8(GL_OP_DISABLE);
+    put_u32(cap);
+  }
+  glDisableHook(cap);
+}
+
+void rec_glDisableClientState(GLenum array) {
+  int i = array_index(array);
+  if (i >= 0)
+    arrays[i].enabled = 0;
+  if (frames_left) {
+    put_u8(GL_OP_DISABLE_CLIENT_STATE);
+    put_u32(array);
+  }
+  glDisableClientStateHook(array);
+}
+
+void rec_glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+  if (frames_left) {
+    uint8_t enabled = 0;
+    for (int i = 0; i < GL_STREAM_ARRAY_COUNT; i++) {
+      if (arrays[i].enabled && arrays[i].pointer)
+        enabled |= 1 << i;
+    }
+    put_u8(GL_OP_DRAW_ARRAYS);
+    put_u32(mode);
+    put_u32(first);
+    put_u32(count);
+    put_u8(enabled);
+    for (int i = 0; i < GL_STREAM_ARRAY_COUNT; i++) {
+      if (!(enabled & (1 << i)))
+        continue;
+      int size = (i == GL_STREAM_ARRAY_NORMAL ? 3 : arrays[i].size) * gl_stream_type_size(arrays[i].type);
+      int stride = arrays[i].stride ? arrays[i].stride : size;
+      put_u32(size * count);
+      for (int v = first; v < first + count; v++)
+        put(arrays[i].pointer + v * stride, size);
+    }
+  }
+  glDrawArraysHook(mode, first, count);
+}
+
+void rec_glEnable(GLenum cap) {
+  if (frames_left) {
+    put_u8(GL_OP_ENABLE);
+    put_u32(cap);
+  }
+  glEnableHook(cap);
+}
+
+void rec_glEnableClientState(GLenum array) {
+  int i = array_index(array);
+  if (i >= 0)
+    arrays[i].enabled = 1;
+  if (frames_left) {
+    put_u8(GL_OP_ENABLE_CLIENT_STATE);
+    put_u32(array);
+  }
+  glEnableClientStateHook(array);
+}
+
+void rec_glFogf(GLenum pname, GLfloat param) {
+  if (frames_left) {
+    put_u8(GL_OP_FOGF);
+    put_u32(pname);
+    put_f32(param);
+  }
+  glFogfHook(pname, param);
+}
+
+void rec_glFogfv(GLenum pname, const GLfloat *params) {
+  if (frames_left) {
+    put_u8(GL_OP_FOGFV);
+    put_u32(pname);
+    put_floats(params, gl_stream_param_count(pname));
+  }
+  glFogfvHook(pname, params);
+}
+
+void rec_glGenTextures(GLsizei n, GLuint *textures) {
+  glGenTextures(n, textures);
+  if (frames_left) {
+    put_u8(GL_OP_GEN_TEXTURES);
+    put_u32(n);
+    put(textures, n * sizeof(*textures));
+  }
+}
+
+GLenum rec_glGetError(void) {
+  if (frames_left)
+    put_u8(GL_OP_GET_ERROR);
+  return glGetError();
+}
+
+void rec_glLightfv(GLenum light, GLenum pname, const GLfloat *params) {
+  if (frames_left) {
+    put_u8(GL_OP_LIGHTFV);
+    put_u32(light);
+    put_u32(pname);
+    put_floats(params, gl_stream_param_count(pname));
+  }
+  glLightfvHook(light, pname, params);
+}
+
+void rec_glLoadIdentity(void) {
+  if (frames_left)
+    put_u8(GL_OP_LOAD_IDENTITY);
+  glLoadIdentityHook();
+}
+
+void rec_glLoadMatrixf(const GLfloat *m) {
+  if (frames_left) {
+    put_u8(GL_OP_LOAD_MATRIXF);
+    put(m, 16 * sizeof(*m));
+  }
+  glLoadMatrixfHook(m);
+}
+
+void rec_glMaterialfv(GLenum face, GLenum pname, const GLfloat *params) {
+  if (frames_left) {
+    put_u8(GL_OP_MATERIALFV);
+    put_u32(face);
+    put_u32(pname);
+    put_floats(params, gl_stream_param_count(pname));
+  }
+  glMaterialfvHook(face, pname, params);
+}
+
+void rec_glMatrixMode(GLenum mode) {
+  if (frames_left) {
+    put_u8(GL_OP_MATRIX_MODE);
+    put_u32(mode);
+  }
+  glMatrixModeHook(mode);
+}
+
+void rec_glMultMatrixf(const GLfloat *m) {
+  if (frames_left) {
+    put_u8(GL_OP_MULT_MATRIXF);
+    put(m, 16 * sizeof(*m));
+  }
+  glMultMatrixfHook(m);
+}
+
+void rec_glNormalPointer(GLenum type, GLsizei stride, const void *pointer) {
+  set_pointer(GL_STREAM_ARRAY_NORMAL, 3, type, stride, pointer);
+  glNormalPointerHook(type, stride, pointer);
+}
+
+void rec_glOrthof(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat near, GLfloat far) {
+  if (frames_left) {
+    put_u8(GL_OP_ORTHOF);
+    put_f32(left);
+    put_f32(right);
+    put_f32(bottom);
+    put_f32(top);
+    put_f32(near);
+    put_f32(far);
+  }
+  glOrthofHook(left, right, bottom, top, near, far);
+}
+
+void rec_glPopMatrix(void) {
+  if (frames_left)
+    put_u8(GL_OP_POP_MATRIX);
+  glPopMatrixHook();
+}
+
+void rec_glPushMatrix(void) {
+  if (frames_left)
+    put_u8(GL_OP_PUSH_MATRIX);
+  glPushMatrixHook();
+}
+
+void rec_glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+  if (frames_left) {
+    put_u8(GL_OP_SCISSOR);
+    put_u32(x);
+    put_u32(y);
+    put_u32(width);
+    put_u32(height);
+  }
+  glScissorHook(x, y, width, height);
+}
+
+void rec_glTranslatef(GLfloat x, GLfloat y, GLfloat z) {
+  if (frames_left) {
+    put_u8(GL_OP_TRANSLATEF);
+    put_f32(x);
+    put_f32(y);
+    put_f32(z);
+  }
+  glTranslatefHook(x, y, z);
+}
+
+void rec_glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  set_pointer(GL_STREAM_ARRAY_TEXCOORD, size, type, stride, pointer);
+  glTexCoordPointerHook(size, type, stride, pointer);
+}
+
+void rec_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels) {
+  if (frames_left) {
+    put_u8(GL_OP_TEX_IMAGE_2D);
+    put_u32(target);
+    put_u32(level);
+    put_u32(internalformat);
+    put_u32(width);
+    put_u32(height);
+    put_u32(border);
+    put_u32(format);
+    put_u32(type);
+    put_blob(pixels, gl_stream_image_size(format, type, width, height));
+  }
+  glTexImage2DHook(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+void rec_glTexParameteri(GLenum target, GLenum pname, GLint param) {
+  if (frames_left) {
+    put_u8(GL_OP_TEX_PARAMETERI);
+    put_u32(target);
+    put_u32(pname);
+    put_u32(param);
+  }
+  glTexParameteriHook(target, pname, param);
+}
+
+void rec_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels) {
+  if (frames_left) {
+    put_u8(GL_OP_TEX_SUB_IMAGE_2D);
+    put_u32(target);
+    put_u32(level);
+    put_u32(xoffset);
+    put_u32(yoffset);
+    put_u32(width);
+    put_u32(height);
+    put_u32(format);
+    put_u32(type);
+    put_blob(pixels, gl_stream_image_size(format, type, width, height));
+  }
+  glTexSubImage2DHook(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+void rec_glVertexPointer(GLint size, GLenum type, GLsizei stride, const void *pointer) {
+  set_pointer(GL_STREAM_ARRAY_VERTEX, size, type, stride, pointer);
+  glVertexPointerHook(size, type, stride, pointer);
+}
+
+void rec_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  if (frames_left) {
+    put_u8(GL_OP_VIEWPORT);
+    put_u32(x);
+    put_u32(y);
+    put_u32(width);
+    put_u32(height);
+  }
+  glViewportHook(x, y, width, height);
+}
@@ -0,0 +1,54 @@
+#ifndef __GL_RECORDER_H__
+#define __GL_RECORDER_H__
+
+#include <stdint.h>
+#include <vitaGL.h>
+
+#define GL_RECORDER_FILE DATA_PATH "/gl_stream.bin"
+#define GL_RECORDER_FRAMES 120     // frames captured per request
+#define GL_RECORDER_BUFFER_MB 32   // capture memory, the stream is cut at the last frame fitting in it
+#define GL_RECORDER_COMBO (SCE_CTRL_L1 | SCE_CTRL_R1 | SCE_CTRL_TRIANGLE)
+
+void gl_recorder_start(int width, int height);
+void gl_recorder_end_frame(uint32_t frame_us);
+
+void rec_glAlphaFunc(GLenum func, GLfloat ref);
+void rec_glBindTexture(GLenum target, GLuint texture);
+void rec_glBlendFunc(GLenum sfactor, GLenum dfactor);
+void rec_glClear(GLbitfield mask);
+void rec_glClearColor(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+void rec_glColor4ub(GLubyte r, GLubyte g, GLubyte b, GLubyte a);
+void rec_glColorPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+void rec_glCullFace(GLenum mode);
+void rec_glDeleteTextures(GLsizei n, const GLuint *textures);
+void rec_glDepthFunc(GLenum func);
+void rec_glDepthMask(GLboolean flag);
+void rec_glDisable(GLenum cap);
+void rec_glDisableClientState(GLenum array);
+void rec_glDrawArrays(GLenum mode, GLint first, GLsizei count);
+void rec_glEnable(GLenum cap);
+void rec_glEnableClientState(GLenum array);
+void rec_glFogf(GLenum pname, GLfloat param);
+void rec_glFogfv(GLenum pname, const GLfloat *params);
+void rec_glGenTextures(GLsizei n, GLuint *textures);
+GLenum rec_glGetError(void);
+void rec_glLightfv(GLenum light, GLenum pname, const GLfloat *params);
+void rec_glLoadIdentity(void);
+void rec_glLoadMatrixf(const GLfloat *m);
+void rec_glMaterialfv(GLenum face, GLenum pname, const GLfloat *params);
+void rec_glMatrixMode(GLenum mode);
+void rec_glMultMatrixf(const GLfloat *m);
+void rec_glNormalPointer(GLenum type, GLsizei stride, const void *pointer);
+void rec_glOrthof(GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat near, GLfloat far);
+void rec_glPopMatrix(void);
+void rec_glPushMatrix(void);
+void rec_glScissor(GLint x, GLint y, GLsizei width, GLsizei height);
+void rec_glTranslatef(GLfloat x, GLfloat y, GLfloat z);
+void rec_glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+void rec_glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void *pixels);
+void rec_glTexParameteri(GLenum target, GLenum pname, GLint param);
+void rec_glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+void rec_glVertexPointer(GLint size, GLenum type, GLsizei stride, const void *pointer);
+void rec_glViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+#endif
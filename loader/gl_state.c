@@ -0,0 +1,219 @@
+/* gl_state.c -- filter for the redundant state changes of libff4.so
+ *
+ * The game sets its fixed function state before every draw, whether it
+ * changed or not, and each call costs a trip through vitaGL's state
+ * validation. The hooks of gl_hooks.c ask this module first: it shadows
+ * the last value the game set and the call is dropped when it is the same.
+ *
+ * A value is only trusted once the game set it. The loader's own passes
+ * bind their textures after the game's frame, so the binding is forgotten
+ * at the end of each frame, and anything else touching the game's state
+ * behind the hooks (warm-up, movie playback) calls gl_state_invalidate().
+ */
+
+#include <vitasdk.h>
+#include <vitaGL.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "gl_state.h"
+
+#define KNOWN(x) (known & (1 << (x)))
+
+static const char *call_names[GL_STATE_CALLS] = {
+  "glEnable/glDisable", "glBindTexture", "glBlendFunc", "glDepthFunc", "glDepthMask",
+  "glAlphaFunc", "glCullFace", "glFog", "glColor4ub", "glMatrixMode"
+};
+
+static struct {
+  GLenum cap;
+  GLboolean on;
+} caps[GL_STATE_MAX_CAPS];
+static int num_caps = 0;
+
+static struct {
+  GLenum pname;
+  GLfloat params[4];
+} fog[8];
+static int num_fog = 0;
+
+static uint32_t known = 0; // GL_STATE_* bits of the values below
+static GLuint texture;
+static GLenum blend_src, blend_dst, depth_func, alpha_func, cull_face, matrix_mode;
+static GLboolean depth_mask, color_array;
+static GLfloat alpha_ref;
+static uint32_t color;
+
+static gl_state_stats cur, last;
+static uint64_t total_calls[GL_STATE_CALLS], total_filtered[GL_STATE_CALLS];
+static uint32_t frames = 0;
+
+// Counts the call, returns whether it must reach vitaGL
+static int gl_state_check(int call, int same) {
+  cur.calls[call]++;
+  if (KNOWN(call) && same) {
+    cur.filtered[call]++;
+    return 0;
+  }
+  known |= 1 << call;
+  return 1;
+}
+
+int gl_state_enable(GLenum cap, GLboolean on) {
+  cur.calls[GL_STATE_ENABLE]++;
+  for (int i = 0; i < num_caps; i++) {
+    if (caps[i].cap == cap) {
+      if (caps[i].on == on) {
+        cur.filtered[GL_STATE_ENABLE]++;
+        return 0;
+      }
+      caps[i].on = on;
+      return 1;
+    }
+  }
+  if (num_caps < GL_STATE_MAX_CAPS) {
+    caps[num_caps].cap = cap;
+    caps[num_caps++].on = on;
+  }
+  return 1;
+}
+
+int gl_state_bind_texture(GLenum target, GLuint tex) {
+  if (target != GL_TEXTURE_2D)
+    return 1;
+  if (!gl_state_check(GL_STATE_BIND_TEXTURE, texture == tex))
+    return 0;
+  texture = tex;
+  return 1;
+}
+
+int gl_state_blend_func(GLenum sfactor, GLenum dfactor) {
+  if (!gl_state_check(GL_STATE_BLEND_FUNC, blend_src == sfactor && blend_dst == dfactor))
+    return 0;
+  blend_src = sfactor;
+  blend_dst = dfactor;
+  return 1;
+}
+
+int gl_state_depth_func(GLenum func) {
+  if (!gl_state_check(GL_STATE_DEPTH_FUNC, depth_func == func))
+    return 0;
+  depth_func = func;
+  return 1;
+}
+
+int gl_state_depth_mask(GLboolean flag) {
+  if (!gl_state_check(GL_STATE_DEPTH_MASK, depth_mask == flag))
+    return 0;
+  depth_mask = flag;
+  return 1;
+}
+
+int gl_state_alpha_func(GLenum func, GLfloat ref) {
+  if (!gl_state_check(GL_STATE_ALPHA_FUNC, alpha_func == func && alpha_ref == ref))
+    return 0;
+  alpha_func = func;
+  alpha_ref = ref;
+  return 1;
+}
+
+int gl_state_cull_face(GLenum mode) {
+  if (!gl_state_check(GL_STATE_CULL_FACE, cull_face == mode))
+    return 0;
+  cull_face = mode;
+  return 1;
+}
+
+int gl_state_fog(GLenum pname, const GLfloat *params, int n) {
+  cur.calls[GL_STATE_FOG]++;
+  if (n > 4)
+    return 1;
+  for (int i = 0; i < num_fog; i++) {
+    if (fog[i].pname == pname) {
+      if (!memcmp(fog[i].params, params, n * sizeof(GLfloat))) {
+        cur.filtered[GL_STATE_FOG]++;
+        return 0;
+      }
+      memcpy(fog[i].params, params, n * sizeof(GLfloat));
+      return 1;
+    }
+  }
+  if (num_fog < sizeof(fog) / sizeof(*fog)) {
+    fog[num_fog].pname = pname;
+    memcpy(fog[num_fog++].params, params, n * sizeof(GLfloat));
+  }
+  return 1;
+}
+
+int gl_state_color(GLubyte r, GLubyte g, GLubyte b, GLubyte a) {
+  uint32_t c = r | g << 8 | b << 16 | a << 24;
+  if (!gl_state_check(GL_STATE_COLOR, color == c))
+    return 0;
+  color = c;
+  return 1;
+}
+
+int gl_state_matrix_mode(GLenum mode) {
+  if (!gl_state_check(GL_STATE_MATRIX_MODE, matrix_mode == mode))
+    return 0;
+  matrix_mode = mode;
+  return 1;
+}
+
+void gl_state_client_state(GLenum array, GLboolean on) {
+  if (array == GL_COLOR_ARRAY)
+    color_array = on;
+}
+
+void gl_state_delete_textures(GLsizei n, const GLuint *textures) {
+  // Deleting the bound texture binds 0 back
+  for (int i = 0; i < n; i++) {
+    if (textures[i] == texture)
+      known &= ~(1 << GL_STATE_BIND_TEXTURE);
+  }
+}
+
+void gl_state_draw(void) {
+  // The current color is undefined after a draw reading colors from an array
+  if (color_array)
+    known &= ~(1 << GL_STATE_COLOR);
+}
+
+void gl_state_invalidate(void) {
+  known = 0;
+  num_caps = 0;
+  num_fog = 0;
+}
+
+void gl_state_end_frame(void) {
+  known &= ~(1 << GL_STATE_BIND_TEXTURE);
+
+  for (int i = 0; i < GL_STATE_CALLS; i++) {
+    total_calls[i] += cur.calls[i];
+    total_filtered[i] += cur.filtered[i];
+  }
+  frames++;
+  last = cur;
+  memset(&cur, 0, sizeof(cur));
+}
+
+void gl_state_get_stats(gl_state_stats *stats) {
+  *stats = last;
+}
+
+void gl_state_dump(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f || !frames) {
+    if (f)
+      fclose(f);
+    return;
+  }
+
+  fprintf(f, "%u frames\n\n%-20s %12s %12s %10s\n", frames, "call", "per frame", "filtered", "share");
+  for (int i = 0; i < GL_STATE_CALLS; i++) {
+    fprintf(f, "%-20s %12.1f %12.1f %9.1f%%\n", call_names[i], (double)total_calls[i] / frames,
+            (double)total_filtered[i] / frames, total_calls[i] ? 100.0 * total_filtered[i] / total_calls[i] : 0.0);
+  }
+  fclose(f);
+}
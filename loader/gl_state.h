@@ -0,0 +1,49 @@
+#ifndef __GL_STATE_H__
+#define __GL_STATE_H__
+
+#include <stdint.h>
+#include <vitaGL.h>
+
+#define GL_STATE_FILE DATA_PATH "/gl_state.txt"
+#define GL_STATE_MAX_CAPS 16
+
+enum {
+  GL_STATE_ENABLE,      // glEnable / glDisable
+  GL_STATE_BIND_TEXTURE,
+  GL_STATE_BLEND_FUNC,
+  GL_STATE_DEPTH_FUNC,
+  GL_STATE_DEPTH_MASK,
+  GL_STATE_ALPHA_FUNC,
+  GL_STATE_CULL_FACE,
+  GL_STATE_FOG,         // glFogf / glFogfv
+  GL_STATE_COLOR,       // glColor4ub
+  GL_STATE_MATRIX_MODE,
+  GL_STATE_CALLS
+};
+
+typedef struct {
+  uint32_t calls[GL_STATE_CALLS];    // issued by the game during the last frame
+  uint32_t filtered[GL_STATE_CALLS]; // dropped as they wouldn't have changed anything
+} gl_state_stats;
+
+int gl_state_enable(GLenum cap, GLboolean on);
+int gl_state_bind_texture(GLenum target, GLuint texture);
+int gl_state_blend_func(GLenum sfactor, GLenum dfactor);
+int gl_state_depth_func(GLenum func);
+int gl_state_depth_mask(GLboolean flag);
+int gl_state_alpha_func(GLenum func, GLfloat ref);
+int gl_state_cull_face(GLenum mode);
+int gl_state_fog(GLenum pname, const GLfloat *params, int n);
+int gl_state_color(GLubyte r, GLubyte g, GLubyte b, GLubyte a);
+int gl_state_matrix_mode(GLenum mode);
+
+void gl_state_client_state(GLenum array, GLboolean on);
+void gl_state_delete_textures(GLsizei n, const GLuint *textures);
+void gl_state_draw(void);
+
+void gl_state_invalidate(void);
+void gl_state_end_frame(void);
+void gl_state_get_stats(gl_state_stats *stats);
+void gl_state_dump(const char *path);
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef __GL_STREAM_H__
+#define __GL_STREAM_H__
+
+/*
+ * Binary GL command stream written by gl_recorder.c and read by
+ * tools/gl_replay. Little endian, no padding:
+ *   header:  u32 magic, u32 version, u32 width, u32 height
+ *   command: u8 opcode, then its arguments as listed below
+ * Arrays of floats are preceded by their count, data blobs by their size
+ * in bytes. Client pointers are kept as plain addresses to tell them apart,
+ * the vertices a draw reads are stored with it, tightly packed, in
+ * vertex / color / texcoord / normal order for the arrays enabled.
+ */
+
+#include <stdint.h>
+
+#define GL_STREAM_MAGIC 0x47344646 // FF4G
+#define GL_STREAM_VERSION 1
+
+enum {
+  GL_OP_FRAME_END,            // u32 frame time in microseconds
+  GL_OP_ALPHA_FUNC,           // u32 func, f32 ref
+  GL_OP_BIND_TEXTURE,         // u32 target, u32 texture
+  GL_OP_BLEND_FUNC,           // u32 sfactor, u32 dfactor
+  GL_OP_CLEAR,                // u32 mask
+  GL_OP_CLEAR_COLOR,          // f32 r, g, b, a
+  GL_OP_COLOR4UB,             // u8 r, g, b, a
+  GL_OP_COLOR_POINTER,        // i32 size, u32 type, i32 stride, u32 pointer
+  GL_OP_CULL_FACE,            // u32 mode
+  GL_OP_DELETE_TEXTURES,      // i32 n, u32 textures[n]
+  GL_OP_DEPTH_FUNC,           // u32 func
+  GL_OP_DEPTH_MASK,           // u8 flag
+  GL_OP_DISABLE,              // u32 cap
+  GL_OP_DISABLE_CLIENT_STATE, // u32 array
+  GL_OP_DRAW_ARRAYS,          // u32 mode, i32 first, i32 count, u8 arrays, {u32 size, data} per array
+  GL_OP_ENABLE,               // u32 cap
+  GL_OP_ENABLE_CLIENT_STATE,  // u32 array
+  GL_OP_FOGF,                 // u32 pname, f32 param
+  GL_OP_FOGFV,                // u32 pname, u32 n, f32 params[n]
+  GL_OP_GEN_TEXTURES,         // i32 n, u32 textures[n] as returned
+  GL_OP_GET_ERROR,            //
+  GL_OP_LIGHTFV,              // u32 light, u32 pname, u32 n, f32 params[n]
+  GL_OP_LOAD_IDENTITY,        //
+  GL_OP_LOAD_MATRIXF,         // f32 m[16]
+  GL_OP_MATERIALFV,           // u32 face, u32 pname, u32 n, f32 params[n]
+  GL_OP_MATRIX_MODE,          // u32 mode
+  GL_OP_MULT_MATRIXF,         // f32 m[16]
+  GL_OP_NORMAL_POINTER,       // u32 type, i32 stride, u32 pointer
+  GL_OP_ORTHOF,               // f32 left, right, bottom, top, near, far
+  GL_OP_POP_MATRIX,           //
+  GL_OP_PUSH_MATRIX,          //
+  GL_OP_SCISSOR,              // i32 x, y, width, height
+  GL_OP_TRANSLATEF,           // f32 x, y, z
+  GL_OP_TEX_COORD_POINTER,    // i32 size, u32 type, i32 stride, u32 pointer
+  GL_OP_TEX_IMAGE_2D,         // u32 target, i32 level, internalformat, width, height, border, u32 format, type, {u32 size, data}
+  GL_OP_TEX_PARAMETERI,       // u32 target, u32 pname, i32 param
+  GL_OP_TEX_SUB_IMAGE_2D,     // u32 target, i32 level, x, y, width, height, u32 format, type, {u32 size, data}
+  GL_OP_VERTEX_POINTER,       // i32 size, u32 type, i32 stride, u32 pointer
+  GL_OP_VIEWPORT,             // i32 x, y, width, height
+  GL_OP_COUNT
+};
+
+enum {
+  GL_STREAM_ARRAY_VERTEX,
+  GL_STREAM_ARRAY_COLOR,
+  GL_STREAM_ARRAY_TEXCOORD,
+  GL_STREAM_ARRAY_NORMAL,
+  GL_STREAM_ARRAY_COUNT
+};
+
+// Number of floats glFogfv / glLightfv / glMaterialfv read for pname
+static inline int gl_stream_param_count(uint32_t pname) {
+  switch (pname) {
+  case 0x0B66: // GL_FOG_COLOR
+  case 0x1200: // GL_AMBIENT
+  case 0x1201: // GL_DIFFUSE
+  case 0x1202: // GL_SPECULAR
+  case 0x1203: // GL_POSITION
+  case 0x1600: // GL_EMISSION
+  case 0x1602: // GL_AMBIENT_AND_DIFFUSE
+    return 4;
+  case 0x1204: // GL_SPOT_DIRECTION
+    return 3;
+  default:
+    return 1;
+  }
+}
+
+static inline int gl_stream_type_size(uint32_t type) {
+  switch (type) {
+  case 0x1400: // GL_BYTE
+  case 0x1401: // GL_UNSIGNED_BYTE
+    return 1;
+  case 0x1402: // GL_SHORT
+  case 0x1403: // GL_UNSIGNED_SHORT
+    return 2;
+  default:     // GL_FLOAT, GL_FIXED
+    return 4;
+  }
+}
+
+// Bytes glTexImage2D / glTexSubImage2D read, rows padded to the default unpack alignment of 4
+static inline uint32_t gl_stream_image_size(uint32_t format, uint32_t type, int width, int height) {
+  int bpp;
+  if (type != 0x1401) // packed 16 bit formats
+    bpp = 2;
+  else if (format == 0x1908) // GL_RGBA
+    bpp = 4;
+  else if (format == 0x1907) // GL_RGB
+    bpp = 3;
+  else if (format == 0x190A) // GL_LUMINANCE_ALPHA
+    bpp = 2;
+  else
+    bpp = 1;
+  return ((width * bpp + 3) & ~3) * height;
+}
+
+#endif
@@ -0,0 +1,285 @@
+/* glyph_atlas.c -- pre-baked glyphs persisted to disk
+ *
+ * The atlas holds every glyph of a language's charset at the sizes drawFont()
+ * has been seen using. It is baked once (on device or with tools/atlas_baker)
+ * and then served to the glyph cache without touching stb_truetype. The
+ * coverage is compressed in pages of GLYPH_ATLAS_PAGE_GLYPHS glyphs which
+ * stay compressed in memory, only the few last used pages are inflated.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zlib.h"
+
+#include "glyph_atlas.h"
+
+typedef struct {
+  int page;
+  uint32_t last_use;
+  uint32_t alloc;
+  uint8_t *data;
+} page_slot;
+
+static uint8_t *atlas = NULL;
+static glyph_atlas_record *records = NULL;
+static glyph_atlas_page *pages = NULL;
+static uint8_t *packed = NULL;
+static int num_records = 0;
+static page_slot slots[GLYPH_ATLAS_PAGE_SLOTS];
+static uint32_t slot_clock = 0;
+
+static uint32_t font_checksum(const stbtt_fontinfo *info) {
+  const uint8_t *p = info->data + info->head + 8;
+  return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+int glyph_atlas_load(const char *path, const stbtt_fontinfo *info, uint32_t font_size) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return 0;
+
+  glyph_atlas_header hdr;
+  if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != GLYPH_ATLAS_MAGIC || hdr.version != GLYPH_ATLAS_VERSION ||
+      hdr.font_size != font_size || hdr.font_checksum != font_checksum(info)) {
+    fclose(f);
+    return 0;
+  }
+
+  uint32_t size = hdr.num_glyphs * sizeof(glyph_atlas_record) + hdr.num_pages * sizeof(glyph_atlas_page) + hdr.packed_size;
+  uint8_t *data = malloc(size);
+  if (!data || fread(data, 1, size, f) != size) {
+    free(data);
+    fclose(f);
+    return 0;
+  }
+  fclose(f);
+
+  free(atlas);
+  atlas = data;
+  records = (glyph_atlas_record *)atlas;
+  pages = (glyph_atlas_page *)&records[hdr.num_glyphs];
+  packed = (uint8_t *)&pages[hdr.num_pages];
+  num_records = hdr.num_glyphs;
+  for (int i = 0; i < GLYPH_ATLAS_PAGE_SLOTS; i++)
+    slots[i].page = -1;
+
+  return 1;
+}
+
+int glyph_atlas_has_size(int size) {
+  for (int i = 0; i < num_records; i++) {
+    if (records[i].size == size)
+      return 1;
+  }
+  return 0;
+}
+
+static int glyph_atlas_find(uint32_t codepoint, int size) {
+  int lo = 0, hi = num_records - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    const glyph_atlas_record *r = &records[mid];
+    if (r->size == size && r->codepoint == codepoint)
+      return mid;
+    if (r->size < size || (r->size == size && r->codepoint < codepoint))
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+  return -1;
+}
+
+static const uint8_t *glyph_atlas_page_data(int page) {
+  page_slot *slot = &slots[0];
+  for (int i = 0; i < GLYPH_ATLAS_PAGE_SLOTS; i++) {
+    if (slots[i].page == page) {
+      slots[i].last_use = ++slot_clock;
+      return slots[i].data;
+    }
+    if (slots[i].last_use < slot->last_use)
+      slot = &slots[i];
+  }
+
+  const glyph_atlas_page *p = &pages[page];
+  if (slot->alloc < p->raw_size) {
+    free(slot->data);
+    slot->data = malloc(p->raw_size);
+    slot->alloc = slot->data ? p->raw_size : 0;
+  }
+  uLongf raw_size = p->raw_size;
+  slot->page = -1;
+  if (!slot->data || uncompress(slot->data, &raw_size, &packed[p->offset], p->packed_size) != Z_OK ||
+      raw_size != p->raw_size)
+    return NULL;
+
+  slot->page = page;
+  slot->last_use = ++slot_clock;
+  return slot->data;
+}
+
+glyph_entry *glyph_atlas_fetch(uint32_t codepoint, int size) {
+  int idx = glyph_atlas_find(codepoint, size);
+  if (idx < 0)
+    return NULL;
+
+  const glyph_atlas_record *r = &records[idx];
+  const uint8_t *coverage = glyph_atlas_page_data(idx / GLYPH_ATLAS_PAGE_GLYPHS);
+  if (!coverage)
+    return NULL;
+
+  glyph_entry *g = glyph_cache_alloc(codepoint, size, r->w, r->h);
+  if (!g)
+    return NULL;
+  g->advance = r->advance;
+  g->x = r->x;
+  g->y = r->y;
+  memcpy(g->coverage, &coverage[r->offset], r->w * r->h);
+
+  return g;
+}
+
+static int cmp_int(const void *a, const void *b) {
+  return *(const int *)a - *(const int *)b;
+}
+
+static int cmp_codepoint(const void *a, const void *b) {
+  const charset_entry *ea = (const charset_entry *)a;
+  const charset_entry *eb = (const charset_entry *)b;
+  return ea->codepoint < eb->codepoint ? -1 : (ea->codepoint > eb->codepoint);
+}
+
+// Compresses the coverage of the page being baked and appends it to the packed streams
+static int pack_page(glyph_atlas_page *p, const uint8_t *cov, uint32_t cov_size, uint8_t **out, uint32_t *out_size,
+                     uint32_t *out_alloc) {
+  uLongf packed_size = compressBound(cov_size);
+  if (*out_size + packed_size > *out_alloc) {
+    uint32_t alloc = *out_alloc;
+    while (*out_size + packed_size > alloc)
+      alloc *= 2;
+    uint8_t *grown = realloc(*out, alloc);
+    if (!grown)
+      return 0;
+    *out = grown;
+    *out_alloc = alloc;
+  }
+  if (compress2(*out + *out_size, &packed_size, cov, cov_size, Z_BEST_COMPRESSION) != Z_OK)
+    return 0;
+
+  p->offset = *out_size;
+  p->packed_size = packed_size;
+  p->raw_size = cov_size;
+  *out_size += packed_size;
+  return 1;
+}
+
+int glyph_atlas_bake(const stbtt_fontinfo *info, const charset *cs, const int *sizes, int num_sizes, uint32_t font_size,
+                     const char *path, glyph_atlas_lock_fn lock) {
+  int sorted_sizes[num_sizes];
+  memcpy(sorted_sizes, sizes, num_sizes * sizeof(int));
+  qsort(sorted_sizes, num_sizes, sizeof(int), cmp_int);
+
+  // The charset may have been reordered by frequency, records must be sorted
+  charset_entry *cps = malloc(cs->num * sizeof(charset_entry));
+  if (cps) {
+    memcpy(cps, cs->entries, cs->num * sizeof(charset_entry));
+    qsort(cps, cs->num, sizeof(charset_entry), cmp_codepoint);
+  }
+
+  int max_records = cs->num * num_sizes;
+  glyph_atlas_record *recs = malloc(max_records * sizeof(glyph_atlas_record));
+  glyph_atlas_page *pgs = malloc((max_records / GLYPH_ATLAS_PAGE_GLYPHS + 1) * sizeof(glyph_atlas_page));
+  uint32_t cov_size = 0, cov_alloc = 64 * 1024;
+  uint8_t *cov = malloc(cov_alloc);
+  uint32_t out_size = 0, out_alloc = 256 * 1024;
+  uint8_t *out = malloc(out_alloc);
+  int n = 0, num_pages = 0, ok = cps && recs && pgs && cov && out;
+
+  if (lock)
+    lock(1);
+  uint32_t checksum = font_checksum(info);
+  if (lock)
+    lock(0);
+
+  for (int s = 0; s < num_sizes && ok; s++) {
+    if (s && sorted_sizes[s] == sorted_sizes[s - 1])
+      continue;
+    for (int i = 0; i < cs->num && ok; i++) {
+      uint32_t cp = cps[i].codepoint;
+      glyph_entry g;
+      if (lock)
+        lock(1);
+      int found = cp == 32 || stbtt_FindGlyphIndex(info, cp);
+      if (found) {
+        glyph_measure(info, cp, sorted_sizes[s], &g);
+        if (cov_size + g.w * g.h > cov_alloc) {
+          uint32_t alloc = cov_alloc;
+          while (cov_size + g.w * g.h > alloc)
+            alloc *= 2;
+          uint8_t *grown = realloc(cov, alloc);
+          if (grown) {
+            cov = grown;
+            cov_alloc = alloc;
+          } else {
+            ok = 0;
+          }
+        }
+        if (ok)
+          glyph_render(info, &g, &cov[cov_size]);
+      }
+      if (lock)
+        lock(0);
+      if (!found || !ok)
+        continue;
+
+      glyph_atlas_record *r = &recs[n++];
+      r->codepoint = cp;
+      r->size = sorted_sizes[s];
+      r->advance = g.advance;
+      r->x = g.x;
+      r->y = g.y;
+      r->w = g.w;
+      r->h = g.h;
+      r->offset = cov_size;
+      cov_size += g.w * g.h;
+
+      if (n % GLYPH_ATLAS_PAGE_GLYPHS == 0) {
+        ok = pack_page(&pgs[num_pages++], cov, cov_size, &out, &out_size, &out_alloc);
+        cov_size = 0;
+      }
+    }
+  }
+  if (ok && n % GLYPH_ATLAS_PAGE_GLYPHS)
+    ok = pack_page(&pgs[num_pages++], cov, cov_size, &out, &out_size, &out_alloc);
+  free(cps);
+  free(cov);
+
+  FILE *f = ok ? fopen(path, "wb") : NULL;
+  if (f) {
+    glyph_atlas_header hdr;
+    hdr.magic = GLYPH_ATLAS_MAGIC;
+    hdr.version = GLYPH_ATLAS_VERSION;
+    hdr.font_size = font_size;
+    hdr.font_checksum = checksum;
+    hdr.num_glyphs = n;
+    hdr.num_pages = num_pages;
+    hdr.packed_size = out_size;
+    ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+         fwrite(recs, sizeof(glyph_atlas_record), n, f) == n &&
+         fwrite(pgs, sizeof(glyph_atlas_page), num_pages, f) == num_pages &&
+         fwrite(out, 1, out_size, f) == out_size;
+    if (fclose(f) != 0)
+      ok = 0;
+  }
+  free(recs);
+  free(pgs);
+  free(out);
+
+  // Don't leave a truncated atlas around for the next boot
+  if (!ok || !f) {
+    remove(path);
+    return 0;
+  }
+  return n;
+}
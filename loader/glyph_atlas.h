@@ -0,0 +1,50 @@
+#ifndef __GLYPH_ATLAS_H__
+#define __GLYPH_ATLAS_H__
+
+#include <stdint.h>
+
+#include "charset.h"
+#include "glyph_cache.h"
+
+#define GLYPH_ATLAS_MAGIC 0x41474646 // FFGA
+#define GLYPH_ATLAS_VERSION 2
+#define GLYPH_ATLAS_PAGE_GLYPHS 64   // glyphs compressed together
+#define GLYPH_ATLAS_PAGE_SLOTS 4     // pages kept inflated at once
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t font_size;     // size in bytes of the font the atlas was baked from
+  uint32_t font_checksum; // checkSumAdjustment of its head table, a checksum of the whole file
+  uint32_t num_glyphs;
+  uint32_t num_pages;
+  uint32_t packed_size;   // size of the zlib streams following the page table
+} glyph_atlas_header;
+
+// Records are sorted by (size, codepoint), offset is within the page of the record
+typedef struct {
+  uint32_t codepoint;
+  uint16_t size;
+  int16_t advance;
+  int16_t x, y;
+  uint16_t w, h;
+  uint32_t offset;
+} glyph_atlas_record;
+
+// Page n holds the coverage of records n * GLYPH_ATLAS_PAGE_GLYPHS and onwards as one zlib stream
+typedef struct {
+  uint32_t offset;
+  uint32_t packed_size;
+  uint32_t raw_size;
+} glyph_atlas_page;
+
+// Called with 1 before and 0 after each glyph rendered by glyph_atlas_bake()
+typedef void (*glyph_atlas_lock_fn)(int lock);
+
+int glyph_atlas_load(const char *path, const stbtt_fontinfo *info, uint32_t font_size);
+int glyph_atlas_has_size(int size);
+int glyph_atlas_bake(const stbtt_fontinfo *info, const charset *cs, const int *sizes, int num_sizes, uint32_t font_size,
+                     const char *path, glyph_atlas_lock_fn lock);
+glyph_entry *glyph_atlas_fetch(uint32_t codepoint, int size);
+
+#endif
@@ -0,0 +1,221 @@
+/* glyph_cache.c -- LRU cache of rasterized glyphs for drawFont()
+ *
+ * Entries are keyed by (codepoint, pixel size) and keep the coverage box
+ * produced by stb_truetype together with the metrics drawFont() reports, so
+ * a repeated request only has to expand the coverage to RGBA.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "config.h"
+#include "font_source.h"
+#include "glyph_cache.h"
+
+#define GLYPH_CACHE_BUCKETS 1024
+
+static glyph_entry *buckets[GLYPH_CACHE_BUCKETS];
+static glyph_entry *lru_head = NULL; // most recently used
+static glyph_entry *lru_tail = NULL;
+static glyph_cache_stats stats;
+
+static inline uint32_t glyph_hash(uint32_t codepoint, int size) {
+  return (codepoint * 2654435761u ^ (uint32_t)size * 40503u) % GLYPH_CACHE_BUCKETS;
+}
+
+static inline uint32_t glyph_bytes(const glyph_entry *g) {
+  return sizeof(glyph_entry) + g->w * g->h;
+}
+
+static void lru_unlink(glyph_entry *g) {
+  if (g->lru_prev)
+    g->lru_prev->lru_next = g->lru_next;
+  else
+    lru_head = g->lru_next;
+  if (g->lru_next)
+    g->lru_next->lru_prev = g->lru_prev;
+  else
+    lru_tail = g->lru_prev;
+}
+
+static void lru_push_front(glyph_entry *g) {
+  g->lru_prev = NULL;
+  g->lru_next = lru_head;
+  if (lru_head)
+    lru_head->lru_prev = g;
+  lru_head = g;
+  if (!lru_tail)
+    lru_tail = g;
+}
+
+static void glyph_cache_evict(glyph_entry *g) {
+  glyph_entry **p = &buckets[glyph_hash(g->codepoint, g->size)];
+  while (*p != g)
+    p = &(*p)->hash_next;
+  *p = g->hash_next;
+
+  lru_unlink(g);
+  stats.bytes -= glyph_bytes(g);
+  stats.entries--;
+  stats.evictions++;
+  free(g);
+}
+
+glyph_entry *glyph_cache_peek(uint32_t codepoint, int size) {
+  for (glyph_entry *g = buckets[glyph_hash(codepoint, size)]; g; g = g->hash_next) {
+    if (g->codepoint == codepoint && g->size == size)
+      return g;
+  }
+  return NULL;
+}
+
+glyph_entry *glyph_cache_lookup(uint32_t codepoint, int size) {
+  for (glyph_entry *g = buckets[glyph_hash(codepoint, size)]; g; g = g->hash_next) {
+    if (g->codepoint == codepoint && g->size == size) {
+      if (g != lru_head) {
+        lru_unlink(g);
+        lru_push_front(g);
+      }
+      stats.hits++;
+      return g;
+    }
+  }
+  stats.misses++;
+  return NULL;
+}
+
+glyph_entry *glyph_cache_alloc(uint32_t codepoint, int size, int w, int h) {
+  uint32_t bytes = sizeof(glyph_entry) + w * h;
+  while (lru_tail && stats.bytes + bytes > GLYPH_CACHE_MAX_KB * 1024)
+    glyph_cache_evict(lru_tail);
+
+  glyph_entry *g = malloc(bytes);
+  if (!g)
+    return NULL;
+  memset(g, 0, bytes);
+  g->codepoint = codepoint;
+  g->size = size;
+  g->w = w;
+  g->h = h;
+
+  uint32_t idx = glyph_hash(codepoint, size);
+  g->hash_next = buckets[idx];
+  buckets[idx] = g;
+  lru_push_front(g);
+  stats.bytes += bytes;
+  stats.entries++;
+
+  return g;
+}
+
+void glyph_cache_get_stats(glyph_cache_stats *out) {
+  *out = stats;
+}
+
+void glyph_measure(const stbtt_fontinfo *info, uint32_t codepoint, int size, glyph_entry *g) {
+  font_source_prepare(info, codepoint);
+
+  /* calculate font scaling */
+  float scale = stbtt_ScaleForPixelHeight(info, size);
+
+  int ascent, descent, lineGap;
+  stbtt_GetFontVMetrics(info, &ascent, &descent, &lineGap);
+
+  int ax;
+  int lsb;
+  stbtt_GetCodepointHMetrics(info, codepoint, &ax, &lsb);
+
+  g->codepoint = codepoint;
+  g->size = size;
+
+  if (codepoint == 32) {
+    g->advance = roundf(ax * scale);
+    g->x = g->y = g->w = g->h = 0;
+    return;
+  }
+
+  /* get bounding box for character (may be offset to account for chars that dip above or below the line) */
+  int c_x1, c_y1, c_x2, c_y2;
+  stbtt_GetCodepointBitmapBox(info, codepoint, scale, scale, &c_x1, &c_y1, &c_x2, &c_y2);
+
+  /* compute y (different characters have different heights) */
+  g->x = roundf(lsb * scale);
+  g->y = roundf(ascent * scale) + c_y1 - (200 * scale);
+  g->w = c_x2 - c_x1;
+  g->h = c_y2 - c_y1;
+  g->advance = (c_x2 - c_x1 + roundf(lsb * scale));
+}
+
+glyph_entry *glyph_cache_rasterize(const stbtt_fontinfo *info, uint32_t codepoint, int size) {
+  glyph_entry m;
+  glyph_measure(info, codepoint, size, &m);
+
+  glyph_entry *g = glyph_cache_alloc(codepoint, size, m.w, m.h);
+  if (!g)
+    return NULL;
+  g->advance = m.advance;
+  g->x = m.x;
+  g->y = m.y;
+  glyph_render(info, g, g->coverage);
+
+  return g;
+}
+
+void glyph_render(const stbtt_fontinfo *info, const glyph_entry *g, uint8_t *coverage) {
+  if (!g->w || !g->h)
+    return;
+
+  font_source_prepare(info, g->codepoint);
+
+  float scale = stbtt_ScaleForPixelHeight(info, g->size);
+  stbtt_MakeCodepointBitmap(info, coverage, g->w, g->h, g->w, scale, scale, g->codepoint);
+}
+
+static inline void expand_row(const uint8_t *src, uint32_t *dst, int n) {
+  int x = 0;
+#ifdef __ARM_NEON
+  // Storing the same vector on all 4 lanes widens every byte to a grey RGBA8 word
+  for (; x + 16 <= n; x += 16) {
+    uint8x16_t v = vld1q_u8(&src[x]);
+    uint8x16x4_t rgba = {{v, v, v, v}};
+    vst4q_u8((uint8_t *)&dst[x], rgba);
+  }
+  if (x + 8 <= n) {
+    uint8x8_t v = vld1_u8(&src[x]);
+    uint8x8x4_t rgba = {{v, v, v, v}};
+    vst4_u8((uint8_t *)&dst[x], rgba);
+    x += 8;
+  }
+#endif
+  for (; x < n; x++) {
+    dst[x] = src[x] * 0x01010101;
+  }
+}
+
+void glyph_expand(const glyph_entry *g, int size, uint32_t *dst) {
+  // Clip the coverage box to the size*size square
+  int x0 = g->x < 0 ? -g->x : 0;
+  int y0 = g->y < 0 ? -g->y : 0;
+  int x1 = g->x + g->w > size ? size - g->x : g->w;
+  int y1 = g->y + g->h > size ? size - g->y : g->h;
+
+  if (x0 >= x1 || y0 >= y1) {
+    memset(dst, 0, size * size * sizeof(uint32_t));
+    return;
+  }
+
+  // Only the rows and margins around the box get cleared
+  int left = g->x + x0, right = size - (g->x + x1);
+  memset(dst, 0, (g->y + y0) * size * sizeof(uint32_t));
+  for (int y = y0; y < y1; y++) {
+    uint32_t *row = &dst[(g->y + y) * size];
+    memset(row, 0, left * sizeof(uint32_t));
+    expand_row(&g->coverage[y * g->w + x0], &row[left], x1 - x0);
+    memset(&row[size - right], 0, right * sizeof(uint32_t));
+  }
+  memset(&dst[(g->y + y1) * size], 0, (size - (g->y + y1)) * size * sizeof(uint32_t));
+}
@@ -0,0 +1,37 @@
+#ifndef __GLYPH_CACHE_H__
+#define __GLYPH_CACHE_H__
+
+#include <stdint.h>
+
+#include "stb_truetype.h"
+
+typedef struct glyph_entry {
+  struct glyph_entry *hash_next;
+  struct glyph_entry *lru_prev, *lru_next;
+  uint32_t codepoint;
+  int size;
+  int advance;      // value reported to the game in elements[0]
+  int x, y;         // top-left corner of the coverage box inside the size*size square
+  int w, h;         // coverage box size, may be 0 for blank glyphs
+  uint8_t coverage[];
+} glyph_entry;
+
+typedef struct {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  uint32_t entries;
+  uint32_t bytes;
+} glyph_cache_stats;
+
+glyph_entry *glyph_cache_lookup(uint32_t codepoint, int size);
+glyph_entry *glyph_cache_peek(uint32_t codepoint, int size); // no LRU or stats update
+glyph_entry *glyph_cache_alloc(uint32_t codepoint, int size, int w, int h);
+glyph_entry *glyph_cache_rasterize(const stbtt_fontinfo *info, uint32_t codepoint, int size); // NULL when out of memory
+void glyph_cache_get_stats(glyph_cache_stats *stats);
+
+void glyph_measure(const stbtt_fontinfo *info, uint32_t codepoint, int size, glyph_entry *g);
+void glyph_render(const stbtt_fontinfo *info, const glyph_entry *g, uint8_t *coverage);
+void glyph_expand(const glyph_entry *g, int size, uint32_t *dst);
+
+#endif
@@ -0,0 +1,387 @@
+/* hud.c -- on-screen performance overlay
+ *
+ * Toggled with L + R + Start, drawn over the finished frame right before
+ * vglSwapBuffers(). Shows FPS and a frame time graph, per-core CPU load,
+ * newlib heap and vitaGL memory, the glyph cache hit rate, the slowest
+ * call through the fake JNIEnv over the last second and the GL state
+ * changes of the last frame gl_state.c filtered out, along with its draws
+ * before and after draw_batch.c merged them.
+ *
+ * Everything is a textured quad in a single draw call: text comes from a
+ * built-in 5x7 font and solid shapes sample a white texel of the same
+ * texture. Positions are laid out on a 960x544 canvas whatever the
+ * resolution. Nothing is sampled while the overlay is hidden.
+ */
+
+#include <vitasdk.h>
+#include <vitaGL.h>
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "draw_batch.h"
+#include "dyn_res.h"
+#include "frame_pacer.h"
+#include "gl_state.h"
+#include "glyph_cache.h"
+#include "hud.h"
+#include "postfx.h"
+#include "shader_cache.h"
+#include "tex_stage.h"
+
+#define HUD_MAX_QUADS 1024
+#define HUD_SCALE 2 // canvas pixels per font pixel
+#define HUD_CHAR_W (6 * HUD_SCALE)
+#define HUD_LINE_H (9 * HUD_SCALE)
+#define HUD_X 8
+#define HUD_Y 8
+#define HUD_W (26 * HUD_CHAR_W)
+#define HUD_GRAPH_H 64
+#define HUD_GRAPH_MAX_US 50000
+
+#define FONT_TEX_W 512
+#define FONT_TEX_H 8
+#define FONT_WHITE_X 504 // 8x8 opaque block used for solid shapes
+
+#define COLOR_TEXT 0xFFFFFFFF // ABGR
+#define COLOR_PANEL 0xFF201010
+#define COLOR_GOOD 0xFF40D040
+#define COLOR_SLOW 0xFF20C0E0
+#define COLOR_BAD 0xFF3030E0
+
+extern int SCREEN_W, SCREEN_H;
+
+// ASCII 0x20 - 0x5F, one byte per column, bit 0 on top
+static const uint8_t font5x7[64][5] = {
+  {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, {0x14, 0x7F, 0x14, 0x7F, 0x14},
+  {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00},
+  {0x00, 0x1C, 0x22, 0x41, 0x00}, {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x14, 0x08, 0x3E, 0x08, 0x14}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+  {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00}, {0x20, 0x10, 0x08, 0x04, 0x02},
+  {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31},
+  {0x18, 0x14, 0x12, 0x7F, 0x10}, {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+  {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00}, {0x00, 0x56, 0x36, 0x00, 0x00},
+  {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14}, {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06},
+  {0x32, 0x49, 0x79, 0x41, 0x3E}, {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+  {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, {0x3E, 0x41, 0x49, 0x49, 0x7A},
+  {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41},
+  {0x7F, 0x40, 0x40, 0x40, 0x40}, {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+  {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, {0x46, 0x49, 0x49, 0x49, 0x31},
+  {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F},
+  {0x63, 0x14, 0x08, 0x14, 0x63}, {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+  {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04}, {0x40, 0x40, 0x40, 0x40, 0x40},
+};
+
+static const char *hud_vert =
+  "void main(float2 position, float2 texcoord, float4 color,\n"
+  "  out float4 vPosition : POSITION, out float2 vTexcoord : TEXCOORD0, out float4 vColor : COLOR) {\n"
+  "  vPosition = float4(position, 0.f, 1.f);\n"
+  "  vTexcoord = texcoord;\n"
+  "  vColor = color;\n"
+  "}\n";
+
+static const char *hud_frag =
+  "float4 main(float2 vTexcoord : TEXCOORD0, float4 vColor : COLOR, uniform sampler2D font : TEXUNIT0) : COLOR {\n"
+  "  float4 c = tex2D(font, vTexcoord) * vColor;\n"
+  "  if (c.a < 0.5f) discard;\n"
+  "  return c;\n"
+  "}\n";
+
+typedef struct {
+  float x, y, u, v;
+  uint32_t color;
+} hud_vertex;
+
+int hud_visible = 0;
+
+static int hud_ready = 0;
+static GLuint hud_prog, hud_tex;
+static hud_vertex verts[HUD_MAX_QUADS * 6];
+static int num_verts;
+
+static uint32_t frame_us[HUD_GRAPH_FRAMES];
+static int frame_idx;
+static uint64_t last_frame, window_start;
+static uint32_t window_frames;
+
+// Slowest JNI call of the running window and of the last complete one
+static volatile uint32_t call_max_us;
+static const char *volatile call_max_name;
+
+static struct {
+  uint32_t fps;
+  uint32_t cpu[4];
+  uint32_t heap_kb;
+  uint32_t vgl_free_kb;
+  int glyph_hit; // percent, -1 when no lookups happened
+  uint32_t call_us;
+  const char *call_name;
+  uint32_t hud_us;
+} shown;
+
+static SceKernelSystemInfo last_sys;
+static glyph_cache_stats last_glyphs;
+
+static void hud_init(void) {
+  static uint32_t pixels[FONT_TEX_W * FONT_TEX_H];
+  for (int c = 0; c < 64; c++) {
+    for (int x = 0; x < 5; x++) {
+      for (int y = 0; y < 7; y++) {
+        if (font5x7[c][x] & (1 << y))
+          pixels[y * FONT_TEX_W + c * 6 + x] = 0xFFFFFFFF;
+      }
+    }
+  }
+  for (int y = 0; y < FONT_TEX_H; y++) {
+    for (int x = FONT_WHITE_X; x < FONT_TEX_W; x++)
+      pixels[y * FONT_TEX_W + x] = 0xFFFFFFFF;
+  }
+
+  glGenTextures(1, &hud_tex);
+  glBindTexture(GL_TEXTURE_2D, hud_tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, FONT_TEX_W, FONT_TEX_H, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+  shader_cache_compile(vs, hud_vert, strlen(hud_vert));
+  GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+  shader_cache_compile(fs, hud_frag, strlen(hud_frag));
+
+  hud_prog = glCreateProgram();
+  glAttachShader(hud_prog, vs);
+  glAttachShader(hud_prog, fs);
+  glBindAttribLocation(hud_prog, 0, "position");
+  glBindAttribLocation(hud_prog, 1, "texcoord");
+  glBindAttribLocation(hud_prog, 2, "color");
+  glLinkProgram(hud_prog);
+
+  hud_ready = 1;
+}
+
+void hud_toggle(void) {
+  hud_visible = !hud_visible;
+  if (!hud_visible)
+    return;
+
+  memset(frame_us, 0, sizeof(frame_us));
+  memset(&shown, 0, sizeof(shown));
+  shown.glyph_hit = -1;
+  last_frame = window_start = sceKernelGetProcessTimeWide();
+  window_frames = 0;
+  call_max_us = 0;
+  call_max_name = NULL;
+  last_sys.size = sizeof(last_sys);
+  sceKernelGetSystemInfo(&last_sys);
+  glyph_cache_get_stats(&last_glyphs);
+}
+
+void hud_record_call(const char *name, uint64_t start) {
+  // Called from any game thread, a racing update at worst pairs a name with another call's time
+  uint32_t us = sceKernelGetProcessTimeWide() - start;
+  if (us > call_max_us) {
+    call_max_us = us;
+    call_max_name = name;
+  }
+}
+
+static void hud_sample_window(uint64_t now) {
+  uint64_t elapsed = now - window_start;
+
+  shown.fps = (window_frames * 1000000ULL + elapsed / 2) / elapsed;
+
+  SceKernelSystemInfo sys;
+  sys.size = sizeof(sys);
+  if (sceKernelGetSystemInfo(&sys) >= 0) {
+    for (int i = 0; i < 4; i++) {
+      uint64_t idle = sys.cpuInfo[i].idleClock - last_sys.cpuInfo[i].idleClock;
+      shown.cpu[i] = idle >= elapsed ? 0 : 100 - idle * 100 / elapsed;
+    }
+    last_sys = sys;
+  }
+
+  struct mallinfo mi = mallinfo();
+  shown.heap_kb = mi.uordblks / 1024;
+  shown.vgl_free_kb = vglMemFree(VGL_MEM_ALL) / 1024;
+
+  glyph_cache_stats glyphs;
+  glyph_cache_get_stats(&glyphs);
+  uint32_t hits = glyphs.hits - last_glyphs.hits;
+  uint32_t lookups = hits + glyphs.misses - last_glyphs.misses;
+  shown.glyph_hit = lookups ? hits * 100 / lookups : -1;
+  last_glyphs = glyphs;
+
+  shown.call_us = call_max_us;
+  shown.call_name = call_max_name;
+  call_max_us = 0;
+  call_max_name = NULL;
+
+  // Timed on the next frame, it stalls that one a little
+  postfx_request_sample();
+
+  window_start = now;
+  window_frames = 0;
+}
+
+static void hud_quad(float x, float y, float w, float h, float u0, float v0, float u1, float v1, uint32_t color) {
+  if (num_verts + 6 > HUD_MAX_QUADS * 6)
+    return;
+
+  // Canvas pixels to clip space
+  float x0 = x / (DEF_SCREEN_W / 2) - 1.0f, x1 = (x + w) / (DEF_SCREEN_W / 2) - 1.0f;
+  float y0 = 1.0f - y / (DEF_SCREEN_H / 2), y1 = 1.0f - (y + h) / (DEF_SCREEN_H / 2);
+
+  hud_vertex *v = &verts[num_verts];
+  v[0] = (hud_vertex){x0, y0, u0, v0, color};
+  v[1] = (hud_vertex){x1, y0, u1, v0, color};
+  v[2] = (hud_vertex){x0, y1, u0, v1, color};
+  v[3] = v[2];
+  v[4] = v[1];
+  v[5] = (hud_vertex){x1, y1, u1, v1, color};
+  num_verts += 6;
+}
+
+static void hud_rect(float x, float y, float w, float h, uint32_t color) {
+  float u = (FONT_WHITE_X + 4.0f) / FONT_TEX_W, v = 0.5f;
+  hud_quad(x, y, w, h, u, v, u, v, color);
+}
+
+static void hud_text(int line, uint32_t color, const char *fmt, ...) {
+  char buf[64];
+  va_list list;
+  va_start(list, fmt);
+  vsnprintf(buf, sizeof(buf), fmt, list);
+  va_end(list);
+
+  float x = HUD_X + HUD_SCALE * 2, y = HUD_Y + HUD_SCALE * 2 + line * HUD_LINE_H;
+  for (const char *p = buf; *p; p++, x += HUD_CHAR_W) {
+    int c = *p >= 'a' && *p <= 'z' ? *p - 32 : *p;
+    if (c <= 0x20 || c > 0x5F)
+      continue;
+    float u = (c - 0x20) * 6.0f / FONT_TEX_W;
+    hud_quad(x, y, HUD_CHAR_W, FONT_TEX_H * HUD_SCALE, u, 0.0f, u + 6.0f / FONT_TEX_W, 1.0f, color);
+  }
+}
+
+static void hud_graph(float y, uint32_t budget_us) {
+  float bar_w = (float)(HUD_W - HUD_SCALE * 4) / HUD_GRAPH_FRAMES;
+  float x = HUD_X + HUD_SCALE * 2;
+
+  for (int i = 0; i < HUD_GRAPH_FRAMES; i++, x += bar_w) {
+    uint32_t us = frame_us[(frame_idx + i) % HUD_GRAPH_FRAMES];
+    if (!us)
+      continue;
+    float h = (float)(us < HUD_GRAPH_MAX_US ? us : HUD_GRAPH_MAX_US) * HUD_GRAPH_H / HUD_GRAPH_MAX_US;
+    uint32_t color = us <= budget_us + budget_us / 10 ? COLOR_GOOD : us <= budget_us * 2 ? COLOR_SLOW : COLOR_BAD;
+    hud_rect(x, y + HUD_GRAPH_H - h, bar_w, h, color);
+  }
+
+  // Frame budget marker
+  float h = (float)budget_us * HUD_GRAPH_H / HUD_GRAPH_MAX_US;
+  hud_rect(HUD_X + HUD_SCALE * 2, y + HUD_GRAPH_H - h, HUD_W - HUD_SCALE * 4, 1.0f, COLOR_TEXT);
+}
+
+void hud_draw(void) {
+  if (!hud_visible)
+    return;
+
+  uint64_t start = sceKernelGetProcessTimeWide();
+  if (!hud_ready)
+    hud_init();
+
+  frame_us[frame_idx] = start - last_frame;
+  frame_idx = (frame_idx + 1) % HUD_GRAPH_FRAMES;
+  last_frame = start;
+  window_frames++;
+  if (start - window_start >= HUD_WINDOW_US)
+    hud_sample_window(start);
+
+  uint32_t budget_us = 1000000 / frame_pacer_get_rate();
+  uint32_t last_us = frame_us[(frame_idx + HUD_GRAPH_FRAMES - 1) % HUD_GRAPH_FRAMES];
+
+  shader_cache_stats shaders;
+  shader_cache_get_stats(&shaders);
+  postfx_stats fx;
+  postfx_get_stats(&fx);
+  draw_batch_stats draws;
+  draw_batch_get_stats(&draws);
+  gl_state_stats state;
+  gl_state_get_stats(&state);
+  uint32_t state_calls = 0, state_filtered = 0;
+  for (int i = 0; i < GL_STATE_CALLS; i++) {
+    state_calls += state.calls[i];
+    state_filtered += state.filtered[i];
+  }
+
+  num_verts = 0;
+  int lines = 9 + (dyn_res_enabled() ? 1 : 0) + (fx.passes ? 1 : 0);
+  float graph_y = HUD_Y + HUD_SCALE * 2 + lines * HUD_LINE_H;
+  hud_rect(HUD_X, HUD_Y, HUD_W, graph_y + HUD_GRAPH_H + HUD_SCALE * 2 - HUD_Y, COLOR_PANEL);
+  hud_text(0, COLOR_TEXT, "FPS %u %u.%u MS HUD %u.%02u", shown.fps, last_us / 1000, last_us % 1000 / 100,
+           shown.hud_us / 1000, shown.hud_us % 1000 / 10);
+  hud_text(1, COLOR_TEXT, "CPU %u %u %u %u %%", shown.cpu[0], shown.cpu[1], shown.cpu[2], shown.cpu[3]);
+  hud_text(2, COLOR_TEXT, "HEAP %u/%u MB", shown.heap_kb / 1024, MEMORY_NEWLIB_MB);
+  hud_text(3, COLOR_TEXT, "VGL FREE %u MB", shown.vgl_free_kb / 1024);
+  if (shown.glyph_hit < 0)
+    hud_text(4, COLOR_TEXT, "GLYPH HIT -");
+  else
+    hud_text(4, COLOR_TEXT, "GLYPH HIT %d%%", shown.glyph_hit);
+  hud_text(5, shown.call_us > budget_us ? COLOR_BAD : COLOR_TEXT, "MAX %.14s %u.%u MS",
+           shown.call_name ? shown.call_name : "-", shown.call_us / 1000, shown.call_us % 1000 / 100);
+  // Red once something had to be compiled in game, that frame hitched
+  hud_text(6, shaders.misses > shaders.boot_misses ? COLOR_BAD : COLOR_TEXT, "SHADERS %u CACHED %u BUILT", shaders.hits,
+           shaders.misses);
+  hud_text(7, COLOR_TEXT, "STATE %u/%u FILTERED", state_filtered, state_calls);
+  hud_text(8, COLOR_TEXT, "DRAWS %u -> %u", draws.draws_requested, draws.draws_issued);
+  if (dyn_res_enabled()) {
+    int w, h;
+    dyn_res_get_size(&w, &h);
+    hud_text(9, COLOR_TEXT, "RES %dX%d", w, h);
+  }
+  if (fx.passes)
+    hud_text(lines - 1, COLOR_TEXT, "FX %d PASS %d STAGE %u.%02u MS", fx.passes, fx.stages, fx.gpu_us / 1000,
+             fx.gpu_us % 1000 / 10);
+  hud_graph(graph_y, budget_us);
+
+  // The game's frame is done but its state carries over to the next one
+  GLboolean depth = glIsEnabled(GL_DEPTH_TEST);
+  GLboolean blend = glIsEnabled(GL_BLEND);
+  GLboolean cull = glIsEnabled(GL_CULL_FACE);
+  GLboolean scissor = glIsEnabled(GL_SCISSOR_TEST);
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_BLEND);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_SCISSOR_TEST);
+  glViewport(0, 0, SCREEN_W, SCREEN_H);
+
+  glUseProgram(hud_prog);
+  glBindTexture(GL_TEXTURE_2D, hud_tex);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(hud_vertex), &verts[0].x);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(hud_vertex), &verts[0].u);
+  glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(hud_vertex), &verts[0].color);
+  glDrawArrays(GL_TRIANGLES, 0, num_verts);
+  glDisableVertexAttribArray(2);
+  glUseProgram(0);
+  tex_stage_resync();
+
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  if (depth)
+    glEnable(GL_DEPTH_TEST);
+  if (blend)
+    glEnable(GL_BLEND);
+  if (cull)
+    glEnable(GL_CULL_FACE);
+  if (scissor)
+    glEnable(GL_SCISSOR_TEST);
+
+  shown.hud_us = sceKernelGetProcessTimeWide() - start;
+}
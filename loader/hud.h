@@ -0,0 +1,16 @@
+#ifndef __HUD_H__
+#define __HUD_H__
+
+#include <stdint.h>
+
+#define HUD_COMBO (SCE_CTRL_L1 | SCE_CTRL_R1 | SCE_CTRL_START)
+#define HUD_GRAPH_FRAMES 120
+#define HUD_WINDOW_US 1000000 // FPS, CPU load, cache hit rate and slowest call are taken over this window
+
+extern int hud_visible;
+
+void hud_toggle(void);
+void hud_record_call(const char *name, uint64_t start);
+void hud_draw(void);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef __JNI_METHODS_H__
+#define __JNI_METHODS_H__
+
+#include <stdint.h>
+
+/*
+ * Every Java method the game may resolve through GetMethodID() or
+ * GetStaticMethodID(). Each entry gives its method ID, Java name, return
+ * type (union member of jni_method.fn: v, z, i, j, f, l), flags and the
+ * handler receiving the raw argument array.
+ *
+ * JNI_STATIC / JNI_INSTANCE: Call{Static,}*MethodV the method answers to.
+ * JNI_CACHED: the result never changes, the handler only runs once (z/i only).
+ * JNI_WAITS: blocks on purpose (frame pacing), never reported as a stall.
+ */
+#define JNI_METHODS(X)                                                                     \
+  X(GET_CURRENT_FRAME,    "getCurrentFrame",    j, JNI_STATIC | JNI_WAITS,    jni_getCurrentFrame)    \
+  X(LOAD_FILE,            "loadFile",           l, JNI_STATIC,                jni_loadFile)           \
+  X(LOAD_RAW_FILE,        "loadRawFile",        l, JNI_STATIC,                jni_loadRawFile)        \
+  X(GET_LANGUAGE,         "getLanguage",        i, JNI_STATIC | JNI_CACHED,   jni_getLanguage)        \
+  X(GET_SAVEFILENAME,     "getSaveFileName",    l, JNI_STATIC,                jni_getSaveFileName)    \
+  X(CREATE_SAVEFILE,      "createSaveFile",     v, JNI_STATIC,                jni_createSaveFile)     \
+  X(LOAD_TEXTURE,         "loadTexture",        l, JNI_STATIC,                jni_loadTexture)        \
+  X(IS_DEVICE_ANDROID_TV, "isDeviceAndroidTV",  z, JNI_STATIC | JNI_CACHED,   jni_isDeviceAndroidTV)  \
+  X(DRAW_FONT,            "drawFont",           l, JNI_STATIC,                jni_drawFont)           \
+  X(CREATE_EDIT_TEXT,     "createEditText",     v, JNI_STATIC,                jni_createEditText)     \
+  X(GET_EDIT_TEXT,        "getEditText",        l, JNI_STATIC,                jni_getEditText)        \
+  X(GET_RES_WIDTH,        "getResWidth",        i, JNI_STATIC | JNI_CACHED,   jni_getScreenWidth)     \
+  X(GET_RES_HEIGHT,       "getResHeight",       i, JNI_STATIC | JNI_CACHED,   jni_getScreenHeight)    \
+  X(GET_VIEW_X,           "getViewPosX",        i, JNI_STATIC | JNI_CACHED,   jni_zero)               \
+  X(GET_VIEW_Y,           "getViewPosY",        i, JNI_STATIC | JNI_CACHED,   jni_zero)               \
+  X(GET_VIEW_W,           "getViewWidth",       i, JNI_STATIC | JNI_CACHED,   jni_getScreenWidth)     \
+  X(GET_VIEW_H,           "getViewHeight",      i, JNI_STATIC | JNI_CACHED,   jni_getScreenHeight)    \
+  X(UPDATE_VIEWPORT_SIZE, "updateViewportSize", v, JNI_STATIC,                jni_updateViewportSize) \
+  X(SET_FPS,              "setFPS",             v, JNI_STATIC,                jni_setFPS)             \
+  X(IS_OK_ACHIEVEMENT,    "isOKAchievement",    z, JNI_STATIC | JNI_INSTANCE | JNI_CACHED, jni_one) \
+  X(GET_KEY_EVENT,        "getKeyEvent",        i, JNI_STATIC,                jni_getKeyEvent)        \
+  X(LOAD_SOUND,           "loadSound",          l, JNI_STATIC,                jni_loadSound)          \
+  X(GET_SAVE_DATA_PATH,   "getSaveDataPath",    l, JNI_STATIC,                jni_getSaveDataPath)    \
+  X(GET_DOWNLOAD_STATE,   "getDownloadState",   i, JNI_STATIC | JNI_CACHED,   jni_zero)               \
+  X(IS_SOUND_FILE_EXIST,  "isSoundFileExist",   z, JNI_STATIC,                jni_isSoundFileExist)   \
+  X(PLAY_MOVIE,           "playMovie",          v, JNI_STATIC,                jni_playMovie)          \
+  X(GET_MOVIE_STATE,      "getMovieState",      z, JNI_STATIC,                jni_getMovieState)      \
+  X(STOP_MOVIE,           "stopMovie",          v, JNI_STATIC,                jni_stopMovie)          \
+  X(GET_STORAGE_PATH,     "getStoragePath",     l, JNI_STATIC,                jni_getSaveFileName)    \
+  X(CREATE_ACHIEVE_FILE,  "createAchieveFile",  v, JNI_STATIC,                jni_createAchieveFile)  \
+  X(UNLOCK_ACHIEVEMENT,   "unlockAchievement",  v, JNI_STATIC,                jni_unlockAchievement)
+
+#define JNI_STATIC   (1 << 0)
+#define JNI_INSTANCE (1 << 1)
+#define JNI_CACHED   (1 << 2)
+#define JNI_WAITS    (1 << 3)
+
+#define JNI_METHOD_ID(id, name, type, flags, handler) id,
+enum MethodIDs {
+  UNKNOWN = 0,
+  JNI_METHODS(JNI_METHOD_ID)
+  JNI_NUM_METHODS
+};
+#undef JNI_METHOD_ID
+
+// Return types, named after their JNI signature letters (l is any object)
+enum {
+  JNI_TYPE_v,
+  JNI_TYPE_z,
+  JNI_TYPE_i,
+  JNI_TYPE_j,
+  JNI_TYPE_f,
+  JNI_TYPE_l
+};
+
+typedef struct {
+  const char *name;
+  int type;
+  int flags;
+  union {
+    void (*v)(uintptr_t *args);
+    int (*z)(uintptr_t *args);
+    int (*i)(uintptr_t *args);
+    uint64_t (*j)(uintptr_t *args);
+    float (*f)(uintptr_t *args);
+    void *(*l)(uintptr_t *args);
+  } fn;
+} jni_method;
+
+#endif
@@ -0,0 +1,152 @@
+/* jni_pool.c -- size-class allocator for jni_bytearray / jni_intarray
+ *
+ * Array headers and payloads handed to the game come and go every frame
+ * (one drawFont() result per character, textures, file names). Each size
+ * class owns a fixed arena carved in equal blocks kept on a free list, so
+ * this churn never reaches the newlib heap. Classes are lazily allocated on
+ * first use and a pointer's class is found from the arena address ranges,
+ * so blocks carry no header. Anything larger than the biggest class, or
+ * arriving while its class is full, falls back to malloc(); jni_pool_free()
+ * accepts both. jni_pool_init() must run before the game, and the threads
+ * it calls JNI methods from (audio, glyph warm-up), are started.
+ */
+
+#include <vitasdk.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "jni_pool.h"
+
+typedef struct {
+  uint32_t block_size;
+  uint32_t count;
+} pool_class_desc;
+
+/*
+ * Block sizes include the two leading ints of texture results. The glyph
+ * classes match drawFont()'s (size * size + 5) ints at 24, 32, 48 and 64 px,
+ * the texture ones loadTexture()'s (w * h + 2) ints for 128 and 256 px.
+ */
+static const pool_class_desc class_descs[JNI_POOL_NUM_CLASSES] = {
+  {16, 2048},     // jni_bytearray / jni_intarray headers
+  {64, 512},      // file and save paths
+  {256, 256},
+  {2336, 256},    // 24 px glyph
+  {4128, 256},    // 32 px glyph
+  {9248, 64},     // 48 px glyph
+  {16416, 64},    // 64 px glyph
+  {32768, 32},
+  {65544, 16},    // 128x128 texture
+  {262152, 4},    // 256x256 texture
+};
+
+typedef struct pool_block {
+  struct pool_block *next;
+} pool_block;
+
+typedef struct {
+  uint8_t *base, *end;
+  pool_block *free_list;
+} pool_class;
+
+static pool_class classes[JNI_POOL_NUM_CLASSES];
+static jni_pool_stats stats;
+static SceKernelLwMutexWork pool_mutex;
+
+static int pool_class_init(int c) {
+  const pool_class_desc *d = &class_descs[c];
+  uint8_t *base = memalign(8, d->block_size * d->count);
+  if (!base)
+    return 0;
+
+  classes[c].base = base;
+  classes[c].end = base + d->block_size * d->count;
+  classes[c].free_list = NULL;
+  for (int i = d->count - 1; i >= 0; i--) {
+    pool_block *b = (pool_block *)(base + i * d->block_size);
+    b->next = classes[c].free_list;
+    classes[c].free_list = b;
+  }
+  return 1;
+}
+
+void jni_pool_init(void) {
+  sceKernelCreateLwMutex(&pool_mutex, "jni_pool_mutex", 0, 0, NULL);
+  for (int c = 0; c < JNI_POOL_NUM_CLASSES; c++) {
+    stats.classes[c].block_size = class_descs[c].block_size;
+  }
+}
+
+void *jni_pool_alloc(size_t size) {
+  int c = 0;
+  while (c < JNI_POOL_NUM_CLASSES && class_descs[c].block_size < size)
+    c++;
+
+  sceKernelLockLwMutex(&pool_mutex, 1, NULL);
+  stats.allocs++;
+  if (c == JNI_POOL_NUM_CLASSES) {
+    stats.large_allocs++;
+    sceKernelUnlockLwMutex(&pool_mutex, 1);
+    return malloc(size);
+  }
+
+  if (!classes[c].base && pool_class_init(c))
+    stats.classes[c].capacity = class_descs[c].count;
+
+  pool_block *b = classes[c].free_list;
+  if (!b) {
+    stats.classes[c].overflows++;
+    sceKernelUnlockLwMutex(&pool_mutex, 1);
+    return malloc(size);
+  }
+
+  classes[c].free_list = b->next;
+  jni_pool_class_stats *cs = &stats.classes[c];
+  if (++cs->in_use > cs->peak)
+    cs->peak = cs->in_use;
+  stats.requested_bytes += size;
+  stats.wasted_bytes += class_descs[c].block_size - size;
+  sceKernelUnlockLwMutex(&pool_mutex, 1);
+
+  return b;
+}
+
+void jni_pool_free(void *ptr) {
+  if (!ptr)
+    return;
+
+  sceKernelLockLwMutex(&pool_mutex, 1, NULL);
+  stats.frees++;
+  for (int c = 0; c < JNI_POOL_NUM_CLASSES; c++) {
+    if ((uint8_t *)ptr >= classes[c].base && (uint8_t *)ptr < classes[c].end) {
+      pool_block *b = (pool_block *)ptr;
+      b->next = classes[c].free_list;
+      classes[c].free_list = b;
+      stats.classes[c].in_use--;
+      sceKernelUnlockLwMutex(&pool_mutex, 1);
+      return;
+    }
+  }
+  sceKernelUnlockLwMutex(&pool_mutex, 1);
+
+  free(ptr);
+}
+
+void jni_pool_get_stats(jni_pool_stats *out) {
+  *out = stats;
+}
+
+void jni_pool_dump(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return;
+
+  fprintf(f, "allocs %u, frees %u, large %u, internal fragmentation %llu%%\n", stats.allocs, stats.frees,
+          stats.large_allocs, stats.requested_bytes ? stats.wasted_bytes * 100 / (stats.requested_bytes + stats.wasted_bytes) : 0);
+  fprintf(f, "%8s %8s %8s %8s %9s\n", "block", "blocks", "in use", "peak", "overflows");
+  for (int c = 0; c < JNI_POOL_NUM_CLASSES; c++) {
+    jni_pool_class_stats *cs = &stats.classes[c];
+    fprintf(f, "%8u %8u %8u %8u %9u\n", cs->block_size, cs->capacity, cs->in_use, cs->peak, cs->overflows);
+  }
+  fclose(f);
+}
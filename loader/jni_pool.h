@@ -0,0 +1,33 @@
+#ifndef __JNI_POOL_H__
+#define __JNI_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JNI_POOL_NUM_CLASSES 10
+#define JNI_POOL_FILE DATA_PATH "/jni_pool.txt"
+
+typedef struct {
+  uint32_t block_size;
+  uint32_t capacity;   // blocks in the class arena
+  uint32_t in_use;
+  uint32_t peak;
+  uint32_t overflows;  // requests that fit the class but found it full
+} jni_pool_class_stats;
+
+typedef struct {
+  uint32_t allocs;
+  uint32_t frees;
+  uint32_t large_allocs;      // bigger than the largest class, served by malloc
+  uint64_t requested_bytes;   // cumulative, pooled requests only
+  uint64_t wasted_bytes;      // cumulative block_size - requested, internal fragmentation
+  jni_pool_class_stats classes[JNI_POOL_NUM_CLASSES];
+} jni_pool_stats;
+
+void jni_pool_init(void);
+void *jni_pool_alloc(size_t size);
+void jni_pool_free(void *ptr);
+void jni_pool_get_stats(jni_pool_stats *stats);
+void jni_pool_dump(const char *path);
+
+#endif
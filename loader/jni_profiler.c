@@ -0,0 +1,87 @@
+/* jni_profiler.c -- per-method statistics for calls through the fake JNIEnv
+ *
+ * Only hooked in when building with -DJNI_PROFILER=ON: the dispatch of the
+ * fake JNIEnv in main.c then times every call it hands to the method table
+ * and feeds jni_profiler_record(). Calls on the render thread taking longer
+ * than a frame at the current pacing rate are reported, except for methods
+ * blocking on purpose (JNI_WAITS). Holding L + R + Select dumps the report
+ * to JNI_PROFILE_FILE, along with the jni_pool.c statistics.
+ */
+
+#include <vitasdk.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "frame_pacer.h"
+#include "jni_profiler.h"
+
+static jni_method_profile methods[JNI_PROFILER_MAX_METHODS];
+static int render_thid = -1;
+
+void jni_profiler_set_name(int method_id, const char *name) {
+  if (method_id >= 0 && method_id < JNI_PROFILER_MAX_METHODS)
+    methods[method_id].name = name;
+}
+
+void jni_profiler_set_render_thread(int thid) {
+  render_thid = thid;
+}
+
+void jni_profiler_record(int method_id, uint64_t start, int waits) {
+  uint32_t us = sceKernelGetProcessTimeWide() - start;
+  if (method_id < 0 || method_id >= JNI_PROFILER_MAX_METHODS)
+    method_id = 0;
+
+  jni_method_profile *m = &methods[method_id];
+  m->calls++;
+  m->total_us += us;
+  if (us > m->max_us)
+    m->max_us = us;
+
+  int bucket = 0;
+  while (bucket < JNI_PROFILER_BUCKETS - 1 && us >= (2u << bucket))
+    bucket++;
+  m->histogram[bucket]++;
+
+  if (!waits && us > 1000000 / frame_pacer_get_rate() && sceKernelGetThreadId() == render_thid) {
+    m->over_budget++;
+    printf("JNI: %s took %u us on the render thread\n", m->name ? m->name : "unknown", us);
+  }
+}
+
+const jni_method_profile *jni_profiler_get(int method_id) {
+  if (method_id < 0 || method_id >= JNI_PROFILER_MAX_METHODS)
+    return NULL;
+  return &methods[method_id];
+}
+
+void jni_profiler_dump(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f)
+    return;
+
+  fprintf(f, "%-20s %8s %12s %8s %8s %6s  histogram (<2us, <4us, ... <%dms, more)\n",
+          "method", "calls", "total us", "avg us", "max us", "slow", (2 << (JNI_PROFILER_BUCKETS - 2)) / 1000);
+  for (int i = 0; i < JNI_PROFILER_MAX_METHODS; i++) {
+    jni_method_profile *m = &methods[i];
+    if (!m->calls)
+      continue;
+    fprintf(f, "%-20s %8u %12llu %8llu %8u %6u ", m->name ? m->name : "unknown", m->calls,
+            m->total_us, m->total_us / m->calls, m->max_us, m->over_budget);
+    for (int b = 0; b < JNI_PROFILER_BUCKETS; b++)
+      fprintf(f, " %u", m->histogram[b]);
+    fprintf(f, "\n");
+  }
+  fclose(f);
+
+  printf("JNI profile written to %s\n", path);
+}
+
+void jni_profiler_reset(void) {
+  for (int i = 0; i < JNI_PROFILER_MAX_METHODS; i++) {
+    const char *name = methods[i].name;
+    memset(&methods[i], 0, sizeof(jni_method_profile));
+    methods[i].name = name;
+  }
+}
@@ -0,0 +1,27 @@
+#ifndef __JNI_PROFILER_H__
+#define __JNI_PROFILER_H__
+
+#include <stdint.h>
+
+#define JNI_PROFILER_MAX_METHODS 64
+#define JNI_PROFILER_BUCKETS 16     // power of two microsecond buckets, the last one is open ended
+#define JNI_PROFILE_FILE DATA_PATH "/jni_profile.txt"
+#define JNI_PROFILER_COMBO (SCE_CTRL_L1 | SCE_CTRL_R1 | SCE_CTRL_SELECT) // dumps every profile
+
+typedef struct {
+  const char *name;
+  uint32_t calls;
+  uint64_t total_us;
+  uint32_t max_us;
+  uint32_t over_budget;    // calls on the render thread longer than a frame
+  uint32_t histogram[JNI_PROFILER_BUCKETS];
+} jni_method_profile;
+
+void jni_profiler_set_name(int method_id, const char *name);
+void jni_profiler_set_render_thread(int thid);
+void jni_profiler_record(int method_id, uint64_t start, int waits);
+const jni_method_profile *jni_profiler_get(int method_id);
+void jni_profiler_dump(const char *path);
+void jni_profiler_reset(void);
+
+#endif
@@ -41,8 +41,25 @@
 #include "bridge.h"
 #include "config.h"
 #include "dialog.h"
+#include "draw_batch.h"
+#include "dyn_res.h"
+#include "ffp_cache.h"
+#include "font_batch.h"
+#include "frame_pacer.h"
+#include "gl_hooks.h"
+#include "gl_recorder.h"
+#include "gl_state.h"
+#include "hud.h"
+#include "jni_methods.h"
+#include "jni_pool.h"
+#include "jni_profiler.h"
+#include "obb.h"
+#include "postfx.h"
+#include "shader_cache.h"
 #include "so_util.h"
+#include "tex_stage.h"
 #include "trophies.h"
+#include "upscale.h"
 
 int SCREEN_W = DEF_SCREEN_W;
 int SCREEN_H = DEF_SCREEN_H;
@@ -52,6 +69,9 @@ void loadOptions() {
 	char buffer[30];
 	int value;
 	
+	// Options added after a cfg got written keep their default
+	options.fxaa_quality = 1;
+
 	FILE *f = fopen(CONFIG_FILE_PATH, "rb");
 	if (f) {
 		while (EOF != fscanf(f, "%[^=]=%d\n", buffer, &value)) {
@@ -64,6 +84,9 @@ void loadOptions() {
 			else if (strcmp("battle_fps", buffer) == 0) options.battle_fps = value;
 			else if (strcmp("debug_menu", buffer) == 0) options.debug_menu = value;
 			else if (strcmp("swap_confirm", buffer) == 0) options.swap_confirm = value;
+			else if (strcmp("dynamic_resolution", buffer) == 0) options.dyn_res = value;
+			else if (strcmp("upscaler", buffer) == 0) options.upscaler = value;
+			else if (strcmp("fxaa_quality", buffer) == 0) options.fxaa_quality = value;
 		}
 	} else {
 		options.res = 0;
@@ -75,7 +98,10 @@ void loadOptions() {
 		options.battle_fps = 0;
 		options.debug_menu = 0;
 		options.swap_confirm = 0;
+		options.dyn_res = 0;
+		options.upscaler = 0;
 	}
+	options.fxaa_quality = options.fxaa_quality < 0 ? 0 : options.fxaa_quality > 2 ? 2 : options.fxaa_quality;
 	
 	switch (options.res) {
 	case 0:
@@ -186,12 +212,35 @@ void updateViewportSize(int32_t width, int32_t height, uint8_t portrait) {
 	}
 	int x = (width - this_width) / 2;
 	int y = (height - this_height) / 2;
-	glViewport(x, y, this_width, this_height);
+	glViewportHook(x, y, this_width, this_height);
+}
+
+// The loader's own combos are held back from the game until their buttons are released,
+// otherwise opening the HUD also opens the in-game menu
+static uint32_t filterLoaderCombos(uint32_t buttons) {
+	static const uint32_t combos[] = {
+		HUD_COMBO,
+#ifdef JNI_PROFILER
+		JNI_PROFILER_COMBO,
+#endif
+#ifdef GL_RECORDER
+		GL_RECORDER_COMBO,
+#endif
+	};
+	static uint32_t held = 0;
+
+	held &= buttons;
+	for (int i = 0; i < sizeof(combos) / sizeof(*combos); i++) {
+		if ((buttons & combos[i]) == combos[i])
+			held |= combos[i];
+	}
+	return buttons & ~held;
 }
 
 int getKeyEvent() {
 	SceCtrlData pad;
 	sceCtrlPeekBufferPositiveExt2(0, &pad, 1);
+	pad.buttons = filterLoaderCombos(pad.buttons);
 
 	int mask = 0;
 
@@ -223,242 +272,227 @@ int getKeyEvent() {
 	return mask;
 }
 
-enum MethodIDs {
-	UNKNOWN = 0,
-	GET_CURRENT_FRAME, /**/
-	LOAD_FILE,				 /**/
-	LOAD_RAW_FILE,
-	GET_LANGUAGE,
-	GET_SAVEFILENAME,
-	CREATE_SAVEFILE,
-	LOAD_TEXTURE,
-	IS_DEVICE_ANDROID_TV,
-	DRAW_FONT,
-	CREATE_EDIT_TEXT,
-	GET_EDIT_TEXT,
-	GET_RES_WIDTH,
-	GET_RES_HEIGHT,
-	GET_VIEW_X,
-	GET_VIEW_Y,
-	GET_VIEW_W,
-	GET_VIEW_H,
-	UPDATE_VIEWPORT_SIZE,
-	SET_FPS,
-	IS_OK_ACHIEVEMENT,
-	GET_KEY_EVENT,
-	LOAD_SOUND,
-	GET_SAVE_DATA_PATH,
-	GET_DOWNLOAD_STATE,
-	IS_SOUND_FILE_EXIST,
-	PLAY_MOVIE,
-	GET_MOVIE_STATE,
-	STOP_MOVIE,
-	CREATE_ACHIEVE_FILE,
-	UNLOCK_ACHIEVEMENT
-} MethodIDs;
-
-typedef struct {
-	char *name;
-	enum MethodIDs id;
-} NameToMethodID;
-
-static NameToMethodID name_to_method_ids[] = {
-	{"getCurrentFrame", GET_CURRENT_FRAME},
-	{"loadFile", LOAD_FILE},
-	{"loadRawFile", LOAD_RAW_FILE},
-	{"getLanguage", GET_LANGUAGE},
-	{"getSaveFileName", GET_SAVEFILENAME},
-	{"createSaveFile", CREATE_SAVEFILE},
-	{"loadTexture", LOAD_TEXTURE},
-	{"isDeviceAndroidTV", IS_DEVICE_ANDROID_TV},
-	{"drawFont", DRAW_FONT},
-	{"createEditText", CREATE_EDIT_TEXT},
-	{"getEditText", GET_EDIT_TEXT},
-	{"getResWidth", GET_RES_WIDTH},
-	{"getResHeight", GET_RES_HEIGHT},
-	{"getViewPosX", GET_VIEW_X},
-	{"getViewPosY", GET_VIEW_Y},
-	{"getViewWidth", GET_VIEW_W},
-	{"getViewHeight", GET_VIEW_H},
-	{"updateViewportSize", UPDATE_VIEWPORT_SIZE},
-	{"setFPS", SET_FPS},
-	{"isOKAchievement", IS_OK_ACHIEVEMENT},
-	{"getKeyEvent", GET_KEY_EVENT},
-	{"loadSound", LOAD_SOUND},
-	{"getSaveDataPath", GET_SAVE_DATA_PATH},
-	{"getDownloadState", GET_DOWNLOAD_STATE},
-	{"isSoundFileExist", IS_SOUND_FILE_EXIST},
-	{"playMovie", PLAY_MOVIE},
-	{"getMovieState", GET_MOVIE_STATE},
-	{"stopMovie", STOP_MOVIE},
-	{"getStoragePath", GET_SAVEFILENAME}, // We use same path
-	{"createAchieveFile", CREATE_ACHIEVE_FILE},
-	{"unlockAchievement", UNLOCK_ACHIEVEMENT},
+char *b64decode(const void* data, const size_t len);
+
+/* Handlers referenced by JNI_METHODS, see jni_methods.h */
+static uint64_t jni_getCurrentFrame(uintptr_t *args) { return getCurrentFrame((uint64_t)args[0]); }
+static void *jni_loadFile(uintptr_t *args) { return loadFile((char *)args[0]); }
+static void *jni_loadRawFile(uintptr_t *args) { return loadRawFile((char *)args[0]); }
+static void *jni_loadSound(uintptr_t *args) { return loadSound((char *)args[0]); }
+static int jni_getLanguage(uintptr_t *args) { return getCurrentLanguage(); }
+static void *jni_getSaveFileName(uintptr_t *args) { return getSaveFileName(); }
+static void *jni_getSaveDataPath(uintptr_t *args) { return getSaveDataPath(); }
+static void jni_createSaveFile(uintptr_t *args) { createSaveFile((size_t)args[0]); }
+static void *jni_loadTexture(uintptr_t *args) { return loadTexture((jni_bytearray *)args[0]); }
+static int jni_isDeviceAndroidTV(uintptr_t *args) { return isDeviceAndroidTV(); }
+static void *jni_drawFont(uintptr_t *args) { return drawFont((char *)args[0], args[1], args[2], args[3]); }
+static void jni_createEditText(uintptr_t *args) { createEditText((char *)args[0]); }
+static void *jni_getEditText(uintptr_t *args) { return getEditText(); }
+static int jni_getScreenWidth(uintptr_t *args) { return SCREEN_W; }
+static int jni_getScreenHeight(uintptr_t *args) { return SCREEN_H; }
+static int jni_getKeyEvent(uintptr_t *args) { return getKeyEvent(); }
+static void jni_updateViewportSize(uintptr_t *args) { updateViewportSize((int32_t)args[0], (int32_t)args[1], (uint8_t)args[2]); }
+static void jni_setFPS(uintptr_t *args) { setFPS((int32_t)args[0]); }
+static int jni_isSoundFileExist(uintptr_t *args) { return isSoundFileExist((char *)args[0]); }
+static void jni_playMovie(uintptr_t *args) { playMovie(); }
+static int jni_getMovieState(uintptr_t *args) { return getMovieState(); }
+static void jni_stopMovie(uintptr_t *args) { stopMovie(); }
+static void jni_createAchieveFile(uintptr_t *args) { createAchieveFile((size_t)args[0]); }
+static int jni_zero(uintptr_t *args) { return 0; }
+static int jni_one(uintptr_t *args) { return 1; }
+
+static void jni_unlockAchievement(uintptr_t *args) {
+	char *decoded = b64decode((char *)args[0], strlen((char *)args[0]));
+	if (decoded[12] == 0) // 0 on Vita is Plat, first achievement is 1
+		trophies_unlock(1);
+	else if (decoded[12] == 1) // For some reason ach_058 is ID 1 on Android
+		trophies_unlock(57);
+	else if (decoded[12] != 57) // ach_057 is the Plat, that is automatically handled by sceNpTrophy
+		trophies_unlock(decoded[12]);
+}
+
+#define JNI_METHOD_ENTRY(id, name, type, flags, handler) [id] = {name, JNI_TYPE_##type, flags, {.type = handler}},
+static const jni_method jni_methods[JNI_NUM_METHODS] = {
+	JNI_METHODS(JNI_METHOD_ENTRY)
 };
+#undef JNI_METHOD_ENTRY
 
-int GetMethodID(void *env, void *class, const char *name, const char *sig) {
+/*
+ * Name lookup goes through a perfect hash: InitJNIEnv() picks the first seed
+ * for which every name in JNI_METHODS lands in its own slot, so resolving a
+ * name costs one hash and a single strcmp.
+ */
+#define JNI_HASH_SIZE 256
+
+static uint8_t jni_hash_slots[JNI_HASH_SIZE];
+static uint32_t jni_hash_seed = 0;
+
+static int jni_cache_valid[JNI_NUM_METHODS];
+static int jni_cache_value[JNI_NUM_METHODS];
+
+static inline uint32_t jni_hash(const char *name, uint32_t seed) {
+	uint32_t h = 2166136261u ^ seed;
+	while (*name)
+		h = (h ^ (uint8_t)*name++) * 16777619u;
+	return h % JNI_HASH_SIZE;
+}
 
-	for (int i = 0; i < sizeof(name_to_method_ids) / sizeof(NameToMethodID); i++) {
-		if (strcmp(name, name_to_method_ids[i].name) == 0)
-			return name_to_method_ids[i].id;
+static void jni_build_hash(void) {
+	for (;; jni_hash_seed++) {
+		memset(jni_hash_slots, 0, sizeof(jni_hash_slots));
+		int id;
+		for (id = 1; id < JNI_NUM_METHODS; id++) {
+			uint32_t h = jni_hash(jni_methods[id].name, jni_hash_seed);
+			if (jni_hash_slots[h])
+				break;
+			jni_hash_slots[h] = id;
+		}
+		if (id == JNI_NUM_METHODS)
+			return;
 	}
-	printf("GetMethodID %s\n", name);
+}
+
+static int jni_resolve(const char *name) {
+	int id = jni_hash_slots[jni_hash(name, jni_hash_seed)];
+	if (id && strcmp(name, jni_methods[id].name) == 0)
+		return id;
 	return UNKNOWN;
 }
 
+int GetMethodID(void *env, void *class, const char *name, const char *sig) {
+	int id = jni_resolve(name);
+	if (id == UNKNOWN)
+		printf("GetMethodID %s\n", name);
+	return id;
+}
+
 int GetStaticMethodID(void *env, void *class, const char *name,
 											const char *sig) {
+	int id = jni_resolve(name);
+	if (id == UNKNOWN)
+		printf("GetStaticMethodID %s\n", name);
+	return id;
+}
 
-	for (int i = 0; i < sizeof(name_to_method_ids) / sizeof(NameToMethodID); i++) {
-		if (strcmp(name, name_to_method_ids[i].name) == 0)
-			return name_to_method_ids[i].id;
-	}
-	printf("GetStaticMethodID %s\n", name);
+/*
+ * Hooks, compiled out unless the matching option is enabled:
+ * JNI_TRACE prints every call, JNI_TRACE_ARGS adds its first four raw
+ * arguments and JNI_PROFILER feeds jni_profiler.c. Calls are also timed
+ * for the HUD while it is shown.
+ */
+#if defined(JNI_TRACE_ARGS)
+#define JNI_HOOK_TRACE(m, args) \
+	printf("JNI: %s(0x%X, 0x%X, 0x%X, 0x%X)\n", (m)->name, args[0], args[1], args[2], args[3])
+#elif defined(JNI_TRACE)
+#define JNI_HOOK_TRACE(m, args) printf("JNI: %s\n", (m)->name)
+#else
+#define JNI_HOOK_TRACE(m, args)
+#endif
 
-	return UNKNOWN;
+#ifdef JNI_PROFILER
+#define JNI_HOOK_ENTER() uint64_t jni_start = sceKernelGetProcessTimeWide()
+#define JNI_HOOK_LEAVE(m, id)         \
+	jni_profiler_record(id, jni_start, (m)->flags & JNI_WAITS); \
+	if (hud_visible && !((m)->flags & JNI_WAITS)) \
+		hud_record_call((m)->name, jni_start)
+#else
+#define JNI_HOOK_ENTER() uint64_t jni_start = hud_visible ? sceKernelGetProcessTimeWide() : 0
+#define JNI_HOOK_LEAVE(m, id)                  \
+	if (jni_start && !((m)->flags & JNI_WAITS)) \
+		hud_record_call((m)->name, jni_start)
+#endif
+
+static inline const jni_method *jni_get(int methodID, int type, int kind) {
+	if (methodID <= UNKNOWN || methodID >= JNI_NUM_METHODS)
+		return NULL;
+	const jni_method *m = &jni_methods[methodID];
+	if (m->type != type || !(m->flags & kind))
+		return NULL;
+	return m;
 }
 
+#define JNI_DISPATCH(ret, t, kind, def)          \
+	const jni_method *m = jni_get(methodID, JNI_TYPE_##t, kind); \
+	if (!m)                                        \
+		return def;                                  \
+	JNI_HOOK_TRACE(m, args);                       \
+	JNI_HOOK_ENTER();                              \
+	ret r = m->fn.t(args);                         \
+	JNI_HOOK_LEAVE(m, methodID);                   \
+	return r;
+
+// Cache hits still go through the hooks, so traces and profiles count every call
+#define JNI_DISPATCH_CACHED(t, kind)             \
+	const jni_method *m = jni_get(methodID, JNI_TYPE_##t, kind); \
+	if (!m)                                        \
+		return 0;                                    \
+	JNI_HOOK_TRACE(m, args);                       \
+	JNI_HOOK_ENTER();                              \
+	int r;                                         \
+	if ((m->flags & JNI_CACHED) && jni_cache_valid[methodID]) { \
+		r = jni_cache_value[methodID];               \
+	} else {                                       \
+		r = m->fn.t(args);                           \
+		if (m->flags & JNI_CACHED) {                 \
+			jni_cache_value[methodID] = r;             \
+			jni_cache_valid[methodID] = 1;             \
+		}                                            \
+	}                                              \
+	JNI_HOOK_LEAVE(m, methodID);                   \
+	return r;
+
+#define JNI_DISPATCH_VOID(kind)                  \
+	const jni_method *m = jni_get(methodID, JNI_TYPE_v, kind); \
+	if (!m)                                        \
+		return;                                      \
+	JNI_HOOK_TRACE(m, args);                       \
+	JNI_HOOK_ENTER();                              \
+	m->fn.v(args);                                 \
+	JNI_HOOK_LEAVE(m, methodID);
+
 int CallBooleanMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	switch (methodID) {
-	case IS_OK_ACHIEVEMENT:
-		return 1;
-	default:
-		return 0;
-	}
+	JNI_DISPATCH_CACHED(z, JNI_INSTANCE)
 }
 
 float CallFloatMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	return 0.0f;
+	JNI_DISPATCH(float, f, JNI_INSTANCE, 0.0f)
 }
 
 int CallIntMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	return 0;
+	JNI_DISPATCH_CACHED(i, JNI_INSTANCE)
 }
 
 void *CallObjectMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	return NULL;
+	JNI_DISPATCH(void *, l, JNI_INSTANCE, NULL)
 }
 
 void CallVoidMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	return;
+	JNI_DISPATCH_VOID(JNI_INSTANCE)
 }
 
 void *CallStaticObjectMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	switch (methodID) {
-	case LOAD_FILE:
-		return loadFile((char *)args[0]);
-	case LOAD_SOUND:
-		return loadSound((char *)args[0]);
-	case LOAD_RAW_FILE:
-		return loadRawFile((char *)args[0]);
-	case GET_SAVEFILENAME:
-		return getSaveFileName();
-	case LOAD_TEXTURE:
-		return loadTexture((jni_bytearray *)args[0]);
-	case DRAW_FONT:
-		return drawFont((char *)args[0], args[1], args[2], args[3]);
-	case GET_EDIT_TEXT:
-		return getEditText();
-	case GET_SAVE_DATA_PATH:
-		return getSaveDataPath();
-	default:
-		return NULL;
-	}
+	JNI_DISPATCH(void *, l, JNI_STATIC, NULL)
 }
 
-char *b64decode(const void* data, const size_t len);
-
 void CallStaticVoidMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	char *decoded;
-	
-	switch (methodID) {
-	case CREATE_SAVEFILE:
-		createSaveFile((size_t)args[0]);
-		break;
-	case CREATE_EDIT_TEXT:
-		createEditText((char *)args[0]);
-		break;
-	case UPDATE_VIEWPORT_SIZE:
-		updateViewportSize((int32_t)args[0], (int32_t)args[1], (uint8_t)args[2]);
-		break;
-	case SET_FPS:
-		setFPS((int32_t)args[0]);
-		break;
-	case PLAY_MOVIE:
-		playMovie();
-		break;
-	case STOP_MOVIE:
-		stopMovie();
-		break;
-	case CREATE_ACHIEVE_FILE:
-		createAchieveFile((size_t)args[0]);
-		break;
-	case UNLOCK_ACHIEVEMENT:
-		decoded = b64decode(args[0], strlen(args[0]));
-		if (decoded[12] == 0) // 0 on Vita is Plat, first achievement is 1
-			trophies_unlock(1);
-		else if (decoded[12] == 1) // For some reason ach_058 is ID 1 on Android
-			trophies_unlock(57);
-		else if (decoded[12] != 57) // ach_057 is the Plat, that is automatically handled by sceNpTrophy
-			trophies_unlock(decoded[12]);
-		break;
-	default:
-		return;
-	}
+	JNI_DISPATCH_VOID(JNI_STATIC)
 }
 
 int CallStaticBooleanMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	switch (methodID) {
-	case IS_OK_ACHIEVEMENT:
-		return 1;
-	case IS_SOUND_FILE_EXIST:
-		return isSoundFileExist((char *)args[0]);
-	case IS_DEVICE_ANDROID_TV:
-		return isDeviceAndroidTV();
-	case GET_MOVIE_STATE:
-		return getMovieState();
-	default:
-		return 0;
-	}
+	JNI_DISPATCH_CACHED(z, JNI_STATIC)
 }
 
 uint64_t CallStaticLongMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	switch (methodID) {
-	case GET_CURRENT_FRAME:
-		return getCurrentFrame((uint64_t)args[0]);
-	default:
-		return 0;
-	}
+	JNI_DISPATCH(uint64_t, j, JNI_STATIC, 0)
 }
 
 int CallStaticIntMethodV(void *env, void *obj, int methodID, uintptr_t *args) {
-	switch (methodID) {
-	case GET_LANGUAGE:
-		return getCurrentLanguage();
-	case GET_VIEW_X:
-	case GET_VIEW_Y:
-		return 0;
-	case GET_VIEW_W:
-	case GET_RES_WIDTH:
-		return SCREEN_W;
-	case GET_VIEW_H:
-	case GET_RES_HEIGHT:
-		return SCREEN_H;
-	case GET_DOWNLOAD_STATE:
-		return 0;
-	case GET_KEY_EVENT:
-		return getKeyEvent();
-	default:
-		return 0;
-	}
+	JNI_DISPATCH_CACHED(i, JNI_STATIC)
 }
 
 float CallStaticFloatMethodV(void *env, void *obj, int methodID,
 														 uintptr_t *args) {
-	switch (methodID) {
-	default:
-		return 0.0f;
-	}
+	JNI_DISPATCH(float, f, JNI_STATIC, 0.0f)
 }
 
 void *FindClass(void) { return (void *)0x41414141; }
@@ -499,8 +533,8 @@ void *GetByteArrayElements(void *env, jni_bytearray *obj) {
 }
 
 void *NewByteArray(void *env, size_t length) {
-	jni_bytearray *result = malloc(sizeof(jni_bytearray));
-	result->elements = malloc(length);
+	jni_bytearray *result = jni_pool_alloc(sizeof(jni_bytearray));
+	result->elements = jni_pool_alloc(length);
 	result->size = length;
 	return result;
 }
@@ -510,14 +544,14 @@ void *GetIntArrayElements(void *env, jni_intarray *obj) {
 }
 
 int ReleaseByteArrayElements(void *env, jni_bytearray *obj) {
-	free(obj->elements);
-	free(obj);
+	jni_pool_free(obj->elements);
+	jni_pool_free(obj);
 	return 0;
 }
 
 int ReleaseIntArrayElements(void *env, jni_intarray *obj) {
-	free(obj->elements);
-	free(obj);
+	jni_pool_free(obj->elements);
+	jni_pool_free(obj);
 	return 0;
 }
 
@@ -568,6 +602,12 @@ void InitJNIEnv(void) {
 
 	// *(uintptr_t *)(fake_env + 0x35C) = (uintptr_t)RegisterNatives;
 	*(uintptr_t *)(fake_env + 0x374) = (uintptr_t)GetStringUTFRegion;
+
+	jni_build_hash();
+#ifdef JNI_PROFILER
+	for (int i = 1; i < JNI_NUM_METHODS; i++)
+		jni_profiler_set_name(i, jni_methods[i].name);
+#endif
 }
 
 void *Android_JNI_GetEnv(void) { return fake_env; }
@@ -728,16 +768,18 @@ float *postfx_texcoords, *postfx_vertices;
 void loadShader(int is_vertex, char *file) {
 	SceIoStat st;
 	sceIoGetstat(file, &st);
-	char *code = (char*)malloc(st.st_size);
+	char *code = (char*)malloc(st.st_size + 32);
 
+	// Quality preset of the FXAA effect
+	GLint len = 0;
+	if (!is_vertex && strstr(file, "_FXAA_"))
+		len = sprintf(code, "#define FXAA_QUALITY %d\n", options.fxaa_quality);
 	FILE *f = fopen(file, "rb");
-	fread(code, 1, st.st_size, f);
+	fread(&code[len], 1, st.st_size, f);
 	fclose(f);
 
-	GLint len = st.st_size - 1;
-	GLuint shad = is_vertex ? vert : frag;
-	glShaderSource(shad, 1, &code, &len);
-	glCompileShader(shad);
+	len += st.st_size - 1;
+	shader_cache_compile(is_vertex ? vert : frag, code, len);
 
 	free(code);
 }
@@ -766,8 +808,10 @@ int main_thread(SceSize args, void *argp) {
 	memset(&boot_param, 0, sizeof(SceAppUtilBootParam));
 	sceAppUtilInit(&init_param, &boot_param);
 
+	// Offscreen rendering can't be multisampled, don't pay for it on the display buffer
+	int offscreen = options.dyn_res || (options.upscaler && options.res > 0);
 	int has_low_res = 0;
-	switch (options.msaa) {
+	switch (offscreen ? 0 : options.msaa) {
 	case 0:
 		has_low_res = vglInitExtended(0, SCREEN_W, SCREEN_H, MEMORY_VITAGL_THRESHOLD_MB * 1024 * 1024, SCE_GXM_MULTISAMPLE_NONE);
 		break;
@@ -813,10 +857,17 @@ int main_thread(SceSize args, void *argp) {
 			sprintf(path, "%d_", options.postfx);
 			if (strstr(d.d_name, path)) {
 				sprintf(path, "app0:shaders/%s", d.d_name);
-				loadShader(strncmp(&d.d_name[strlen(d.d_name) - 5], "_f.cg", 5) == 0 ? 0 : 1, path);
+				if (strstr(d.d_name, "_chain.txt"))
+					postfx_chain_load(path);
+				else
+					loadShader(strncmp(&d.d_name[strlen(d.d_name) - 5], "_f.cg", 5) == 0 ? 0 : 1, path);
 			}
 		}
 		sceIoDclose(fd);
+		postfx_stats fx;
+		postfx_get_stats(&fx);
+		if (fx.stages)
+			postfx_chain_compile(vert, frag);
 
 		postfx_prog = glCreateProgram();
 		glAttachShader(postfx_prog, frag);
@@ -825,14 +876,52 @@ int main_thread(SceSize args, void *argp) {
 		glBindAttribLocation(postfx_prog, 1, "texcoord");
 		glLinkProgram(postfx_prog);
 		time_unif = glGetUniformLocation(postfx_prog, "iTime");
+		postfx_setup(postfx_prog, SCREEN_W, SCREEN_H);
+		postfx_lut_setup(postfx_prog, SCREEN_W, SCREEN_H);
 	}
+	// With an upscaler, the game renders at 544p at most
+	int max_level = DYN_RES_STEPS;
+	if (options.upscaler && SCREEN_W > DEF_SCREEN_W)
+		max_level = DYN_RES_STEPS * DEF_SCREEN_W / SCREEN_W;
+	if (options.dyn_res || max_level < DYN_RES_STEPS)
+		dyn_res_init(SCREEN_W, SCREEN_H, max_level, options.dyn_res);
 
 	int (*ff4_render)(char *, int, int) =
 			(void *)so_symbol(&ff4_mod, "render");
 	int (*ff4_touch)(int, int, int, int, float, float, float, float) = (void *)so_symbol(&ff4_mod, "touch");
 
 	readHeader();
+	initGlyphAtlas();
+	startGlyphWarmup();
+	ffp_cache_warmup();
+	gl_state_invalidate();
+#ifdef JNI_PROFILER
+	jni_profiler_set_render_thread(sceKernelGetThreadId());
+#endif
+	uint32_t old_buttons = 0;
+	int booted = 0;
 	while (1) {
+		SceCtrlData pad;
+		sceCtrlPeekBufferPositive(0, &pad, 1);
+		if ((pad.buttons & HUD_COMBO) == HUD_COMBO && (old_buttons & HUD_COMBO) != HUD_COMBO)
+			hud_toggle();
+#ifdef JNI_PROFILER
+		if ((pad.buttons & JNI_PROFILER_COMBO) == JNI_PROFILER_COMBO && (old_buttons & JNI_PROFILER_COMBO) != JNI_PROFILER_COMBO) {
+			jni_profiler_dump(JNI_PROFILE_FILE);
+			jni_pool_dump(JNI_POOL_FILE);
+			frame_pacer_dump(FRAME_PACER_FILE);
+			gl_state_dump(GL_STATE_FILE);
+		}
+#endif
+#ifdef GL_RECORDER
+		if ((pad.buttons & GL_RECORDER_COMBO) == GL_RECORDER_COMBO && (old_buttons & GL_RECORDER_COMBO) != GL_RECORDER_COMBO)
+			gl_recorder_start(SCREEN_W, SCREEN_H);
+#endif
+		old_buttons = pad.buttons;
+
+		uint64_t frame_start = sceKernelGetProcessTimeWide();
+		uint64_t slept = frame_pacer_slept_us();
+		dyn_res_begin_frame();
 
 		SceTouchData touch;
 		float coordinates[4] = {0.0f, 0.0f, 0.0f, 0.0f};
@@ -851,8 +940,12 @@ int main_thread(SceSize args, void *argp) {
 							coordinates[2], coordinates[3]);
 		
 		ff4_render(fake_env, 0, SCREEN_W);
+		draw_batch_flush();
+		postfx_sample_begin();
+		dyn_res_resolve(options.postfx ? fb : 0);
 		if (options.postfx) {
 			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			postfx_lut_bind();
 			glBindTexture(GL_TEXTURE_2D, fb_tex);
 			glUseProgram(postfx_prog);
 			glEnableVertexAttribArray(0);
@@ -864,9 +957,27 @@ int main_thread(SceSize args, void *argp) {
 			}
 			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 			glUseProgram(0);
-			glBindFramebuffer(GL_FRAMEBUFFER, fb);
 		}
+		postfx_sample_end((options.postfx ? 1 : 0) + (dyn_res_enabled() ? (options.upscaler == UPSCALER_FSR ? 2 : 1) : 0));
+		hud_draw();
+		if (options.postfx && !dyn_res_enabled())
+			glBindFramebuffer(GL_FRAMEBUFFER, fb);
+		font_batch_end_frame();
 		vglSwapBuffers(editText == -1 ? GL_FALSE : GL_TRUE);
+		gl_state_end_frame();
+		tex_stage_end_frame();
+		draw_batch_end_frame();
+		if (!booted) {
+			shader_cache_report_boot();
+			booted = 1;
+		}
+
+		// Time the frame kept us busy, sleeping until its deadline aside
+		uint64_t busy = sceKernelGetProcessTimeWide() - frame_start - (frame_pacer_slept_us() - slept);
+		dyn_res_end_frame(busy, 1000000 / frame_pacer_get_rate());
+#ifdef GL_RECORDER
+		gl_recorder_end_frame(busy);
+#endif
 	}
 
 	return 0;
@@ -976,6 +1087,7 @@ void *AAsset_getLength() {
 }
 
 void glTexParameteriHook(GLenum target, GLenum pname, GLint param) {
+	draw_batch_flush();
 	if (options.bilinear) {
 		if (pname == GL_TEXTURE_MIN_FILTER || pname == GL_TEXTURE_MAG_FILTER){
 			glTexParameteri(target, pname, GL_LINEAR);
@@ -985,6 +1097,16 @@ void glTexParameteriHook(GLenum target, GLenum pname, GLint param) {
 	glTexParameteri(target, pname, param);
 }
 
+/*
+ * GL imports of libff4.so. Built with GL_RECORDER, they all go through the
+ * capturing wrappers of gl_recorder.c, which call the same functions.
+ */
+#ifdef GL_RECORDER
+#define GL_IMPORT(name, func) {#name, (uintptr_t)&rec_##name}
+#else
+#define GL_IMPORT(name, func) {#name, (uintptr_t)&func}
+#endif
+
 static so_default_dynlib dynlib_functions[] = {
 		{"AAssetManager_open", (uintptr_t)&AAssetManager_open},
 		{"AAsset_close", (uintptr_t)&AAsset_close},
@@ -1097,44 +1219,44 @@ static so_default_dynlib dynlib_functions[] = {
 		{"fwrite", (uintptr_t)&fwrite},
 		{"gettimeofday", (uintptr_t)&gettimeofday},
 		{"gmtime", (uintptr_t)&gmtime},
-		{"glAlphaFunc", (uintptr_t)&glAlphaFunc},
-		{"glBindTexture", (uintptr_t)&glBindTexture},
-		{"glBlendFunc", (uintptr_t)&glBlendFunc},
-		{"glClear", (uintptr_t)&glClear},
-		{"glClearColor", (uintptr_t)&glClearColor},
-		{"glColor4ub", (uintptr_t)&glColor4ub},
-		{"glColorPointer", (uintptr_t)&glColorPointer},
-		{"glCullFace", (uintptr_t)&glCullFace},
-		{"glDeleteTextures", (uintptr_t)&glDeleteTextures},
-		{"glDepthFunc", (uintptr_t)&glDepthFunc},
-		{"glDepthMask", (uintptr_t)&glDepthMask},
-		{"glDisable", (uintptr_t)&glDisable},
-		{"glDisableClientState", (uintptr_t)&glDisableClientState},
-		{"glDrawArrays", (uintptr_t)&glDrawArrays},
-		{"glEnable", (uintptr_t)&glEnable},
-		{"glEnableClientState", (uintptr_t)&glEnableClientState},
-		{"glFogf", (uintptr_t)&glFogf},
-		{"glFogfv", (uintptr_t)&glFogfv},
-		{"glGenTextures", (uintptr_t)&glGenTextures},
-		{"glGetError", (uintptr_t)&glGetError},
-		{"glLightfv", (uintptr_t)&glLightfv},
-		{"glLoadIdentity", (uintptr_t)&glLoadIdentity},
-		{"glLoadMatrixf", (uintptr_t)&glLoadMatrixf},
-		{"glMaterialfv", (uintptr_t)&glMaterialfv},
-		{"glMatrixMode", (uintptr_t)&glMatrixMode},
-		{"glMultMatrixf", (uintptr_t)&glMultMatrixf},
-		{"glNormalPointer", (uintptr_t)&glNormalPointer},
-		{"glOrthof", (uintptr_t)&glOrthof},
-		{"glPopMatrix", (uintptr_t)&glPopMatrix},
-		{"glPushMatrix", (uintptr_t)&glPushMatrix},
-		{"glScissor", (uintptr_t)&glScissor},
-		{"glTranslatef", (uintptr_t)&glTranslatef},
-		{"glTexCoordPointer", (uintptr_t)&glTexCoordPointer},
-		{"glTexImage2D", (uintptr_t)&glTexImage2D},
-		{"glTexParameteri", (uintptr_t)&glTexParameteriHook},
-		{"glTexSubImage2D", (uintptr_t)&glTexSubImage2D},
-		{"glVertexPointer", (uintptr_t)&glVertexPointer},
-		{"glViewport", (uintptr_t)&glViewport},
+		GL_IMPORT(glAlphaFunc, glAlphaFuncHook),
+		GL_IMPORT(glBindTexture, glBindTextureHook),
+		GL_IMPORT(glBlendFunc, glBlendFuncHook),
+		GL_IMPORT(glClear, glClearHook),
+		GL_IMPORT(glClearColor, glClearColor),
+		GL_IMPORT(glColor4ub, glColor4ubHook),
+		GL_IMPORT(glColorPointer, glColorPointerHook),
+		GL_IMPORT(glCullFace, glCullFaceHook),
+		GL_IMPORT(glDeleteTextures, glDeleteTexturesHook),
+		GL_IMPORT(glDepthFunc, glDepthFuncHook),
+		GL_IMPORT(glDepthMask, glDepthMaskHook),
+		GL_IMPORT(glDisable, glDisableHook),
+		GL_IMPORT(glDisableClientState, glDisableClientStateHook),
+		GL_IMPORT(glDrawArrays, glDrawArraysHook),
+		GL_IMPORT(glEnable, glEnableHook),
+		GL_IMPORT(glEnableClientState, glEnableClientStateHook),
+		GL_IMPORT(glFogf, glFogfHook),
+		GL_IMPORT(glFogfv, glFogfvHook),
+		GL_IMPORT(glGenTextures, glGenTextures),
+		GL_IMPORT(glGetError, glGetError),
+		GL_IMPORT(glLightfv, glLightfvHook),
+		GL_IMPORT(glLoadIdentity, glLoadIdentityHook),
+		GL_IMPORT(glLoadMatrixf, glLoadMatrixfHook),
+		GL_IMPORT(glMaterialfv, glMaterialfvHook),
+		GL_IMPORT(glMatrixMode, glMatrixModeHook),
+		GL_IMPORT(glMultMatrixf, glMultMatrixfHook),
+		GL_IMPORT(glNormalPointer, glNormalPointerHook),
+		GL_IMPORT(glOrthof, glOrthofHook),
+		GL_IMPORT(glPopMatrix, glPopMatrixHook),
+		GL_IMPORT(glPushMatrix, glPushMatrixHook),
+		GL_IMPORT(glScissor, glScissorHook),
+		GL_IMPORT(glTranslatef, glTranslatefHook),
+		GL_IMPORT(glTexCoordPointer, glTexCoordPointerHook),
+		GL_IMPORT(glTexImage2D, glTexImage2DHook),
+		GL_IMPORT(glTexParameteri, glTexParameteriHook),
+		GL_IMPORT(glTexSubImage2D, glTexSubImage2DHook),
+		GL_IMPORT(glVertexPointer, glVertexPointerHook),
+		GL_IMPORT(glViewport, glViewportHook),
 		{"localtime", (uintptr_t)&localtime},
 		{"lrand48", (uintptr_t)&lrand48},
 		{"malloc", (uintptr_t)&malloc},
@@ -1250,6 +1372,7 @@ int main(int argc, char *argv[]) {
 			!file_exists("ur0:/data/external/libshacccg.suprx"))
 		fatal_error("Error libshacccg.suprx is not installed.");
 
+	jni_pool_init();
 	InitJNIEnv();
 
 	if (so_file_load(&ff4_mod, SO_PATH, 0x98000000) < 0)
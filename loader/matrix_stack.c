@@ -0,0 +1,129 @@
+/* matrix_stack.c -- GLES1 matrix stacks kept on the loader's side
+ *
+ * The game rebuilds its matrices with several calls per object. Each of
+ * them would be a trip through vitaGL, which updates its own matrices and
+ * flags its shaders' uniforms for every one. The stacks are kept here
+ * instead, with the 4x4 products done in NEON, and gl_hooks.c only hands
+ * vitaGL the matrices changed since the last draw when a draw happens.
+ *
+ * Matrices are column major as in GL. Nothing here calls GL, so the host
+ * tools can replay captured matrix calls through it.
+ */
+
+#include <string.h>
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "matrix_stack.h"
+
+#define IDENTITY {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}
+
+static float stacks[MATRIX_STACKS][MATRIX_STACK_DEPTH][16] = {{IDENTITY}, {IDENTITY}, {IDENTITY}};
+static int depth[MATRIX_STACKS];
+static int mode = MATRIX_MODELVIEW;
+static uint32_t dirty = 0;
+
+// r = a * b, r may be a but not b
+void matrix_mult(float *r, const float *a, const float *b) {
+#ifdef __ARM_NEON
+  float32x4_t a0 = vld1q_f32(a), a1 = vld1q_f32(a + 4), a2 = vld1q_f32(a + 8), a3 = vld1q_f32(a + 12);
+  for (int i = 0; i < 4; i++) {
+    float32x4_t c = vmulq_n_f32(a0, b[i * 4]);
+    c = vmlaq_n_f32(c, a1, b[i * 4 + 1]);
+    c = vmlaq_n_f32(c, a2, b[i * 4 + 2]);
+    c = vmlaq_n_f32(c, a3, b[i * 4 + 3]);
+    vst1q_f32(r + i * 4, c);
+  }
+#else
+  float t[16];
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++)
+      t[i * 4 + j] = a[j] * b[i * 4] + a[4 + j] * b[i * 4 + 1] + a[8 + j] * b[i * 4 + 2] + a[12 + j] * b[i * 4 + 3];
+  }
+  memcpy(r, t, sizeof(t));
+#endif
+}
+
+static float *current(void) {
+  dirty |= 1 << mode;
+  return stacks[mode][depth[mode]];
+}
+
+void matrix_stack_mode(int stack) {
+  if (stack >= 0 && stack < MATRIX_STACKS)
+    mode = stack;
+}
+
+int matrix_stack_get_mode(void) {
+  return mode;
+}
+
+void matrix_stack_load_identity(void) {
+  static const float identity[16] = IDENTITY;
+  memcpy(current(), identity, sizeof(identity));
+}
+
+void matrix_stack_load(const float *m) {
+  memcpy(current(), m, 16 * sizeof(float));
+}
+
+void matrix_stack_mult(const float *m) {
+  float *t = current();
+  matrix_mult(t, t, m);
+}
+
+void matrix_stack_translate(float x, float y, float z) {
+  // Only the last column changes
+  float *t = current();
+#ifdef __ARM_NEON
+  float32x4_t c = vld1q_f32(t + 12);
+  c = vmlaq_n_f32(c, vld1q_f32(t), x);
+  c = vmlaq_n_f32(c, vld1q_f32(t + 4), y);
+  c = vmlaq_n_f32(c, vld1q_f32(t + 8), z);
+  vst1q_f32(t + 12, c);
+#else
+  for (int i = 0; i < 4; i++)
+    t[12 + i] += t[i] * x + t[4 + i] * y + t[8 + i] * z;
+#endif
+}
+
+void matrix_stack_ortho(float left, float right, float bottom, float top, float near, float far) {
+  float m[16] = {
+    2.0f / (right - left), 0.0f, 0.0f, 0.0f,
+    0.0f, 2.0f / (top - bottom), 0.0f, 0.0f,
+    0.0f, 0.0f, -2.0f / (far - near), 0.0f,
+    -(right + left) / (right - left), -(top + bottom) / (top - bottom), -(far + near) / (far - near), 1.0f
+  };
+  matrix_stack_mult(m);
+}
+
+void matrix_stack_push(void) {
+  if (depth[mode] == MATRIX_STACK_DEPTH - 1)
+    return;
+  memcpy(stacks[mode][depth[mode] + 1], stacks[mode][depth[mode]], 16 * sizeof(float));
+  depth[mode]++;
+}
+
+void matrix_stack_pop(void) {
+  if (!depth[mode])
+    return;
+  depth[mode]--;
+  dirty |= 1 << mode;
+}
+
+const float *matrix_stack_top(int stack) {
+  return stacks[stack][depth[stack]];
+}
+
+uint32_t matrix_stack_dirty(void) {
+  return dirty;
+}
+
+void matrix_stack_clean(uint32_t bits) {
+  dirty &= ~bits;
+}
+
+void matrix_stack_touch(int stack) {
+  dirty |= 1 << stack;
+}
@@ -0,0 +1,33 @@
+#ifndef __MATRIX_STACK_H__
+#define __MATRIX_STACK_H__
+
+#include <stdint.h>
+
+#define MATRIX_STACK_DEPTH 32
+
+enum {
+  MATRIX_MODELVIEW,
+  MATRIX_PROJECTION,
+  MATRIX_TEXTURE,
+  MATRIX_STACKS
+};
+
+void matrix_stack_mode(int stack);
+int matrix_stack_get_mode(void);
+
+void matrix_stack_load_identity(void);
+void matrix_stack_load(const float *m);
+void matrix_stack_mult(const float *m);
+void matrix_stack_translate(float x, float y, float z);
+void matrix_stack_ortho(float left, float right, float bottom, float top, float near, float far);
+void matrix_stack_push(void);
+void matrix_stack_pop(void);
+
+const float *matrix_stack_top(int stack);
+uint32_t matrix_stack_dirty(void);   // bits of the stacks changed since matrix_stack_clean()
+void matrix_stack_clean(uint32_t stacks);
+void matrix_stack_touch(int stack);  // the GL side got something else loaded
+
+void matrix_mult(float *r, const float *a, const float *b);
+
+#endif
@@ -0,0 +1,211 @@
+/* obb.c -- access to the game's main.obb archive
+ *
+ * Kept free of Vita specific calls so that host tools can read the
+ * archive as well.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "zlib.h"
+
+#include "obb.h"
+
+static const char *obb_path = OBB_FILE;
+
+unsigned char *header = NULL;
+int header_length = 0;
+
+void decodeArray(unsigned char *bArr, int size, uint key) {
+  for (int n = 0; n < size; n++) {
+    key = key * 0x41c64e6d + 0x3039;
+    bArr[n] = bArr[n] ^ (unsigned char)(key >> 0x18);
+  }
+}
+
+static int getInt(unsigned char *bArr, int i) {
+  return *(unsigned int *)(&bArr[i]);
+}
+
+unsigned char *gzipRead(unsigned char *bArr, int *bArr_length) {
+  unsigned int readInt = __builtin_bswap32(getInt(bArr, 0));
+  unsigned char *bArr2 = calloc(readInt, sizeof(unsigned char));
+  unsigned char *bArr3 = &bArr[4];
+
+  z_stream infstream;
+  infstream.zalloc = Z_NULL;
+  infstream.zfree = Z_NULL;
+  infstream.opaque = Z_NULL;
+  // setup "b" as the input and "c" as the compressed output
+  infstream.avail_in = *bArr_length - 4; // size of input
+  infstream.next_in = bArr3;             // input char array
+  infstream.avail_out = readInt;         // size of output
+  infstream.next_out = bArr2;            // output char array
+
+  // the actual DE-compression work.
+  inflateInit2(&infstream, MAX_WBITS | 16);
+  inflate(&infstream, Z_FULL_FLUSH);
+  inflateEnd(&infstream);
+
+  *bArr_length = readInt;
+  return bArr2;
+}
+
+unsigned char *m476a(char *str, int *file_length) {
+  int i;
+
+  unsigned char *bArr = header;
+  if (bArr != NULL) {
+    int a = getInt(bArr, 0);
+    int i2 = 0;
+    i = 0;
+    while (a > i2) {
+      int i3 = (i2 + a) / 2;
+      int i4 = i3 * 12;
+      int a2 = getInt(header, i4 + 4);
+      int i5 = 0;
+      for (int i6 = 0; i6 < strlen(str) && i5 == 0; i6++) {
+        i5 = (header[a2 + i6] & 0xFF) - (str[i6] & 0xFF);
+      }
+      if (i5 == 0) {
+        i5 = header[a2 + strlen(str)] & 0xFF;
+      }
+      if (i5 == 0) {
+        i = i4 + 8;
+        a = i3;
+        i2 = a;
+      } else if (i5 > 0) {
+        a = i3;
+      } else {
+        i2 = i3 + 1;
+      }
+    }
+  } else {
+    i = 0;
+  }
+  if (i == 0) {
+    return NULL;
+  }
+
+  FILE *fp = fopen(obb_path, "r");
+  int a3 = getInt(header, i);
+  fseek(fp, a3, SEEK_SET);
+
+  *file_length = getInt(header, i + 4);
+  unsigned char *bArr2 = malloc(*file_length);
+
+  for (int i7 = 0; i7 < *file_length;
+       i7 += fread(&bArr2[i7], sizeof(unsigned char), *file_length - i7, fp)) {
+  }
+
+  fclose(fp);
+
+  decodeArray(bArr2, *file_length, a3 + 419430400u);
+
+  unsigned char *a4 = gzipRead(bArr2, file_length);
+
+  free(bArr2);
+
+  return a4;
+}
+
+uint8_t isFileExist(char *str) {
+  int i;
+
+  unsigned char *bArr = header;
+  if (bArr != NULL) {
+    int a = getInt(bArr, 0);
+    int i2 = 0;
+    i = 0;
+    while (a > i2) {
+      int i3 = (i2 + a) / 2;
+      int i4 = i3 * 12;
+      int a2 = getInt(header, i4 + 4);
+      int i5 = 0;
+      for (int i6 = 0; i6 < strlen(str) && i5 == 0; i6++) {
+        i5 = (header[a2 + i6] & 0xFF) - (str[i6] & 0xFF);
+      }
+      if (i5 == 0) {
+        i5 = header[a2 + strlen(str)] & 0xFF;
+      }
+      if (i5 == 0) {
+        i = i4 + 8;
+        a = i3;
+        i2 = a;
+      } else if (i5 > 0) {
+        a = i3;
+      } else {
+        i2 = i3 + 1;
+      }
+    }
+  } else {
+    i = 0;
+  }
+  if (i == 0) {
+    return 0;
+  }
+  
+  return 1;
+}
+
+int readHeaderFrom(const char *path) {
+  FILE *fp = fopen(path, "r");
+  if (!fp)
+    return 0;
+  obb_path = path;
+  fseek(fp, 0L, SEEK_END);
+  int length = ftell(fp);
+  fseek(fp, 0L, SEEK_SET);
+
+  unsigned char bArr[16];
+
+  for (int i = 0; i < 16;
+       i += fread(&bArr[i], sizeof(unsigned char), 16 - i, fp)) {
+  }
+
+  decodeArray(bArr, 16, 419430400u);
+
+  if (getInt(bArr, 0) != 826495553) {
+    printf("initFileTable: Header Error\n");
+    return 0;
+  } else if (length != getInt(bArr, 4)) {
+    printf("initFileTable: Size Error\n");
+    return 0;
+  } else {
+    unsigned int a2 = getInt(bArr, 8);
+    header_length = getInt(bArr, 12);
+    header = malloc(header_length);
+
+    fseek(fp, (long)(a2 - 16), SEEK_CUR);
+
+    for (int i = 0; i < header_length;
+         i += fread(&header[i], sizeof(unsigned char), header_length - i, fp)) {
+    }
+
+    decodeArray(header, header_length, a2 + 419430400u);
+
+    unsigned char *header2 = gzipRead(header, &header_length);
+
+    free(header);
+
+    header = header2;
+
+    fclose(fp);
+  }
+  return 1;
+}
+
+int readHeader() {
+  return readHeaderFrom(OBB_FILE);
+}
+
+int obb_get_file_count() {
+  return header ? getInt(header, 0) : 0;
+}
+
+const char *obb_get_file_name(int idx) {
+  return (const char *)&header[getInt(header, idx * 12 + 4)];
+}
@@ -0,0 +1,16 @@
+#ifndef __OBB_H__
+#define __OBB_H__
+
+#include <stdint.h>
+
+#define OBB_FILE "ux0:/data/ff4/main.obb"
+
+unsigned char *m476a(char *str, int *file_length);
+uint8_t isFileExist(char *str);
+int readHeader();
+int readHeaderFrom(const char *path);
+
+int obb_get_file_count();
+const char *obb_get_file_name(int idx);
+
+#endif
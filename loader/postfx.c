@@ -0,0 +1,275 @@
+/* postfx.c -- PostFX effect chains fused into a single pass
+ *
+ * Besides the single effects shipped as <n>_<Name>_f.cg / _v.cg pairs, a
+ * PostFX can be a <n>_<Name>_chain.txt listing stages in order, one per
+ * line with an optional parameter. The stages are pasted into one fragment
+ * program when it is built, so a chain of any length still costs a single
+ * full-screen pass. Only the first stage may sample the frame (fxaa), the
+ * others work on the color it produced.
+ *
+ * Effects sampling warpLut / shadeLut get the CRT lookup textures of
+ * crt_lut.c, built once for the output resolution.
+ *
+ * vitaGL has no GPU timer queries, so the time spent in the full-screen
+ * passes is sampled on request by draining the GPU around them.
+ */
+
+#include <vitasdk.h>
+#include <vitaGL.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "crt_lut.h"
+#include "postfx.h"
+#include "shader_cache.h"
+
+#define POSTFX_SOURCE_SIZE (16 * 1024)
+
+typedef struct {
+  const char *name;
+  int source; // samples the frame itself, only allowed first
+  float param;
+  const char *code;
+} postfx_stage;
+
+// Sources get (sampler2D tex, float2 uv, float2 texel), the others (float3 col, float2 uv, float2 texel)
+static const postfx_stage stages[] = {
+  {"fxaa", 1, 0.0f, // console path of FXAA 3.11, as in 2_FXAA_f.cg
+   "  float3 luma = float3(0.299, 0.587, 0.114);\n"
+   "  float lumaNW = dot(tex2D(tex, uv + float2(-0.5, -0.5) * texel).xyz, luma);\n"
+   "  float lumaSW = dot(tex2D(tex, uv + float2(-0.5, 0.5) * texel).xyz, luma);\n"
+   "  float lumaNE = dot(tex2D(tex, uv + float2(0.5, -0.5) * texel).xyz, luma) + 1.0 / 384.0;\n"
+   "  float lumaSE = dot(tex2D(tex, uv + float2(0.5, 0.5) * texel).xyz, luma);\n"
+   "  float3 rgbM = tex2D(tex, uv).xyz;\n"
+   "  float lumaM = dot(rgbM, luma);\n"
+   "  float lumaMax = max(max(lumaNE, lumaSE), max(lumaNW, lumaSW));\n"
+   "  float lumaMin = min(min(lumaNE, lumaSE), min(lumaNW, lumaSW));\n"
+   "  if (max(lumaMax, lumaM) - min(lumaMin, lumaM) < max(FXAA_EDGE_THRESHOLD_MIN, lumaMax * FXAA_EDGE_THRESHOLD))\n"
+   "    return rgbM;\n"
+   "  float dirSwMinusNe = lumaSW - lumaNE, dirSeMinusNw = lumaSE - lumaNW;\n"
+   "  float2 dir1 = normalize(float2(dirSwMinusNe + dirSeMinusNw, dirSwMinusNe - dirSeMinusNw));\n"
+   "  float3 rgbA = tex2D(tex, uv - dir1 * 0.5 * texel).xyz + tex2D(tex, uv + dir1 * 0.5 * texel).xyz;\n"
+   "#if FXAA_QUALITY == 0\n"
+   "  return rgbA * 0.5;\n"
+   "#else\n"
+   "  float2 dir2 = clamp(dir1 / (min(abs(dir1.x), abs(dir1.y)) * FXAA_EDGE_SHARPNESS), float2(-2.0, -2.0), float2(2.0, 2.0));\n"
+   "  float3 rgbB = (tex2D(tex, uv - dir2 * 2.0 * texel).xyz + tex2D(tex, uv + dir2 * 2.0 * texel).xyz) * 0.25 + rgbA * 0.25;\n"
+   "  float lumaB = dot(rgbB, luma);\n"
+   "  return (lumaB < lumaMin || lumaB > lumaMax) ? rgbA * 0.5 : rgbB;\n"
+   "#endif\n"},
+  {"negative", 0, 1.0f,
+   "  return lerp(col, 1.0 - col, P);\n"},
+  {"sepia", 0, 1.0f,
+   "  float3 sepia = float3(dot(col, float3(0.393, 0.769, 0.189)), dot(col, float3(0.349, 0.686, 0.168)),\n"
+   "                        dot(col, float3(0.272, 0.534, 0.131)));\n"
+   "  return lerp(col, sepia, P);\n"},
+  {"greyscale", 0, 1.0f,
+   "  return lerp(col, dot(col, float3(0.21, 0.71, 0.07)).xxx, P);\n"},
+  {"saturation", 0, 1.2f,
+   "  return lerp(dot(col, float3(0.299, 0.587, 0.114)).xxx, col, P);\n"},
+  {"contrast", 0, 1.1f,
+   "  return (col - 0.5) * P + 0.5;\n"},
+  {"brightness", 0, 1.1f,
+   "  return col * P;\n"},
+  {"vignette", 0, 0.25f,
+   "  return col * pow(16.0 * uv.x * uv.y * (1.0 - uv.x) * (1.0 - uv.y), P);\n"},
+  {"scanlines", 0, 0.25f,
+   "  return col * (1.0 - P * step(1.0, fmod(uv.y / texel.y, 2.0)));\n"},
+};
+
+static const char *chain_vert =
+  "void main(float2 position, float2 texcoord, out float4 vPosition : POSITION, out float2 vTexcoord : TEXCOORD0) {\n"
+  "  vPosition = float4(position, 1.f, 1.f);\n"
+  "  vTexcoord = float2(texcoord.x, 1 - texcoord.y);\n"
+  "}\n";
+
+// Compiled instead of a chain whose source could not be built
+static const char *chain_frag_fallback =
+  "float4 main(float2 uv : TEXCOORD0, uniform sampler2D colorMap : TEXUNIT0) : COLOR {\n"
+  "  return float4(tex2D(colorMap, uv).xyz, 1.0);\n"
+  "}\n";
+
+static const postfx_stage *chain[POSTFX_MAX_STAGES];
+static float chain_params[POSTFX_MAX_STAGES];
+static int chain_len = 0;
+
+static GLuint warp_lut = 0, shade_lut = 0;
+
+static postfx_stats stats;
+static int sample_pending = 0;
+static uint64_t sample_start;
+
+static const postfx_stage *find_stage(const char *name) {
+  for (int i = 0; i < sizeof(stages) / sizeof(*stages); i++) {
+    if (!strcmp(stages[i].name, name))
+      return &stages[i];
+  }
+  return NULL;
+}
+
+int postfx_chain_load(const char *file) {
+  FILE *f = fopen(file, "r");
+  if (!f)
+    return 0;
+
+  char line[128];
+  chain_len = 0;
+  while (fgets(line, sizeof(line), f) && chain_len < POSTFX_MAX_STAGES) {
+    char name[32];
+    float param;
+    int n = sscanf(line, "%31s %f", name, &param);
+    if (n < 1 || name[0] == '#')
+      continue;
+
+    const postfx_stage *stage = find_stage(name);
+    if (!stage || (stage->source && chain_len > 0)) {
+      printf("PostFX: skipping stage %s in %s\n", name, file);
+      continue;
+    }
+    chain[chain_len] = stage;
+    chain_params[chain_len++] = n == 2 ? param : stage->param;
+  }
+  fclose(f);
+
+  stats.stages = chain_len;
+  return chain_len;
+}
+
+// Appends to the fragment source being built, len goes negative once it no longer fits
+static void chain_append(char *src, int *len, const char *fmt, ...) {
+  if (*len < 0)
+    return;
+  va_list list;
+  va_start(list, fmt);
+  int n = vsnprintf(&src[*len], POSTFX_SOURCE_SIZE - *len, fmt, list);
+  va_end(list);
+  *len = n < 0 || n >= POSTFX_SOURCE_SIZE - *len ? -1 : *len + n;
+}
+
+void postfx_chain_compile(GLuint vert, GLuint frag) {
+  // Edge thresholds of the FXAA quality presets, low to high, indexed by the quality loadOptions() clamped
+  static const char *fxaa_presets[] = {
+    "#define FXAA_EDGE_THRESHOLD (1.0 / 4.0)\n#define FXAA_EDGE_THRESHOLD_MIN (1.0 / 12.0)\n#define FXAA_EDGE_SHARPNESS 2.0\n",
+    "#define FXAA_EDGE_THRESHOLD (1.0 / 6.0)\n#define FXAA_EDGE_THRESHOLD_MIN (1.0 / 16.0)\n#define FXAA_EDGE_SHARPNESS 4.0\n",
+    "#define FXAA_EDGE_THRESHOLD (1.0 / 8.0)\n#define FXAA_EDGE_THRESHOLD_MIN (1.0 / 32.0)\n#define FXAA_EDGE_SHARPNESS 8.0\n"
+  };
+
+  shader_cache_compile(vert, chain_vert, strlen(chain_vert));
+
+  char *src = malloc(POSTFX_SOURCE_SIZE);
+  if (!src) {
+    printf("PostFX: out of memory building the chain, falling back to a plain copy\n");
+    shader_cache_compile(frag, chain_frag_fallback, strlen(chain_frag_fallback));
+    return;
+  }
+
+  int len = 0;
+  chain_append(src, &len, "#define FXAA_QUALITY %d\n%s\n", options.fxaa_quality, fxaa_presets[options.fxaa_quality]);
+
+  for (int i = 0; i < chain_len; i++) {
+    if (chain[i]->source)
+      chain_append(src, &len, "float3 stage%d(sampler2D tex, float2 uv, float2 texel) {\n", i);
+    else
+      chain_append(src, &len, "float3 stage%d(float3 col, float2 uv, float2 texel) {\n", i);
+    chain_append(src, &len, "#define P %f\n%s#undef P\n}\n\n", chain_params[i], chain[i]->code);
+  }
+
+  chain_append(src, &len, "float4 main(float2 uv : TEXCOORD0, uniform float2 texel, uniform sampler2D colorMap : TEXUNIT0) : COLOR {\n");
+  if (chain_len > 0 && chain[0]->source)
+    chain_append(src, &len, "  float3 col = stage0(colorMap, uv, texel);\n");
+  else
+    chain_append(src, &len, "  float3 col = tex2D(colorMap, uv).xyz;\n");
+  for (int i = 0; i < chain_len; i++) {
+    if (!chain[i]->source)
+      chain_append(src, &len, "  col = stage%d(col, uv, texel);\n", i);
+  }
+  chain_append(src, &len, "  return float4(col, 1.0);\n}\n");
+
+  if (len < 0) {
+    printf("PostFX: chain source exceeds %d bytes, falling back to a plain copy\n", POSTFX_SOURCE_SIZE);
+    shader_cache_compile(frag, chain_frag_fallback, strlen(chain_frag_fallback));
+  } else {
+    shader_cache_compile(frag, src, len);
+  }
+  free(src);
+}
+
+void postfx_setup(GLuint prog, int width, int height) {
+  // Effects get the size of the frame they process in either form
+  GLint texel = glGetUniformLocation(prog, "texel");
+  GLint resolution = glGetUniformLocation(prog, "iResolution");
+  glUseProgram(prog);
+  if (texel != -1)
+    glUniform2f(texel, 1.0f / width, 1.0f / height);
+  if (resolution != -1)
+    glUniform2f(resolution, width, height);
+  glUseProgram(0);
+}
+
+void postfx_lut_setup(GLuint prog, int width, int height) {
+  GLint warp_unif = glGetUniformLocation(prog, "warpLut");
+  GLint shade_unif = glGetUniformLocation(prog, "shadeLut");
+  if (warp_unif == -1 || shade_unif == -1)
+    return;
+
+  uint8_t *warp = malloc(width * height * 4);
+  uint8_t *shade = malloc(width * height);
+  crt_lut_build(width, height, warp, shade);
+
+  // Read at pixel centers, filtering would blend the packed bytes
+  glGenTextures(1, &warp_lut);
+  glBindTexture(GL_TEXTURE_2D, warp_lut);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, warp);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glGenTextures(1, &shade_lut);
+  glBindTexture(GL_TEXTURE_2D, shade_lut);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, width, height, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, shade);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  free(warp);
+  free(shade);
+}
+
+void postfx_lut_bind(void) {
+  if (!warp_lut)
+    return;
+
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, warp_lut);
+  glActiveTexture(GL_TEXTURE2);
+  glBindTexture(GL_TEXTURE_2D, shade_lut);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void postfx_request_sample(void) {
+  sample_pending = 1;
+}
+
+void postfx_sample_begin(void) {
+  if (!sample_pending)
+    return;
+
+  // Let the GPU catch up with the game's frame so only the passes are left to time
+  glFinish();
+  sample_start = sceKernelGetProcessTimeWide();
+}
+
+void postfx_sample_end(int passes) {
+  stats.passes = passes;
+  if (!sample_pending)
+    return;
+
+  glFinish();
+  stats.gpu_us = sceKernelGetProcessTimeWide() - sample_start;
+  sample_pending = 0;
+}
+
+void postfx_get_stats(postfx_stats *out) {
+  *out = stats;
+}
@@ -0,0 +1,27 @@
+#ifndef __POSTFX_H__
+#define __POSTFX_H__
+
+#include <stdint.h>
+#include <vitaGL.h>
+
+#define POSTFX_MAX_STAGES 8
+
+typedef struct {
+  int stages;      // stages fused into the PostFX program, 0 for a single effect
+  int passes;      // full-screen passes per frame, resolve and upscaling included
+  uint32_t gpu_us; // last sampled time for all of them, 0 until sampled
+} postfx_stats;
+
+int postfx_chain_load(const char *file);
+void postfx_chain_compile(GLuint vert, GLuint frag);
+
+void postfx_setup(GLuint prog, int width, int height);
+void postfx_lut_setup(GLuint prog, int width, int height);
+void postfx_lut_bind(void);
+
+void postfx_request_sample(void);
+void postfx_sample_begin(void);
+void postfx_sample_end(int passes);
+void postfx_get_stats(postfx_stats *stats);
+
+#endif
@@ -0,0 +1,224 @@
+/* shader_cache.c -- persistent cache of runtime compiled shaders
+ *
+ * Cg sources handed to the runtime compiler (PostFX effects, the HUD, the
+ * resolve and upscaling passes) are looked up in SHADER_CACHE_PATH first,
+ * keyed by a hash of the source and of the installed libshacccg.suprx, so
+ * replacing the compiler invalidates everything it produced. A hit goes
+ * straight to glShaderBinary(); a miss compiles as before and stores the
+ * resulting GXP for the next boot. The shaders vitaGL generates on its own
+ * share the same cache, see the vitashark hooks below.
+ */
+
+#include <vitasdk.h>
+#include <vitaGL.h>
+#include <vitashark.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "shader_cache.h"
+
+#define SHADER_CACHE_MAGIC 0x53344646 // FF4S
+
+typedef struct {
+  uint32_t magic;
+  uint32_t size;
+  uint64_t compiler;
+  uint64_t source;
+} shader_cache_header;
+
+static shader_cache_stats stats;
+static uint64_t compiler_hash = 0;
+static int explicit_compile = 0;
+
+static uint64_t fnv1a64(uint64_t h, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++) {
+    h ^= p[i];
+    h *= 0x100000001B3ULL;
+  }
+  return h;
+}
+
+static void shader_cache_init(void) {
+  static const char *compilers[] = {"ur0:/data/libshacccg.suprx", "ur0:/data/external/libshacccg.suprx"};
+
+  // Size and modification date identify the compiler build well enough
+  compiler_hash = 0xCBF29CE484222325ULL;
+  for (int i = 0; i < sizeof(compilers) / sizeof(*compilers); i++) {
+    SceIoStat st;
+    if (sceIoGetstat(compilers[i], &st) >= 0) {
+      compiler_hash = fnv1a64(compiler_hash, &st.st_size, sizeof(st.st_size));
+      compiler_hash = fnv1a64(compiler_hash, &st.st_mtime, sizeof(st.st_mtime));
+      break;
+    }
+  }
+  sceIoMkdir(SHADER_CACHE_PATH, 0777);
+}
+
+static void *shader_cache_read(const char *path, uint64_t source, uint32_t *size) {
+  FILE *f = fopen(path, "rb");
+  if (!f)
+    return NULL;
+
+  shader_cache_header hdr;
+  void *bin = NULL;
+  if (fread(&hdr, sizeof(hdr), 1, f) == 1 && hdr.magic == SHADER_CACHE_MAGIC && hdr.compiler == compiler_hash &&
+      hdr.source == source && hdr.size > 0 && hdr.size <= SHADER_CACHE_MAX_SIZE) {
+    bin = malloc(hdr.size);
+    if (bin && fread(bin, 1, hdr.size, f) == hdr.size) {
+      *size = hdr.size;
+    } else {
+      free(bin);
+      bin = NULL;
+    }
+  }
+  fclose(f);
+  return bin;
+}
+
+static void shader_cache_write(const char *path, uint64_t source, const void *bin, uint32_t size) {
+  FILE *f = fopen(path, "wb");
+  if (f) {
+    shader_cache_header hdr = {SHADER_CACHE_MAGIC, size, compiler_hash, source};
+    fwrite(&hdr, sizeof(hdr), 1, f);
+    fwrite(bin, 1, size, f);
+    fclose(f);
+    stats.stored++;
+  }
+}
+
+static uint64_t shader_cache_key(const void *data, size_t len, char *path, uint64_t salt) {
+  if (!compiler_hash)
+    shader_cache_init();
+
+  uint64_t source = fnv1a64(0xCBF29CE484222325ULL, data, len);
+  source = fnv1a64(source, &salt, sizeof(salt));
+  snprintf(path, 256, "%s/%016llx.gxp", SHADER_CACHE_PATH, fnv1a64(source, &compiler_hash, sizeof(compiler_hash)));
+  return source;
+}
+
+void shader_cache_compile(GLuint shader, const char *src, GLint len) {
+  char path[256];
+  uint64_t source = shader_cache_key(src, len, path, 0);
+
+  uint64_t start = sceKernelGetProcessTimeWide();
+  uint32_t size;
+  void *bin = shader_cache_read(path, source, &size);
+  if (bin) {
+    glShaderBinary(1, &shader, 0, bin, size);
+    free(bin);
+    stats.hits++;
+    stats.load_us += sceKernelGetProcessTimeWide() - start;
+    return;
+  }
+
+  // Stored below from what vitaGL kept, the compiler hook has nothing to add
+  explicit_compile = 1;
+  glShaderSource(shader, 1, &src, &len);
+  glCompileShader(shader);
+  explicit_compile = 0;
+  stats.misses++;
+  stats.compile_us += sceKernelGetProcessTimeWide() - start;
+
+  bin = malloc(SHADER_CACHE_MAX_SIZE);
+  if (!bin)
+    return;
+  GLsizei bin_size = 0;
+  vglGetShaderBinary(shader, SHADER_CACHE_MAX_SIZE, &bin_size, bin);
+  // Nothing to keep from a failed compilation, and a full buffer means the binary was cut short
+  if (bin_size > 0 && bin_size < SHADER_CACHE_MAX_SIZE)
+    shader_cache_write(path, source, bin, bin_size);
+  free(bin);
+}
+
+/*
+ * vitaGL emulates the fixed function pipeline libff4.so draws with by
+ * generating a shader for each state combination it meets and compiling it
+ * with vitashark on the spot. The linker routes those compilations through
+ * here (--wrap), so permutations seen in earlier sessions come from the
+ * cache instead. vitaGL copies the program out before it calls
+ * shark_clear_output(), which is when a cached one is released.
+ */
+SceGxmProgram *__real_shark_compile_shader_extended(const char *src, uint32_t *size, shark_type type, shark_opt opt,
+                                                    int32_t use_fastmath, int32_t use_fastprecision, int32_t use_fastint);
+SceGxmProgram *__real_shark_compile_shader(const char *src, uint32_t *size, shark_type type);
+void __real_shark_clear_output(void);
+
+static void *hook_bin = NULL;
+
+static SceGxmProgram *shader_cache_shark(const char *src, uint32_t *size, uint64_t salt,
+                                         SceGxmProgram *(*compile)(const char *, uint32_t *, void *), void *arg) {
+  if (explicit_compile)
+    return compile(src, size, arg);
+
+  char path[256];
+  uint64_t source = shader_cache_key(src, strlen(src), path, salt);
+
+  uint64_t start = sceKernelGetProcessTimeWide();
+  hook_bin = shader_cache_read(path, source, size);
+  if (hook_bin) {
+    stats.hits++;
+    stats.load_us += sceKernelGetProcessTimeWide() - start;
+    return (SceGxmProgram *)hook_bin;
+  }
+
+  SceGxmProgram *prog = compile(src, size, arg);
+  stats.misses++;
+  stats.compile_us += sceKernelGetProcessTimeWide() - start;
+  if (prog && *size < SHADER_CACHE_MAX_SIZE)
+    shader_cache_write(path, source, prog, *size);
+  return prog;
+}
+
+typedef struct {
+  shark_type type;
+  shark_opt opt;
+  int32_t fastmath, fastprecision, fastint;
+} shark_args;
+
+static SceGxmProgram *compile_extended(const char *src, uint32_t *size, void *arg) {
+  shark_args *a = (shark_args *)arg;
+  return __real_shark_compile_shader_extended(src, size, a->type, a->opt, a->fastmath, a->fastprecision, a->fastint);
+}
+
+static SceGxmProgram *compile_default(const char *src, uint32_t *size, void *arg) {
+  return __real_shark_compile_shader(src, size, *(shark_type *)arg);
+}
+
+SceGxmProgram *__wrap_shark_compile_shader_extended(const char *src, uint32_t *size, shark_type type, shark_opt opt,
+                                                    int32_t use_fastmath, int32_t use_fastprecision, int32_t use_fastint) {
+  shark_args a = {type, opt, use_fastmath, use_fastprecision, use_fastint};
+  uint64_t salt = 1 + type + (opt << 2) + (use_fastmath << 6) + (use_fastprecision << 7) + (use_fastint << 8);
+  return shader_cache_shark(src, size, salt, compile_extended, &a);
+}
+
+SceGxmProgram *__wrap_shark_compile_shader(const char *src, uint32_t *size, shark_type type) {
+  return shader_cache_shark(src, size, 0x1000 + type, compile_default, &type);
+}
+
+void __wrap_shark_clear_output(void) {
+  free(hook_bin);
+  hook_bin = NULL;
+  __real_shark_clear_output();
+}
+
+void shader_cache_get_stats(shader_cache_stats *out) {
+  *out = stats;
+}
+
+void shader_cache_report_boot(void) {
+  // Process time starts at zero, so it is the time since the app was launched
+  uint64_t now = sceKernelGetProcessTimeWide();
+  stats.boot_misses = stats.misses;
+  printf("First frame after %llu ms, shaders: %u cached (%llu ms), %u compiled (%llu ms)\n", now / 1000, stats.hits,
+         stats.load_us / 1000, stats.misses, stats.compile_us / 1000);
+
+  FILE *f = fopen(BOOT_TIME_FILE, "a");
+  if (f) {
+    fprintf(f, "first frame %llu ms, %u shaders cached in %llu ms, %u compiled in %llu ms\n", now / 1000, stats.hits,
+            stats.load_us / 1000, stats.misses, stats.compile_us / 1000);
+    fclose(f);
+  }
+}
@@ -0,0 +1,24 @@
+#ifndef __SHADER_CACHE_H__
+#define __SHADER_CACHE_H__
+
+#include <stdint.h>
+#include <vitaGL.h>
+
+#define SHADER_CACHE_PATH DATA_PATH "/shaders"
+#define SHADER_CACHE_MAX_SIZE (64 * 1024)
+#define BOOT_TIME_FILE DATA_PATH "/boot_time.txt"
+
+typedef struct {
+  uint32_t hits;        // shaders loaded from a cached binary
+  uint32_t misses;      // shaders compiled from source
+  uint32_t stored;      // compiled binaries written back to the cache
+  uint32_t boot_misses; // shaders compiled before the first frame
+  uint64_t load_us;     // time spent loading cached binaries
+  uint64_t compile_us;  // time spent in the runtime compiler
+} shader_cache_stats;
+
+void shader_cache_compile(GLuint shader, const char *src, GLint len);
+void shader_cache_get_stats(shader_cache_stats *stats);
+void shader_cache_report_boot(void);
+
+#endif
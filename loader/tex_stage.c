@@ -0,0 +1,294 @@
+/* tex_stage.c -- per-texture staging of glTexSubImage2D updates
+ *
+ * The game streams lots of tiny sub-rect updates (mostly glyphs) into a
+ * handful of textures every frame. Uploads are held back here, merged when
+ * they touch each other and only handed to vitaGL right before a draw
+ * samples the texture, or at the end of the frame for those no draw used.
+ *
+ * bound_tex follows the game's glBindTexture() calls. The loader binds its
+ * own textures to draw (HUD, PostFX, movies), so it calls tex_stage_resync()
+ * once done for vitaGL to have the game's texture bound again.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tex_stage.h"
+
+#define TEX_STAGE_MAX_TEXTURES 32
+#define TEX_STAGE_MAX_RECTS 64
+#define TEX_STAGE_MAX_BYTES (2 * 1024 * 1024)
+
+#define ALIGN_ROW(x) (((x) + 3) & ~3) // GL_UNPACK_ALIGNMENT is never changed by the game
+
+typedef struct {
+  GLint level;
+  GLint x, y;
+  GLsizei w, h;
+  GLenum format, type;
+  int bpp;
+  uint8_t *pixels;
+} tex_stage_rect;
+
+typedef struct {
+  GLuint tex;
+  int num_rects;
+  tex_stage_rect rects[TEX_STAGE_MAX_RECTS];
+} tex_stage_entry;
+
+static tex_stage_entry entries[TEX_STAGE_MAX_TEXTURES];
+static int num_entries = 0;
+static GLuint bound_tex = 0;
+static tex_stage_stats stats;
+
+static int tex_stage_bpp(GLenum format, GLenum type) {
+  switch (type) {
+  case GL_UNSIGNED_SHORT_5_6_5:
+  case GL_UNSIGNED_SHORT_4_4_4_4:
+  case GL_UNSIGNED_SHORT_5_5_5_1:
+    return 2;
+  case GL_UNSIGNED_BYTE:
+    switch (format) {
+    case GL_RGBA:
+      return 4;
+    case GL_RGB:
+      return 3;
+    case GL_LUMINANCE_ALPHA:
+      return 2;
+    case GL_ALPHA:
+    case GL_LUMINANCE:
+      return 1;
+    default:
+      return 0;
+    }
+  default:
+    return 0;
+  }
+}
+
+static inline int rect_stride(const tex_stage_rect *r) {
+  return ALIGN_ROW(r->w * r->bpp);
+}
+
+static inline int rect_size(const tex_stage_rect *r) {
+  return rect_stride(r) * r->h;
+}
+
+static inline int rects_intersect(const tex_stage_rect *a, const tex_stage_rect *b) {
+  return a->x < b->x + b->w && b->x < a->x + a->w &&
+         a->y < b->y + b->h && b->y < a->y + a->h;
+}
+
+static inline int rect_contains(const tex_stage_rect *a, const tex_stage_rect *b) {
+  return b->x >= a->x && b->y >= a->y &&
+         b->x + b->w <= a->x + a->w && b->y + b->h <= a->y + a->h;
+}
+
+// Two rects can only be merged if their union is fully covered by them,
+// otherwise we would upload garbage over texels we never got.
+static int rects_mergeable(const tex_stage_rect *a, const tex_stage_rect *b) {
+  if (a->level != b->level || a->format != b->format || a->type != b->type)
+    return 0;
+  if (a->y == b->y && a->h == b->h)
+    return a->x <= b->x + b->w && b->x <= a->x + a->w;
+  if (a->x == b->x && a->w == b->w)
+    return a->y <= b->y + b->h && b->y <= a->y + a->h;
+  return rect_contains(a, b) || rect_contains(b, a);
+}
+
+static void rect_blit(tex_stage_rect *dst, const tex_stage_rect *src) {
+  int dst_stride = rect_stride(dst);
+  int src_stride = rect_stride(src);
+  int row_bytes = src->w * src->bpp;
+  uint8_t *d = dst->pixels + (src->y - dst->y) * dst_stride + (src->x - dst->x) * dst->bpp;
+  const uint8_t *s = src->pixels;
+  for (int i = 0; i < src->h; i++) {
+    memcpy(d, s, row_bytes);
+    d += dst_stride;
+    s += src_stride;
+  }
+}
+
+static void rect_free(tex_stage_rect *r) {
+  stats.bytes_staged -= rect_size(r);
+  free(r->pixels);
+  r->pixels = NULL;
+}
+
+// Folds src (the newer update) into dst, replacing dst with the union.
+// Returns 0, leaving both untouched, if the union can't be allocated.
+static int rect_merge(tex_stage_rect *dst, tex_stage_rect *src) {
+  if (rect_contains(dst, src)) {
+    rect_blit(dst, src);
+    rect_free(src);
+    return 1;
+  }
+
+  if (rect_contains(src, dst)) {
+    rect_free(dst);
+    *dst = *src;
+    return 1;
+  }
+
+  tex_stage_rect u = *dst;
+  u.x = dst->x < src->x ? dst->x : src->x;
+  u.y = dst->y < src->y ? dst->y : src->y;
+  u.w = (dst->x + dst->w > src->x + src->w ? dst->x + dst->w : src->x + src->w) - u.x;
+  u.h = (dst->y + dst->h > src->y + src->h ? dst->y + dst->h : src->y + src->h) - u.y;
+  u.pixels = malloc(rect_size(&u));
+  if (!u.pixels)
+    return 0;
+  stats.bytes_staged += rect_size(&u);
+
+  rect_blit(&u, dst);
+  rect_blit(&u, src);
+  rect_free(dst);
+  rect_free(src);
+  *dst = u;
+  return 1;
+}
+
+static tex_stage_entry *tex_stage_find(GLuint tex) {
+  for (int i = 0; i < num_entries; i++) {
+    if (entries[i].tex == tex)
+      return &entries[i];
+  }
+  return NULL;
+}
+
+static void tex_stage_upload(tex_stage_entry *e) {
+  if (!e->num_rects)
+    return;
+
+  if (e->tex != bound_tex)
+    glBindTexture(GL_TEXTURE_2D, e->tex);
+  for (int i = 0; i < e->num_rects; i++) {
+    tex_stage_rect *r = &e->rects[i];
+    glTexSubImage2D(GL_TEXTURE_2D, r->level, r->x, r->y, r->w, r->h, r->format, r->type, r->pixels);
+    rect_free(r);
+    stats.uploads_issued++;
+  }
+  if (e->tex != bound_tex)
+    glBindTexture(GL_TEXTURE_2D, bound_tex);
+  e->num_rects = 0;
+}
+
+static void tex_stage_remove(tex_stage_entry *e) {
+  *e = entries[--num_entries];
+}
+
+void tex_stage_bind(GLuint tex) {
+  bound_tex = tex;
+}
+
+GLuint tex_stage_get_bound(void) {
+  return bound_tex;
+}
+
+void tex_stage_resync(void) {
+  glBindTexture(GL_TEXTURE_2D, bound_tex);
+}
+
+void tex_stage_flush(GLuint tex) {
+  tex_stage_entry *e = tex_stage_find(tex);
+  if (e) {
+    tex_stage_upload(e);
+    tex_stage_remove(e);
+  }
+}
+
+void tex_stage_flush_bound(void) {
+  if (num_entries)
+    tex_stage_flush(bound_tex);
+}
+
+void tex_stage_discard(GLuint tex, GLint level) {
+  tex_stage_entry *e = tex_stage_find(tex);
+  if (!e)
+    return;
+
+  int n = 0;
+  for (int i = 0; i < e->num_rects; i++) {
+    if (level < 0 || e->rects[i].level == level)
+      rect_free(&e->rects[i]);
+    else
+      e->rects[n++] = e->rects[i];
+  }
+  e->num_rects = n;
+  if (!n)
+    tex_stage_remove(e);
+}
+
+int tex_stage_sub_image(GLenum target, GLint level, GLint x, GLint y, GLsizei w, GLsizei h, GLenum format, GLenum type, const void *pixels) {
+  stats.uploads_requested++;
+
+  int bpp = tex_stage_bpp(format, type);
+  if (target != GL_TEXTURE_2D || !bound_tex || !bpp || !pixels || w <= 0 || h <= 0)
+    return 0;
+
+  // Too short on memory to stage it, the caller uploads it right away
+  tex_stage_rect cur = {level, x, y, w, h, format, type, bpp, NULL};
+  cur.pixels = malloc(rect_size(&cur));
+  if (!cur.pixels)
+    return 0;
+  memcpy(cur.pixels, pixels, rect_size(&cur));
+  stats.bytes_staged += rect_size(&cur);
+
+  tex_stage_entry *e = tex_stage_find(bound_tex);
+  if (!e) {
+    if (num_entries == TEX_STAGE_MAX_TEXTURES) {
+      tex_stage_upload(&entries[0]);
+      tex_stage_remove(&entries[0]);
+    }
+    e = &entries[num_entries++];
+    e->tex = bound_tex;
+    e->num_rects = 0;
+  }
+
+  // Merge backwards: a staged rect may absorb the new one only if nothing
+  // queued after it overlaps the union, so upload order stays correct.
+  for (int i = e->num_rects - 1; i >= 0; i--) {
+    tex_stage_rect *r = &e->rects[i];
+    if (!rects_mergeable(r, &cur))
+      continue;
+
+    tex_stage_rect u = *r;
+    u.x = r->x < cur.x ? r->x : cur.x;
+    u.y = r->y < cur.y ? r->y : cur.y;
+    u.w = (r->x + r->w > cur.x + cur.w ? r->x + r->w : cur.x + cur.w) - u.x;
+    u.h = (r->y + r->h > cur.y + cur.h ? r->y + r->h : cur.y + cur.h) - u.y;
+
+    int blocked = 0;
+    for (int j = i + 1; j < e->num_rects && !blocked; j++)
+      blocked = rects_intersect(&e->rects[j], &u);
+    if (blocked || !rect_merge(r, &cur))
+      continue;
+
+    cur = *r;
+    memmove(r, r + 1, (e->num_rects - i - 1) * sizeof(tex_stage_rect));
+    e->num_rects--;
+    stats.uploads_merged++;
+    i = e->num_rects;
+  }
+
+  if (e->num_rects == TEX_STAGE_MAX_RECTS)
+    tex_stage_upload(e);
+  e->rects[e->num_rects++] = cur;
+
+  if (stats.bytes_staged > TEX_STAGE_MAX_BYTES)
+    tex_stage_upload(e);
+
+  return 1;
+}
+
+void tex_stage_end_frame(void) {
+  tex_stage_resync();
+  while (num_entries) {
+    tex_stage_upload(&entries[0]);
+    tex_stage_remove(&entries[0]);
+  }
+}
+
+void tex_stage_get_stats(tex_stage_stats *out) {
+  *out = stats;
+}
@@ -0,0 +1,24 @@
+#ifndef __TEX_STAGE_H__
+#define __TEX_STAGE_H__
+
+#include <stdint.h>
+#include <vitaGL.h>
+
+typedef struct {
+  uint32_t uploads_requested; // glTexSubImage2D calls issued by the game
+  uint32_t uploads_issued;    // glTexSubImage2D calls that reached vitaGL
+  uint32_t uploads_merged;    // staged rectangles folded into another one
+  uint32_t bytes_staged;      // pixel data currently held back
+} tex_stage_stats;
+
+void tex_stage_bind(GLuint tex);
+GLuint tex_stage_get_bound(void);
+void tex_stage_resync(void);
+int tex_stage_sub_image(GLenum target, GLint level, GLint x, GLint y, GLsizei w, GLsizei h, GLenum format, GLenum type, const void *pixels);
+void tex_stage_flush(GLuint tex);
+void tex_stage_flush_bound(void);
+void tex_stage_discard(GLuint tex, GLint level);
+void tex_stage_end_frame(void);
+void tex_stage_get_stats(tex_stage_stats *stats);
+
+#endif
@@ -0,0 +1,211 @@
+/* upscale.c -- edge adaptive upscaling of the offscreen render
+ *
+ * A port of the two FidelityFX Super Resolution 1.0 passes to Cg. EASU
+ * reconstructs the output resolution from a 12 tap neighbourhood, using a
+ * Lanczos-like kernel stretched along the local edge direction. RCAS then
+ * sharpens the result, limiting itself so it never creates new extremes.
+ * EASU runs into an intermediate target the size of the display, RCAS
+ * writes to whatever comes next: the PostFX target or the screen.
+ *
+ * tools/upscale_compare.c carries the same math for quality checks on a
+ * desktop.
+ */
+
+#include <vitasdk.h>
+#include <vitaGL.h>
+#include <math.h>
+#include <string.h>
+
+#include "config.h"
+#include "shader_cache.h"
+#include "upscale.h"
+
+extern float postfx_pos[8];
+
+static const char *upscale_vert =
+  "void main(float2 position, float2 texcoord, uniform float2 outSize,\n"
+  "  out float4 vPosition : POSITION, out float2 vPixel : TEXCOORD0) {\n"
+  "  vPosition = float4(position, 1.f, 1.f);\n"
+  "  vPixel = texcoord * outSize;\n"
+  "}\n";
+
+static const char *easu_frag =
+  "float luma(float3 c) {\n"
+  "  return c.b * 0.5f + (c.r * 0.5f + c.g);\n"
+  "}\n"
+  "float3 tap(sampler2D tex, float2 p, float4 bounds) {\n"
+  "  return tex2D(tex, clamp(p, bounds.xy, bounds.zw)).rgb;\n"
+  "}\n"
+  "void easuSet(inout float2 dir, inout float len, float w, float lA, float lB, float lC, float lD, float lE) {\n"
+  "  float lenX = saturate(abs(lD - lB) / max(max(abs(lD - lC), abs(lC - lB)), 1.f / 65536.f));\n"
+  "  float lenY = saturate(abs(lE - lA) / max(max(abs(lE - lC), abs(lC - lA)), 1.f / 65536.f));\n"
+  "  dir += float2(lD - lB, lE - lA) * w;\n"
+  "  len += (lenX * lenX + lenY * lenY) * w;\n"
+  "}\n"
+  "void easuTap(inout float3 aC, inout float aW, float2 off, float2 dir, float2 len, float lob, float clp, float3 c) {\n"
+  "  float2 v = float2(off.x * dir.x + off.y * dir.y, off.y * dir.x - off.x * dir.y) * len;\n"
+  "  float d2 = min(dot(v, v), clp);\n"
+  "  float wB = 2.f / 5.f * d2 - 1.f;\n"
+  "  float wA = lob * d2 - 1.f;\n"
+  "  wB *= wB;\n"
+  "  wA *= wA;\n"
+  "  wB = 25.f / 16.f * wB - (25.f / 16.f - 1.f);\n"
+  "  aC += c * (wB * wA);\n"
+  "  aW += wB * wA;\n"
+  "}\n"
+  "float4 main(float2 vPixel : TEXCOORD0, uniform float2 scale, uniform float2 texel, uniform float4 bounds,\n"
+  "  uniform sampler2D tex : TEXUNIT0) : COLOR {\n"
+  "  float2 pp = vPixel * scale - 0.5f;\n"
+  "  float2 fp = floor(pp);\n"
+  "  pp -= fp;\n"
+  "  float2 p0 = (fp + 0.5f) * texel;\n"
+  "  float3 b = tap(tex, p0 + float2(0.f, -1.f) * texel, bounds);\n"
+  "  float3 c = tap(tex, p0 + float2(1.f, -1.f) * texel, bounds);\n"
+  "  float3 e = tap(tex, p0 + float2(-1.f, 0.f) * texel, bounds);\n"
+  "  float3 f = tap(tex, p0, bounds);\n"
+  "  float3 g = tap(tex, p0 + float2(1.f, 0.f) * texel, bounds);\n"
+  "  float3 h = tap(tex, p0 + float2(2.f, 0.f) * texel, bounds);\n"
+  "  float3 i = tap(tex, p0 + float2(-1.f, 1.f) * texel, bounds);\n"
+  "  float3 j = tap(tex, p0 + float2(0.f, 1.f) * texel, bounds);\n"
+  "  float3 k = tap(tex, p0 + float2(1.f, 1.f) * texel, bounds);\n"
+  "  float3 l = tap(tex, p0 + float2(2.f, 1.f) * texel, bounds);\n"
+  "  float3 n = tap(tex, p0 + float2(0.f, 2.f) * texel, bounds);\n"
+  "  float3 o = tap(tex, p0 + float2(1.f, 2.f) * texel, bounds);\n"
+  "  float bL = luma(b), cL = luma(c), eL = luma(e), fL = luma(f), gL = luma(g), hL = luma(h);\n"
+  "  float iL = luma(i), jL = luma(j), kL = luma(k), lL = luma(l), nL = luma(n), oL = luma(o);\n"
+  "  float2 dir = float2(0.f, 0.f);\n"
+  "  float len = 0.f;\n"
+  "  easuSet(dir, len, (1.f - pp.x) * (1.f - pp.y), bL, eL, fL, gL, jL);\n"
+  "  easuSet(dir, len, pp.x * (1.f - pp.y), cL, fL, gL, hL, kL);\n"
+  "  easuSet(dir, len, (1.f - pp.x) * pp.y, fL, iL, jL, kL, nL);\n"
+  "  easuSet(dir, len, pp.x * pp.y, gL, jL, kL, lL, oL);\n"
+  "  float dirR = dot(dir, dir);\n"
+  "  bool zro = dirR < 1.f / 32768.f;\n"
+  "  dirR = zro ? 1.f : rsqrt(dirR);\n"
+  "  dir.x = zro ? 1.f : dir.x;\n"
+  "  dir *= dirR;\n"
+  "  len = len * 0.5f;\n"
+  "  len *= len;\n"
+  "  float stretch = dot(dir, dir) / max(abs(dir.x), abs(dir.y));\n"
+  "  float2 len2 = float2(1.f + (stretch - 1.f) * len, 1.f - 0.5f * len);\n"
+  "  float lob = 0.5f + ((1.f / 4.f - 0.04f) - 0.5f) * len;\n"
+  "  float clp = 1.f / lob;\n"
+  "  float3 aC = float3(0.f, 0.f, 0.f);\n"
+  "  float aW = 0.f;\n"
+  "  easuTap(aC, aW, float2(0.f, -1.f) - pp, dir, len2, lob, clp, b);\n"
+  "  easuTap(aC, aW, float2(1.f, -1.f) - pp, dir, len2, lob, clp, c);\n"
+  "  easuTap(aC, aW, float2(-1.f, 1.f) - pp, dir, len2, lob, clp, i);\n"
+  "  easuTap(aC, aW, float2(0.f, 1.f) - pp, dir, len2, lob, clp, j);\n"
+  "  easuTap(aC, aW, float2(0.f, 0.f) - pp, dir, len2, lob, clp, f);\n"
+  "  easuTap(aC, aW, float2(-1.f, 0.f) - pp, dir, len2, lob, clp, e);\n"
+  "  easuTap(aC, aW, float2(1.f, 1.f) - pp, dir, len2, lob, clp, k);\n"
+  "  easuTap(aC, aW, float2(2.f, 1.f) - pp, dir, len2, lob, clp, l);\n"
+  "  easuTap(aC, aW, float2(2.f, 0.f) - pp, dir, len2, lob, clp, h);\n"
+  "  easuTap(aC, aW, float2(1.f, 0.f) - pp, dir, len2, lob, clp, g);\n"
+  "  easuTap(aC, aW, float2(1.f, 2.f) - pp, dir, len2, lob, clp, o);\n"
+  "  easuTap(aC, aW, float2(0.f, 2.f) - pp, dir, len2, lob, clp, n);\n"
+  "  float3 mn = min(min(f, g), min(j, k));\n"
+  "  float3 mx = max(max(f, g), max(j, k));\n"
+  "  return float4(clamp(aC / aW, mn, mx), 1.f);\n"
+  "}\n";
+
+static const char *rcas_frag =
+  "float4 main(float2 vPixel : TEXCOORD0, uniform float2 texel, uniform float sharpness,\n"
+  "  uniform sampler2D tex : TEXUNIT0) : COLOR {\n"
+  "  float2 p = vPixel * texel;\n"
+  "  float3 b = tex2D(tex, p + float2(0.f, -texel.y)).rgb;\n"
+  "  float3 d = tex2D(tex, p + float2(-texel.x, 0.f)).rgb;\n"
+  "  float3 e = tex2D(tex, p).rgb;\n"
+  "  float3 f = tex2D(tex, p + float2(texel.x, 0.f)).rgb;\n"
+  "  float3 h = tex2D(tex, p + float2(0.f, texel.y)).rgb;\n"
+  "  float3 mn4 = min(min(b, d), min(f, h));\n"
+  "  float3 mx4 = max(max(b, d), max(f, h));\n"
+  "  float3 hitMin = min(mn4, e) / (4.f * mx4 + 1.f / 65536.f);\n"
+  "  float3 hitMax = (1.f - max(mx4, e)) / (4.f * mn4 - 4.f - 1.f / 65536.f);\n"
+  "  float3 lobeRGB = max(-hitMin, hitMax);\n"
+  "  float lobe = max(-0.1875f, min(max(lobeRGB.r, max(lobeRGB.g, lobeRGB.b)), 0.f)) * sharpness;\n"
+  "  return float4((lobe * (b + d + f + h) + e) / (4.f * lobe + 1.f), 1.f);\n"
+  "}\n";
+
+static float upscale_texcoord[8] = {
+  0.0f, 1.0f,
+  0.0f, 0.0f,
+  1.0f, 1.0f,
+  1.0f, 0.0f
+};
+
+static int out_w, out_h;
+static GLuint easu_fb, easu_tex;
+static GLuint easu_prog, rcas_prog;
+static GLint easu_out_size, easu_scale, easu_texel, easu_bounds;
+static GLint rcas_out_size, rcas_texel, rcas_sharpness;
+
+static GLuint upscale_program(GLuint vs, const char *frag) {
+  GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
+  shader_cache_compile(fs, frag, strlen(frag));
+
+  GLuint prog = glCreateProgram();
+  glAttachShader(prog, vs);
+  glAttachShader(prog, fs);
+  glBindAttribLocation(prog, 0, "position");
+  glBindAttribLocation(prog, 1, "texcoord");
+  glLinkProgram(prog);
+  return prog;
+}
+
+void upscale_init(int width, int height) {
+  out_w = width;
+  out_h = height;
+
+  glGenTextures(1, &easu_tex);
+  glBindTexture(GL_TEXTURE_2D, easu_tex);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glGenFramebuffers(1, &easu_fb);
+  glBindFramebuffer(GL_FRAMEBUFFER, easu_fb);
+  glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, easu_tex, 0);
+
+  GLuint vs = glCreateShader(GL_VERTEX_SHADER);
+  shader_cache_compile(vs, upscale_vert, strlen(upscale_vert));
+
+  easu_prog = upscale_program(vs, easu_frag);
+  easu_out_size = glGetUniformLocation(easu_prog, "outSize");
+  easu_scale = glGetUniformLocation(easu_prog, "scale");
+  easu_texel = glGetUniformLocation(easu_prog, "texel");
+  easu_bounds = glGetUniformLocation(easu_prog, "bounds");
+
+  rcas_prog = upscale_program(vs, rcas_frag);
+  rcas_out_size = glGetUniformLocation(rcas_prog, "outSize");
+  rcas_texel = glGetUniformLocation(rcas_prog, "texel");
+  rcas_sharpness = glGetUniformLocation(rcas_prog, "sharpness");
+}
+
+static void upscale_pass(GLuint src, GLuint target) {
+  glBindFramebuffer(GL_FRAMEBUFFER, target);
+  glBindTexture(GL_TEXTURE_2D, src);
+  glEnableVertexAttribArray(0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, &postfx_pos[0]);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, &upscale_texcoord[0]);
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void upscale_fsr(GLuint src, int src_w, int src_h, int tex_w, int tex_h, GLuint target) {
+  glViewport(0, 0, out_w, out_h);
+
+  // Taps stay within the rendered part of src, which may be smaller than the texture
+  glUseProgram(easu_prog);
+  glUniform2f(easu_out_size, out_w, out_h);
+  glUniform2f(easu_scale, (float)src_w / out_w, (float)src_h / out_h);
+  glUniform2f(easu_texel, 1.0f / tex_w, 1.0f / tex_h);
+  glUniform4f(easu_bounds, 0.5f / tex_w, 0.5f / tex_h, (src_w - 0.5f) / tex_w, (src_h - 0.5f) / tex_h);
+  upscale_pass(src, easu_fb);
+
+  glUseProgram(rcas_prog);
+  glUniform2f(rcas_out_size, out_w, out_h);
+  glUniform2f(rcas_texel, 1.0f / out_w, 1.0f / out_h);
+  glUniform1f(rcas_sharpness, exp2f(-UPSCALE_SHARPNESS_STOPS));
+  upscale_pass(easu_tex, target);
+  glUseProgram(0);
+}
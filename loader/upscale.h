@@ -0,0 +1,14 @@
+#ifndef __UPSCALE_H__
+#define __UPSCALE_H__
+
+#include <vitaGL.h>
+
+enum {
+  UPSCALER_NONE,
+  UPSCALER_FSR
+};
+
+void upscale_init(int width, int height);
+void upscale_fsr(GLuint src, int src_w, int src_h, int tex_w, int tex_h, GLuint target);
+
+#endif
@@ -0,0 +1,173 @@
+/* utf_conv.c -- validating UTF-8 / UTF-16 transcoding
+ *
+ * Follows the well-formed byte sequences table of the Unicode standard:
+ * overlong forms, surrogates and code points above U+10FFFF are rejected
+ * and replaced by U+FFFD, as are unpaired UTF-16 surrogates. Runs of ASCII
+ * are converted 16 units at a time with NEON.
+ */
+
+#include <string.h>
+#ifdef __ARM_NEON
+#include <arm_neon.h>
+#endif
+
+#include "utf_conv.h"
+
+int utf8_decode(const uint8_t *src, int len, uint32_t *cp) {
+  if (len <= 0)
+    return 0;
+
+  uint8_t c = src[0];
+  if (c < 0x80) {
+    *cp = c;
+    return 1;
+  }
+
+  int need;
+  uint8_t lo = 0x80, hi = 0xBF; // allowed range of the second byte
+  if (c >= 0xC2 && c <= 0xDF) {
+    need = 1;
+    *cp = c & 0x1F;
+  } else if (c >= 0xE0 && c <= 0xEF) {
+    need = 2;
+    *cp = c & 0x0F;
+    if (c == 0xE0)
+      lo = 0xA0; // overlong
+    else if (c == 0xED)
+      hi = 0x9F; // surrogates
+  } else if (c >= 0xF0 && c <= 0xF4) {
+    need = 3;
+    *cp = c & 0x07;
+    if (c == 0xF0)
+      lo = 0x90; // overlong
+    else if (c == 0xF4)
+      hi = 0x8F; // above U+10FFFF
+  } else {
+    *cp = UTF_REPLACEMENT;
+    return 1;
+  }
+
+  for (int i = 1; i <= need; i++) {
+    if (i >= len || src[i] < lo || src[i] > hi) {
+      *cp = UTF_REPLACEMENT;
+      return i;
+    }
+    *cp = (*cp << 6) | (src[i] & 0x3F);
+    lo = 0x80;
+    hi = 0xBF;
+  }
+  return need + 1;
+}
+
+int utf8_encode(uint32_t cp, uint8_t *dst) {
+  if ((cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF)
+    cp = UTF_REPLACEMENT;
+
+  if (cp < 0x80) {
+    dst[0] = cp;
+    return 1;
+  } else if (cp < 0x800) {
+    dst[0] = 0xC0 | (cp >> 6);
+    dst[1] = 0x80 | (cp & 0x3F);
+    return 2;
+  } else if (cp < 0x10000) {
+    dst[0] = 0xE0 | (cp >> 12);
+    dst[1] = 0x80 | ((cp >> 6) & 0x3F);
+    dst[2] = 0x80 | (cp & 0x3F);
+    return 3;
+  }
+  dst[0] = 0xF0 | (cp >> 18);
+  dst[1] = 0x80 | ((cp >> 12) & 0x3F);
+  dst[2] = 0x80 | ((cp >> 6) & 0x3F);
+  dst[3] = 0x80 | (cp & 0x3F);
+  return 4;
+}
+
+int utf8_to_utf16(const uint8_t *src, int src_len, uint16_t *dst, int dst_len) {
+  if (src_len < 0)
+    src_len = strlen((const char *)src);
+  if (dst_len <= 0)
+    return 0;
+
+  int i = 0, o = 0;
+  dst_len--; // room for the terminator
+  while (i < src_len) {
+#ifdef __ARM_NEON
+    while (i + 16 <= src_len && o + 16 <= dst_len) {
+      uint8x16_t v = vld1q_u8(&src[i]);
+      uint8x8_t any = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+      if (vget_lane_u64(vreinterpret_u64_u8(any), 0) & 0x8080808080808080ULL)
+        break;
+      vst1q_u16(&dst[o], vmovl_u8(vget_low_u8(v)));
+      vst1q_u16(&dst[o + 8], vmovl_u8(vget_high_u8(v)));
+      i += 16;
+      o += 16;
+    }
+    if (i == src_len)
+      break;
+#endif
+    uint32_t cp;
+    int n = utf8_decode(&src[i], src_len - i, &cp);
+    if (cp >= 0x10000) {
+      if (o + 2 > dst_len)
+        break;
+      cp -= 0x10000;
+      dst[o++] = 0xD800 | (cp >> 10);
+      dst[o++] = 0xDC00 | (cp & 0x3FF);
+    } else {
+      if (o + 1 > dst_len)
+        break;
+      dst[o++] = cp;
+    }
+    i += n;
+  }
+
+  dst[o] = 0;
+  return o;
+}
+
+int utf16_to_utf8(const uint16_t *src, int src_len, uint8_t *dst, int dst_len) {
+  if (src_len < 0) {
+    src_len = 0;
+    while (src[src_len])
+      src_len++;
+  }
+  if (dst_len <= 0)
+    return 0;
+
+  int i = 0, o = 0;
+  dst_len--; // room for the terminator
+  while (i < src_len) {
+#ifdef __ARM_NEON
+    while (i + 16 <= src_len && o + 16 <= dst_len) {
+      uint16x8_t a = vld1q_u16(&src[i]);
+      uint16x8_t b = vld1q_u16(&src[i + 8]);
+      uint64x2_t high = vreinterpretq_u64_u16(vandq_u16(vorrq_u16(a, b), vdupq_n_u16(0xFF80)));
+      if (vgetq_lane_u64(high, 0) | vgetq_lane_u64(high, 1))
+        break;
+      vst1q_u8(&dst[o], vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+      i += 16;
+      o += 16;
+    }
+    if (i == src_len)
+      break;
+#endif
+    uint32_t cp = src[i++];
+    if (cp >= 0xD800 && cp <= 0xDBFF && i < src_len && src[i] >= 0xDC00 && src[i] <= 0xDFFF) {
+      cp = 0x10000 + ((cp - 0xD800) << 10) + (src[i++] - 0xDC00);
+    } else if (cp >= 0xD800 && cp <= 0xDFFF) {
+      cp = UTF_REPLACEMENT;
+    }
+
+    uint8_t tmp[4];
+    int n = utf8_encode(cp, tmp);
+    if (o + n > dst_len) {
+      break;
+    }
+    memcpy(&dst[o], tmp, n);
+    o += n;
+  }
+
+  dst[o] = 0;
+  return o;
+}
@@ -0,0 +1,21 @@
+#ifndef __UTF_CONV_H__
+#define __UTF_CONV_H__
+
+#include <stdint.h>
+
+#define UTF_REPLACEMENT 0xFFFD
+
+// Decodes one code point from src (len bytes available). Invalid or truncated
+// sequences decode to UTF_REPLACEMENT and consume their maximal valid prefix.
+// Returns the number of bytes consumed, 0 only when len is 0.
+int utf8_decode(const uint8_t *src, int len, uint32_t *cp);
+int utf8_encode(uint32_t cp, uint8_t *dst);
+
+// src_len is in input units, -1 for a NUL terminated string. dst_len is the
+// output capacity in units including the terminator, conversion stops at the
+// last whole code point that fits. Return the number of units written, not
+// counting the terminator.
+int utf8_to_utf16(const uint8_t *src, int src_len, uint16_t *dst, int dst_len);
+int utf16_to_utf8(const uint16_t *src, int src_len, uint8_t *dst, int dst_len);
+
+#endif
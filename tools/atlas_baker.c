@@ -0,0 +1,63 @@
+/* atlas_baker.c -- host side glyph atlas baker
+ *
+ * Produces the same glyphs_<lang>.atlas file the loader bakes on device, so
+ * it can be copied to ux0:data/ff4 and skip the first boot bake.
+ *
+ * Usage: atlas_baker <main.obb> <font.ttf> <lang> <out.atlas> <size> [size...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "charset.h"
+#include "glyph_atlas.h"
+#include "obb.h"
+
+int main(int argc, char *argv[]) {
+  if (argc < 6) {
+    printf("Usage: %s <main.obb> <font.ttf> <lang> <out.atlas> <size> [size...]\n", argv[0]);
+    return 1;
+  }
+
+  if (!readHeaderFrom(argv[1])) {
+    printf("Could not open %s\n", argv[1]);
+    return 1;
+  }
+
+  FILE *f = fopen(argv[2], "rb");
+  if (!f) {
+    printf("Could not open %s\n", argv[2]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  long font_size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  unsigned char *font = malloc(font_size);
+  fread(font, font_size, 1, f);
+  fclose(f);
+
+  stbtt_fontinfo info;
+  if (!stbtt_InitFont(&info, font, 0)) {
+    printf("Invalid font %s\n", argv[2]);
+    return 1;
+  }
+
+  int num_sizes = argc - 5;
+  int sizes[num_sizes];
+  for (int i = 0; i < num_sizes; i++)
+    sizes[i] = atoi(argv[5 + i]);
+
+  charset cs;
+  charset_build(argv[3], &cs, NULL);
+  printf("%s: %d code points\n", argv[3], cs.num);
+
+  int n = glyph_atlas_bake(&info, &cs, sizes, num_sizes, font_size, argv[4], NULL);
+  charset_free(&cs);
+  if (!n) {
+    printf("Could not write %s\n", argv[4]);
+    return 1;
+  }
+  printf("Baked %d glyphs into %s\n", n, argv[4]);
+
+  return 0;
+}
@@ -0,0 +1,220 @@
+/* crt_compare.c -- parity check of the lookup texture CRT PostFX
+ *
+ * Applies both CRT effects to a screenshot: 5_CRT_f.cg ported line by line,
+ * and 7_CRTFast_f.cg reading the tables built by loader/crt_lut.c, decoded
+ * the way the shader does. Reports how far apart the two outputs are, and
+ * optionally writes them as PPM for side by side inspection.
+ *
+ * The reference normalizes the window position by the screenshot size,
+ * which is what 5_CRT_f.cg does at 960x544 (it hardcodes that size).
+ * The timings are CPU ones, only meant to compare the two variants with
+ * each other. GPU times on the device are shown by the loader's HUD.
+ *
+ * Usage: crt_compare <screenshot.png> [time in seconds] [output prefix]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "crt_lut.h"
+#include "stb_image.h"
+
+typedef struct {
+  float r, g, b;
+} rgb;
+
+typedef struct {
+  int w, h;
+  rgb *px;
+} image;
+
+static image image_alloc(int w, int h) {
+  image img = {w, h, calloc(w * h, sizeof(rgb))};
+  return img;
+}
+
+static rgb fetch(const image *img, int x, int y) {
+  x = x < 0 ? 0 : x >= img->w ? img->w - 1 : x;
+  y = y < 0 ? 0 : y >= img->h ? img->h - 1 : y;
+  return img->px[y * img->w + x];
+}
+
+static float clampf(float v, float lo, float hi) {
+  return v < lo ? lo : v > hi ? hi : v;
+}
+
+// tex2D on the PostFX framebuffer, bilinear, t = 1 being the top of the screen
+static rgb tex2d(const image *img, float u, float v) {
+  float px = u * img->w - 0.5f, py = (1.0f - v) * img->h - 0.5f;
+  int fx = floorf(px), fy = floorf(py);
+  float ax = px - fx, ay = py - fy;
+  rgb a = fetch(img, fx, fy), b = fetch(img, fx + 1, fy), c = fetch(img, fx, fy + 1), d = fetch(img, fx + 1, fy + 1);
+  rgb o;
+  o.r = (a.r * (1 - ax) + b.r * ax) * (1 - ay) + (c.r * (1 - ax) + d.r * ax) * ay;
+  o.g = (a.g * (1 - ax) + b.g * ax) * (1 - ay) + (c.g * (1 - ax) + d.g * ax) * ay;
+  o.b = (a.b * (1 - ax) + b.b * ax) * (1 - ay) + (c.b * (1 - ax) + d.b * ax) * ay;
+  return o;
+}
+
+// Taps, wobble and tone curve shared by both shaders
+static rgb crt_taps(const image *src, float ux, float uy, float t) {
+  float x = sinf(0.3f * t + uy * 21.0f) * sinf(0.7f * t + uy * 29.0f) * sinf(0.3f + 0.33f * t + uy * 31.0f) * 0.0017f;
+  rgb col;
+  col.r = tex2d(src, x + ux + 0.001f, uy + 0.001f).r + 0.05f;
+  col.g = tex2d(src, x + ux + 0.000f, uy - 0.002f).g + 0.05f;
+  col.b = tex2d(src, x + ux - 0.002f, uy + 0.000f).b + 0.05f;
+  col.r += 0.08f * tex2d(src, 0.75f * (x + 0.025f) + ux + 0.001f, 0.75f * -0.027f + uy + 0.001f).r;
+  col.g += 0.05f * tex2d(src, 0.75f * (x - 0.022f) + ux + 0.000f, 0.75f * -0.02f + uy - 0.002f).g;
+  col.b += 0.08f * tex2d(src, 0.75f * (x - 0.02f) + ux - 0.002f, 0.75f * -0.018f + uy + 0.000f).b;
+  col.r = clampf(col.r * 0.6f + 0.4f * col.r * col.r, 0, 1);
+  col.g = clampf(col.g * 0.6f + 0.4f * col.g * col.g, 0, 1);
+  col.b = clampf(col.b * 0.6f + 0.4f * col.b * col.b, 0, 1);
+  return col;
+}
+
+static float crt_time_terms(float uy, float t) {
+  float scans = clampf(0.35f + 0.35f * sinf(3.5f * t + uy * CRT_LUT_SCANLINE_RES * 1.5f), 0, 1);
+  return (0.4f + 0.7f * powf(scans, 1.7f)) * (1.0f + 0.01f * sinf(110.0f * t));
+}
+
+static void crt_scale(rgb *col, float s) {
+  col->r *= s * 0.95f * 2.8f;
+  col->g *= s * 1.05f * 2.8f;
+  col->b *= s * 0.95f * 2.8f;
+}
+
+static image crt_reference(const image *src, float t) {
+  image dst = image_alloc(src->w, src->h);
+  for (int y = 0; y < src->h; y++) {
+    for (int x = 0; x < src->w; x++) {
+      float fx = x + 0.5f, fy = y + 0.5f;
+      float u = ((src->w - fx) / src->w - 0.5f) * 2.0f * 1.1f;
+      float v = ((src->h - fy) / src->h - 0.5f) * 2.0f * 1.1f;
+      u *= 1.0f + powf(fabsf(v) / 5.0f, 2.0f);
+      v *= 1.0f + powf(fabsf(u) / 4.0f, 2.0f);
+      float ux = 1.0f - ((u / 2.0f + 0.5f) * 0.92f + 0.04f), uy = (v / 2.0f + 0.5f) * 0.92f + 0.04f;
+
+      rgb col = crt_taps(src, ux, uy, t);
+      float vig = 16.0f * ux * uy * (1.0f - ux) * (1.0f - uy);
+      float s = powf(vig, 0.3f) * crt_time_terms(uy, t);
+      if (ux < 0.0f || ux > 1.0f || uy < 0.0f || uy > 1.0f)
+        s = 0.0f;
+      s *= 1.0f - 0.65f * clampf((fmodf(fx, 2.0f) - 1.0f) * 2.0f, 0, 1);
+      crt_scale(&col, s);
+      dst.px[y * src->w + x] = col;
+    }
+  }
+  return dst;
+}
+
+static image crt_lut(const image *src, const uint8_t *warp, const uint8_t *shade, float t) {
+  image dst = image_alloc(src->w, src->h);
+  for (int y = 0; y < src->h; y++) {
+    // Table rows start at the bottom of the screen
+    int row = src->h - 1 - y;
+    for (int x = 0; x < src->w; x++) {
+      const uint8_t *w = &warp[(row * src->w + x) * 4];
+      float ux = (w[0] / 255.0f) * (65280.0f / 65535.0f) + (w[1] / 255.0f) * (255.0f / 65535.0f);
+      float uy = (w[2] / 255.0f) * (65280.0f / 65535.0f) + (w[3] / 255.0f) * (255.0f / 65535.0f);
+
+      rgb col = crt_taps(src, ux, uy, t);
+      crt_scale(&col, shade[row * src->w + x] / 255.0f * crt_time_terms(uy, t));
+      dst.px[y * src->w + x] = col;
+    }
+  }
+  return dst;
+}
+
+static void compare(const image *a, const image *b, double *psnr, float *max_diff) {
+  double err = 0;
+  *max_diff = 0;
+  for (int i = 0; i < a->w * a->h; i++) {
+    float d[3] = {
+      clampf(a->px[i].r, 0, 1) - clampf(b->px[i].r, 0, 1),
+      clampf(a->px[i].g, 0, 1) - clampf(b->px[i].g, 0, 1),
+      clampf(a->px[i].b, 0, 1) - clampf(b->px[i].b, 0, 1)
+    };
+    for (int c = 0; c < 3; c++) {
+      err += d[c] * d[c];
+      if (fabsf(d[c]) > *max_diff)
+        *max_diff = fabsf(d[c]);
+    }
+  }
+  err /= a->w * a->h * 3.0;
+  *psnr = err > 0 ? 10.0 * log10(1.0 / err) : INFINITY;
+}
+
+static void write_ppm(const image *img, const char *prefix, const char *name) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s_%s.ppm", prefix, name);
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return;
+  fprintf(f, "P6\n%d %d\n255\n", img->w, img->h);
+  for (int i = 0; i < img->w * img->h; i++) {
+    unsigned char c[3] = {
+      clampf(img->px[i].r, 0, 1) * 255.0f + 0.5f,
+      clampf(img->px[i].g, 0, 1) * 255.0f + 0.5f,
+      clampf(img->px[i].b, 0, 1) * 255.0f + 0.5f
+    };
+    fwrite(c, 1, 3, f);
+  }
+  fclose(f);
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    printf("Usage: %s <screenshot.png> [time in seconds] [output prefix]\n", argv[0]);
+    return 1;
+  }
+
+  int w, h, n;
+  unsigned char *data = stbi_load(argv[1], &w, &h, &n, 3);
+  if (!data) {
+    printf("Could not load %s\n", argv[1]);
+    return 1;
+  }
+  float t = argc > 2 ? atof(argv[2]) : 1.0f;
+
+  image src = image_alloc(w, h);
+  for (int i = 0; i < w * h; i++)
+    src.px[i] = (rgb){data[i * 3] / 255.0f, data[i * 3 + 1] / 255.0f, data[i * 3 + 2] / 255.0f};
+  stbi_image_free(data);
+
+  uint8_t *warp = malloc(w * h * 4);
+  uint8_t *shade = malloc(w * h);
+
+  double t0 = now_ms();
+  image ref = crt_reference(&src, t);
+  double t1 = now_ms();
+  crt_lut_build(w, h, warp, shade);
+  double t2 = now_ms();
+  image fast = crt_lut(&src, warp, shade, t);
+  double t3 = now_ms();
+
+  double db;
+  float max_diff;
+  compare(&ref, &fast, &db, &max_diff);
+  printf("%dx%d at t = %.2f s\n", w, h, t);
+  printf("%-10s %10s\n", "variant", "CPU ms");
+  printf("%-10s %10.2f\n", "reference", t1 - t0);
+  printf("%-10s %10.2f (+ %.2f ms to build the tables)\n", "lut", t3 - t2, t2 - t1);
+  printf("PSNR %.2f dB, max difference %.1f / 255\n", db, max_diff * 255.0f);
+
+  if (argc > 3) {
+    write_ppm(&ref, argv[3], "crt");
+    write_ppm(&fast, argv[3], "crt_lut");
+  }
+
+  return 0;
+}
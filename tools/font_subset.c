@@ -0,0 +1,293 @@
+/* font_subset.c -- host side font subsetter
+ *
+ * Scans the message files of one or more languages inside main.obb and
+ * writes a copy of a TrueType font only keeping the outlines of the code
+ * points they use (plus their composite components). Glyph ids are kept
+ * as is, so hmtx and maxp are copied untouched; cmap is rebuilt as a
+ * format 12 subtable and loca is written in long format. Text typed in the
+ * IME dialog never shows up in the message files, so the ranges it can
+ * produce for names are kept as well.
+ *
+ * Usage: font_subset <main.obb> <font.ttf> <out.ttf> <lang> [lang...]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "charset.h"
+#include "obb.h"
+#include "stb_truetype.h"
+
+#define MAX_TABLES 32
+
+static const char *kept_tables[] = {"OS/2", "hhea", "hmtx", "maxp", "name", "post"};
+#define NUM_KEPT_TABLES (sizeof(kept_tables) / sizeof(*kept_tables))
+
+// Latin-1 and Latin Extended-A, general punctuation, CJK punctuation and kana, fullwidth forms
+static const uint32_t ime_ranges[][2] = {{0x00A0, 0x017F}, {0x2000, 0x206F}, {0x3000, 0x30FF}, {0xFF00, 0xFFEF}};
+#define NUM_IME_RANGES (sizeof(ime_ranges) / sizeof(*ime_ranges))
+
+typedef struct {
+  char tag[4];
+  uint8_t *data;
+  uint32_t length;
+} out_table;
+
+static uint8_t *font;
+static uint32_t loca_off, glyf_off;
+static int short_loca, num_glyphs;
+
+static inline uint16_t rd16(const uint8_t *p) {
+  return (p[0] << 8) | p[1];
+}
+
+static inline uint32_t rd32(const uint8_t *p) {
+  return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline void wr16(uint8_t *p, uint16_t v) {
+  p[0] = v >> 8;
+  p[1] = v;
+}
+
+static inline void wr32(uint8_t *p, uint32_t v) {
+  p[0] = v >> 24;
+  p[1] = v >> 16;
+  p[2] = v >> 8;
+  p[3] = v;
+}
+
+static uint32_t find_table(const char *tag, uint32_t *length) {
+  int num = rd16(&font[4]);
+  for (int i = 0; i < num; i++) {
+    const uint8_t *rec = &font[12 + i * 16];
+    if (!memcmp(rec, tag, 4)) {
+      if (length)
+        *length = rd32(&rec[12]);
+      return rd32(&rec[8]);
+    }
+  }
+  return 0;
+}
+
+static uint32_t glyph_offset(int gid) {
+  return short_loca ? rd16(&font[loca_off + gid * 2]) * 2 : rd32(&font[loca_off + gid * 4]);
+}
+
+static void keep_glyph(int gid, uint8_t *keep) {
+  if (gid >= num_glyphs || keep[gid])
+    return;
+  keep[gid] = 1;
+
+  uint32_t start = glyph_offset(gid), end = glyph_offset(gid + 1);
+  if (end - start < 10 || (int16_t)rd16(&font[glyf_off + start]) >= 0)
+    return;
+
+  const uint8_t *p = &font[glyf_off + start + 10];
+  uint16_t flags;
+  do {
+    flags = rd16(p);
+    keep_glyph(rd16(&p[2]), keep);
+    p += 4 + ((flags & 0x0001) ? 4 : 2);
+    if (flags & 0x0008)
+      p += 2;
+    else if (flags & 0x0040)
+      p += 4;
+    else if (flags & 0x0080)
+      p += 8;
+  } while (flags & 0x0020);
+}
+
+static uint32_t checksum(const uint8_t *data, uint32_t length) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < length; i += 4) {
+    uint8_t word[4] = {0};
+    memcpy(word, &data[i], length - i < 4 ? length - i : 4);
+    sum += rd32(word);
+  }
+  return sum;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 5) {
+    printf("Usage: %s <main.obb> <font.ttf> <out.ttf> <lang> [lang...]\n", argv[0]);
+    return 1;
+  }
+
+  if (!readHeaderFrom(argv[1])) {
+    printf("Could not open %s\n", argv[1]);
+    return 1;
+  }
+
+  FILE *f = fopen(argv[2], "rb");
+  if (!f) {
+    printf("Could not open %s\n", argv[2]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  long font_size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  font = malloc(font_size);
+  fread(font, font_size, 1, f);
+  fclose(f);
+
+  stbtt_fontinfo info;
+  uint32_t head_len, glyf_len;
+  uint32_t head_off = find_table("head", &head_len);
+  loca_off = find_table("loca", NULL);
+  glyf_off = find_table("glyf", &glyf_len);
+  if (!stbtt_InitFont(&info, font, 0) || !head_off || !loca_off || !glyf_off) {
+    printf("%s is not a TrueType outlines font\n", argv[2]);
+    return 1;
+  }
+  short_loca = rd16(&font[head_off + 50]) == 0;
+  num_glyphs = info.numGlyphs;
+
+  // Union of the code points used by every requested language
+  uint8_t *used = calloc(0x10000, 1);
+  for (int i = 4; i < argc; i++) {
+    charset cs;
+    charset_build(argv[i], &cs, NULL);
+    for (int n = 0; n < cs.num; n++)
+      used[cs.entries[n].codepoint] = 1;
+    printf("%s: %d code points\n", argv[i], cs.num);
+    charset_free(&cs);
+  }
+  for (int i = 0; i < NUM_IME_RANGES; i++) {
+    for (uint32_t cp = ime_ranges[i][0]; cp <= ime_ranges[i][1]; cp++)
+      used[cp] = 1;
+  }
+
+  uint8_t *keep = calloc(num_glyphs + 1, 1);
+  uint16_t *cp_to_gid = calloc(0x10000, sizeof(uint16_t));
+  int num_cps = 0;
+  keep_glyph(0, keep); // .notdef
+  for (int cp = 0; cp < 0x10000; cp++) {
+    if (!used[cp])
+      continue;
+    int gid = stbtt_FindGlyphIndex(&info, cp);
+    if (!gid)
+      continue;
+    cp_to_gid[cp] = gid;
+    keep_glyph(gid, keep);
+    num_cps++;
+  }
+
+  out_table tables[MAX_TABLES];
+  int num_tables = 0;
+
+  // cmap: a single format 12 subtable, one group per run of consecutive ids
+  uint32_t num_groups = 0;
+  uint8_t *groups = malloc(num_cps * 12);
+  for (int cp = 0; cp < 0x10000; cp++) {
+    if (!cp_to_gid[cp])
+      continue;
+    if (num_groups) {
+      uint8_t *last = &groups[(num_groups - 1) * 12];
+      uint32_t end = rd32(&last[4]);
+      if (end + 1 == cp && rd32(&last[8]) + (cp - rd32(last)) == cp_to_gid[cp]) {
+        wr32(&last[4], cp);
+        continue;
+      }
+    }
+    uint8_t *g = &groups[num_groups++ * 12];
+    wr32(&g[0], cp);
+    wr32(&g[4], cp);
+    wr32(&g[8], cp_to_gid[cp]);
+  }
+  uint32_t cmap_len = 4 + 8 + 16 + num_groups * 12;
+  uint8_t *cmap = calloc(cmap_len, 1);
+  wr16(&cmap[2], 1);     // numTables
+  wr16(&cmap[4], 3);     // platformID: Microsoft
+  wr16(&cmap[6], 10);    // encodingID: Unicode full repertoire
+  wr32(&cmap[8], 12);    // subtable offset
+  wr16(&cmap[12], 12);   // format
+  wr32(&cmap[16], 16 + num_groups * 12);
+  wr32(&cmap[24], num_groups);
+  memcpy(&cmap[28], groups, num_groups * 12);
+  free(groups);
+  tables[num_tables++] = (out_table){{'c', 'm', 'a', 'p'}, cmap, cmap_len};
+
+  // glyf and loca, dropped glyphs become empty. Glyphs may only be 2 bytes aligned in the
+  // source while they're padded to 4 here, which can add up to 3 bytes each
+  uint8_t *loca = malloc((num_glyphs + 1) * 4);
+  uint8_t *glyf = malloc(glyf_len + 3 * num_glyphs);
+  uint32_t glyf_pos = 0;
+  for (int gid = 0; gid < num_glyphs; gid++) {
+    wr32(&loca[gid * 4], glyf_pos);
+    if (keep[gid]) {
+      uint32_t start = glyph_offset(gid), len = glyph_offset(gid + 1) - start;
+      memcpy(&glyf[glyf_pos], &font[glyf_off + start], len);
+      glyf_pos += (len + 3) & ~3;
+    }
+  }
+  wr32(&loca[num_glyphs * 4], glyf_pos);
+  tables[num_tables++] = (out_table){{'g', 'l', 'y', 'f'}, glyf, glyf_pos};
+
+  uint8_t *head = malloc(head_len);
+  memcpy(head, &font[head_off], head_len);
+  wr32(&head[8], 0);  // checkSumAdjustment, fixed up below
+  wr16(&head[50], 1); // indexToLocFormat: long
+  tables[num_tables++] = (out_table){{'h', 'e', 'a', 'd'}, head, head_len};
+  tables[num_tables++] = (out_table){{'l', 'o', 'c', 'a'}, loca, (num_glyphs + 1) * 4};
+
+  for (int i = 0; i < NUM_KEPT_TABLES; i++) {
+    uint32_t len, off = find_table(kept_tables[i], &len);
+    if (off)
+      tables[num_tables++] = (out_table){{kept_tables[i][0], kept_tables[i][1], kept_tables[i][2], kept_tables[i][3]}, &font[off], len};
+  }
+
+  // Table records must be sorted by tag
+  for (int i = 1; i < num_tables; i++) {
+    for (int j = i; j > 0 && memcmp(tables[j - 1].tag, tables[j].tag, 4) > 0; j--) {
+      out_table t = tables[j];
+      tables[j] = tables[j - 1];
+      tables[j - 1] = t;
+    }
+  }
+
+  uint32_t out_size = 12 + num_tables * 16;
+  for (int i = 0; i < num_tables; i++)
+    out_size += (tables[i].length + 3) & ~3;
+
+  uint8_t *out = calloc(out_size, 1);
+  int entry_selector = 0;
+  while ((2 << entry_selector) <= num_tables)
+    entry_selector++;
+  wr32(&out[0], 0x00010000);
+  wr16(&out[4], num_tables);
+  wr16(&out[6], (1 << entry_selector) * 16);
+  wr16(&out[8], entry_selector);
+  wr16(&out[10], num_tables * 16 - (1 << entry_selector) * 16);
+
+  uint32_t pos = 12 + num_tables * 16, head_pos = 0;
+  for (int i = 0; i < num_tables; i++) {
+    uint8_t *rec = &out[12 + i * 16];
+    memcpy(rec, tables[i].tag, 4);
+    wr32(&rec[4], checksum(tables[i].data, tables[i].length));
+    wr32(&rec[8], pos);
+    wr32(&rec[12], tables[i].length);
+    memcpy(&out[pos], tables[i].data, tables[i].length);
+    if (!memcmp(tables[i].tag, "head", 4))
+      head_pos = pos;
+    pos += (tables[i].length + 3) & ~3;
+  }
+  wr32(&out[head_pos + 8], 0xB1B0AFBA - checksum(out, out_size));
+
+  f = fopen(argv[3], "wb");
+  if (!f) {
+    printf("Could not write %s\n", argv[3]);
+    return 1;
+  }
+  fwrite(out, 1, out_size, f);
+  fclose(f);
+
+  int kept = 0;
+  for (int gid = 0; gid < num_glyphs; gid++)
+    kept += keep[gid];
+  printf("Kept %d of %d glyphs for %d code points, %ld KB -> %u KB\n", kept, num_glyphs, num_cps, font_size / 1024, out_size / 1024);
+
+  return 0;
+}
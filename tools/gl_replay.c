@@ -0,0 +1,743 @@
+/* gl_replay.c -- replay of a GL stream captured by the loader
+ *
+ * Reads the gl_stream.bin written by a loader built with -DGL_RECORDER=ON
+ * and replays it frame by frame, either against a backend that shadows the
+ * GL state to spot calls not changing anything, or against a null backend
+ * that only decodes the stream (--null), giving the bare parsing cost.
+ *
+ * Reported per frame: GL calls, draws, vertices, redundant calls, client
+ * array and texture bytes the game handed over, the host time to replay
+ * the frame and the frame time measured on device while capturing. A per
+ * call summary follows. State set before the capture started is unknown,
+ * so the first call setting it never counts as redundant.
+ *
+ * With --matrices, the matrix calls of the stream are replayed instead
+ * through loader/matrix_stack.c, handing matrices over only at draws, and
+ * through a reference doing a full scalar 4x4 product per call and handing
+ * the result over right away, as the game's calls did before. Both must
+ * agree at every draw. The NEON path is only taken when built for ARM.
+ *
+ * Usage: gl_replay <gl_stream.bin> [--null | --matrices] [--repeat n] [--summary]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "gl_stream.h"
+#include "matrix_stack.h"
+
+#define MAX_CAPS 32
+#define MAX_FOG_PARAMS 8
+
+static const char *op_names[GL_OP_COUNT] = {
+  "frame end", "glAlphaFunc", "glBindTexture", "glBlendFunc", "glClear", "glClearColor",
+  "glColor4ub", "glColorPointer", "glCullFace", "glDeleteTextures", "glDepthFunc",
+  "glDepthMask", "glDisable", "glDisableClientState", "glDrawArrays", "glEnable",
+  "glEnableClientState", "glFogf", "glFogfv", "glGenTextures", "glGetError", "glLightfv",
+  "glLoadIdentity", "glLoadMatrixf", "glMaterialfv", "glMatrixMode", "glMultMatrixf",
+  "glNormalPointer", "glOrthof", "glPopMatrix", "glPushMatrix", "glScissor", "glTranslatef",
+  "glTexCoordPointer", "glTexImage2D", "glTexParameteri", "glTexSubImage2D",
+  "glVertexPointer", "glViewport"
+};
+
+typedef struct {
+  const uint8_t *p, *end;
+  int error;
+} reader;
+
+// One decoded call, u holds the integer arguments and f the float ones in order
+typedef struct {
+  int op;
+  uint32_t u[10];
+  float f[16];
+  int nf;
+  const uint8_t *data[GL_STREAM_ARRAY_COUNT];
+  uint32_t size[GL_STREAM_ARRAY_COUNT];
+} gl_call;
+
+typedef struct {
+  uint32_t calls, draws, vertices, redundant;
+  uint32_t array_bytes, texture_bytes;
+  uint32_t frame_us;
+  double replay_us;
+} frame_stats;
+
+typedef struct {
+  uint64_t calls, redundant;
+} op_stats;
+
+// Shadowed GL state, a value only counts once it has been set during the capture
+typedef struct {
+  struct {
+    uint32_t cap;
+    int on;
+  } caps[MAX_CAPS];
+  int num_caps;
+  int arrays_known[GL_STREAM_ARRAY_COUNT], arrays_on[GL_STREAM_ARRAY_COUNT];
+  int pointer_known[GL_STREAM_ARRAY_COUNT];
+  uint32_t pointer[GL_STREAM_ARRAY_COUNT][4];
+  struct {
+    uint32_t pname;
+    float v[4];
+    int n;
+  } fog[MAX_FOG_PARAMS];
+  int num_fog;
+  int texture_known, blend_known, color_known, depth_func_known, depth_mask_known;
+  int alpha_known, cull_known, mode_known, viewport_known, scissor_known, clear_color_known;
+  uint32_t texture, blend[2], color, depth_func, depth_mask, alpha_func, cull, mode;
+  uint32_t viewport[4], scissor[4];
+  float alpha_ref, clear_color[4];
+} shadow_state;
+
+static uint8_t rd_u8(reader *r) {
+  if (r->p + 1 > r->end) {
+    r->error = 1;
+    return 0;
+  }
+  return *r->p++;
+}
+
+static uint32_t rd_u32(reader *r) {
+  uint32_t v;
+  if (r->p + 4 > r->end) {
+    r->error = 1;
+    return 0;
+  }
+  memcpy(&v, r->p, 4);
+  r->p += 4;
+  return v;
+}
+
+static float rd_f32(reader *r) {
+  uint32_t v = rd_u32(r);
+  float f;
+  memcpy(&f, &v, 4);
+  return f;
+}
+
+static const uint8_t *rd_bytes(reader *r, uint32_t size) {
+  const uint8_t *p = r->p;
+  if (size > (uint32_t)(r->end - r->p)) {
+    r->error = 1;
+    return NULL;
+  }
+  r->p += size;
+  return p;
+}
+
+static void rd_floats(reader *r, gl_call *c, int n) {
+  for (int i = 0; i < n; i++) {
+    float v = rd_f32(r);
+    if (c->nf < 16)
+      c->f[c->nf++] = v;
+  }
+}
+
+static void rd_counted_floats(reader *r, gl_call *c) {
+  uint32_t n = rd_u32(r);
+  rd_floats(r, c, n);
+}
+
+static int decode(reader *r, gl_call *c) {
+  c->op = rd_u8(r);
+  c->nf = 0;
+  switch (c->op) {
+  case GL_OP_FRAME_END:
+  case GL_OP_CLEAR:
+  case GL_OP_CULL_FACE:
+  case GL_OP_DEPTH_FUNC:
+  case GL_OP_DISABLE:
+  case GL_OP_DISABLE_CLIENT_STATE:
+  case GL_OP_ENABLE:
+  case GL_OP_ENABLE_CLIENT_STATE:
+  case GL_OP_MATRIX_MODE:
+    c->u[0] = rd_u32(r);
+    break;
+  case GL_OP_ALPHA_FUNC:
+  case GL_OP_FOGF:
+    c->u[0] = rd_u32(r);
+    rd_floats(r, c, 1);
+    break;
+  case GL_OP_BIND_TEXTURE:
+  case GL_OP_BLEND_FUNC:
+    c->u[0] = rd_u32(r);
+    c->u[1] = rd_u32(r);
+    break;
+  case GL_OP_CLEAR_COLOR:
+    rd_floats(r, c, 4);
+    break;
+  case GL_OP_COLOR4UB:
+    for (int i = 0; i < 4; i++)
+      c->u[i] = rd_u8(r);
+    break;
+  case GL_OP_COLOR_POINTER:
+  case GL_OP_TEX_COORD_POINTER:
+  case GL_OP_VERTEX_POINTER:
+  case GL_OP_SCISSOR:
+  case GL_OP_VIEWPORT:
+    for (int i = 0; i < 4; i++)
+      c->u[i] = rd_u32(r);
+    break;
+  case GL_OP_NORMAL_POINTER:
+    c->u[0] = 3;
+    for (int i = 1; i < 4; i++)
+      c->u[i] = rd_u32(r);
+    break;
+  case GL_OP_DELETE_TEXTURES:
+  case GL_OP_GEN_TEXTURES:
+    c->u[0] = rd_u32(r);
+    rd_bytes(r, c->u[0] * 4);
+    break;
+  case GL_OP_DEPTH_MASK:
+    c->u[0] = rd_u8(r);
+    break;
+  case GL_OP_DRAW_ARRAYS:
+    for (int i = 0; i < 3; i++)
+      c->u[i] = rd_u32(r);
+    c->u[3] = rd_u8(r);
+    for (int i = 0; i < GL_STREAM_ARRAY_COUNT; i++) {
+      c->size[i] = 0;
+      c->data[i] = NULL;
+      if (c->u[3] & (1 << i)) {
+        c->size[i] = rd_u32(r);
+        c->data[i] = rd_bytes(r, c->size[i]);
+      }
+    }
+    break;
+  case GL_OP_FOGFV:
+    c->u[0] = rd_u32(r);
+    rd_counted_floats(r, c);
+    break;
+  case GL_OP_GET_ERROR:
+  case GL_OP_LOAD_IDENTITY:
+  case GL_OP_POP_MATRIX:
+  case GL_OP_PUSH_MATRIX:
+    break;
+  case GL_OP_LIGHTFV:
+  case GL_OP_MATERIALFV:
+    c->u[0] = rd_u32(r);
+    c->u[1] = rd_u32(r);
+    rd_counted_floats(r, c);
+    break;
+  case GL_OP_LOAD_MATRIXF:
+  case GL_OP_MULT_MATRIXF:
+    rd_floats(r, c, 16);
+    break;
+  case GL_OP_ORTHOF:
+    rd_floats(r, c, 6);
+    break;
+  case GL_OP_TRANSLATEF:
+    rd_floats(r, c, 3);
+    break;
+  case GL_OP_TEX_IMAGE_2D:
+  case GL_OP_TEX_SUB_IMAGE_2D:
+    for (int i = 0; i < 8; i++)
+      c->u[i] = rd_u32(r);
+    c->size[0] = rd_u32(r);
+    c->data[0] = rd_bytes(r, c->size[0]);
+    break;
+  case GL_OP_TEX_PARAMETERI:
+    for (int i = 0; i < 3; i++)
+      c->u[i] = rd_u32(r);
+    break;
+  default:
+    printf("Unknown opcode %d\n", c->op);
+    r->error = 1;
+    break;
+  }
+  return !r->error;
+}
+
+static int set_u32(int *known, uint32_t *value, uint32_t v) {
+  int redundant = *known && *value == v;
+  *known = 1;
+  *value = v;
+  return redundant;
+}
+
+static int set_words(int *known, void *value, const void *v, size_t size) {
+  int redundant = *known && !memcmp(value, v, size);
+  *known = 1;
+  memcpy(value, v, size);
+  return redundant;
+}
+
+static int set_cap(shadow_state *s, uint32_t cap, int on) {
+  for (int i = 0; i < s->num_caps; i++) {
+    if (s->caps[i].cap == cap) {
+      int redundant = s->caps[i].on == on;
+      s->caps[i].on = on;
+      return redundant;
+    }
+  }
+  if (s->num_caps < MAX_CAPS) {
+    s->caps[s->num_caps].cap = cap;
+    s->caps[s->num_caps++].on = on;
+  }
+  return 0;
+}
+
+static int set_fog(shadow_state *s, uint32_t pname, const float *v, int n) {
+  for (int i = 0; i < s->num_fog; i++) {
+    if (s->fog[i].pname == pname) {
+      int redundant = s->fog[i].n == n && !memcmp(s->fog[i].v, v, n * sizeof(float));
+      memcpy(s->fog[i].v, v, n * sizeof(float));
+      s->fog[i].n = n;
+      return redundant;
+    }
+  }
+  if (s->num_fog < MAX_FOG_PARAMS) {
+    s->fog[s->num_fog].pname = pname;
+    memcpy(s->fog[s->num_fog].v, v, n * sizeof(float));
+    s->fog[s->num_fog++].n = n;
+  }
+  return 0;
+}
+
+static int array_index(uint32_t array) {
+  switch (array) {
+  case 0x8074: // GL_VERTEX_ARRAY
+    return GL_STREAM_ARRAY_VERTEX;
+  case 0x8076: // GL_COLOR_ARRAY
+    return GL_STREAM_ARRAY_COLOR;
+  case 0x8078: // GL_TEXTURE_COORD_ARRAY
+    return GL_STREAM_ARRAY_TEXCOORD;
+  case 0x8075: // GL_NORMAL_ARRAY
+    return GL_STREAM_ARRAY_NORMAL;
+  default:
+    return -1;
+  }
+}
+
+// Counting backend, returns whether the call left the shadowed state as it was
+static int count_call(shadow_state *s, const gl_call *c) {
+  int i;
+  switch (c->op) {
+  case GL_OP_ALPHA_FUNC: {
+    int redundant = s->alpha_known && s->alpha_func == c->u[0] && s->alpha_ref == c->f[0];
+    s->alpha_known = 1;
+    s->alpha_func = c->u[0];
+    s->alpha_ref = c->f[0];
+    return redundant;
+  }
+  case GL_OP_BIND_TEXTURE:
+    return set_u32(&s->texture_known, &s->texture, c->u[1]);
+  case GL_OP_BLEND_FUNC:
+    return set_words(&s->blend_known, s->blend, c->u, sizeof(s->blend));
+  case GL_OP_CLEAR_COLOR:
+    return set_words(&s->clear_color_known, s->clear_color, c->f, sizeof(s->clear_color));
+  case GL_OP_COLOR4UB:
+    return set_u32(&s->color_known, &s->color, c->u[0] | c->u[1] << 8 | c->u[2] << 16 | c->u[3] << 24);
+  case GL_OP_CULL_FACE:
+    return set_u32(&s->cull_known, &s->cull, c->u[0]);
+  case GL_OP_DEPTH_FUNC:
+    return set_u32(&s->depth_func_known, &s->depth_func, c->u[0]);
+  case GL_OP_DEPTH_MASK:
+    return set_u32(&s->depth_mask_known, &s->depth_mask, c->u[0]);
+  case GL_OP_ENABLE:
+  case GL_OP_DISABLE:
+    return set_cap(s, c->u[0], c->op == GL_OP_ENABLE);
+  case GL_OP_ENABLE_CLIENT_STATE:
+  case GL_OP_DISABLE_CLIENT_STATE:
+    i = array_index(c->u[0]);
+    if (i < 0)
+      return 0;
+    return set_u32(&s->arrays_known[i], (uint32_t *)&s->arrays_on[i], c->op == GL_OP_ENABLE_CLIENT_STATE);
+  case GL_OP_VERTEX_POINTER:
+  case GL_OP_COLOR_POINTER:
+  case GL_OP_TEX_COORD_POINTER:
+  case GL_OP_NORMAL_POINTER:
+    i = c->op == GL_OP_VERTEX_POINTER ? GL_STREAM_ARRAY_VERTEX : c->op == GL_OP_COLOR_POINTER ? GL_STREAM_ARRAY_COLOR : c->op == GL_OP_TEX_COORD_POINTER ? GL_STREAM_ARRAY_TEXCOORD : GL_STREAM_ARRAY_NORMAL;
+    return set_words(&s->pointer_known[i], s->pointer[i], c->u, sizeof(s->pointer[i]));
+  case GL_OP_FOGF:
+    return set_fog(s, c->u[0], c->f, 1);
+  case GL_OP_FOGFV:
+    return set_fog(s, c->u[0], c->f, c->nf > 4 ? 4 : c->nf);
+  case GL_OP_MATRIX_MODE:
+    return set_u32(&s->mode_known, &s->mode, c->u[0]);
+  case GL_OP_SCISSOR:
+    return set_words(&s->scissor_known, s->scissor, c->u, sizeof(s->scissor));
+  case GL_OP_VIEWPORT:
+    return set_words(&s->viewport_known, s->viewport, c->u, sizeof(s->viewport));
+  case GL_OP_DELETE_TEXTURES:
+    // Deleting the bound texture reverts the binding to 0, which we can't tell apart here
+    s->texture_known = 0;
+    return 0;
+  default:
+    return 0;
+  }
+}
+
+// Work and data handed to the GL, known from decoding alone
+static void account_call(const gl_call *c, frame_stats *f) {
+  f->calls++;
+  if (c->op == GL_OP_DRAW_ARRAYS) {
+    f->draws++;
+    f->vertices += c->u[2];
+    for (int i = 0; i < GL_STREAM_ARRAY_COUNT; i++)
+      f->array_bytes += c->size[i];
+  } else if (c->op == GL_OP_TEX_IMAGE_2D || c->op == GL_OP_TEX_SUB_IMAGE_2D) {
+    f->texture_bytes += c->size[0];
+  }
+}
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+// Matrix calls of the stream, draws and light positions being where the matrices are needed
+typedef struct {
+  uint8_t op;
+  int stack;
+  float f[16];
+} matrix_call;
+
+static struct {
+  float m[MATRIX_STACKS][MATRIX_STACK_DEPTH][16];
+  int depth[MATRIX_STACKS];
+  int mode;
+} ref;
+
+static float sink[16];
+static uint32_t handed_over;
+
+static void hand_over(const float *m) {
+  memcpy(sink, m, sizeof(sink));
+  handed_over++;
+}
+
+static void ref_mult(const float *b) {
+  float *a = ref.m[ref.mode][ref.depth[ref.mode]], t[16];
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++)
+      t[i * 4 + j] = a[j] * b[i * 4] + a[4 + j] * b[i * 4 + 1] + a[8 + j] * b[i * 4 + 2] + a[12 + j] * b[i * 4 + 3];
+  }
+  memcpy(a, t, sizeof(t));
+}
+
+static void ref_call(const matrix_call *c) {
+  float *top = ref.m[ref.mode][ref.depth[ref.mode]];
+  switch (c->op) {
+  case GL_OP_MATRIX_MODE:
+    ref.mode = c->stack;
+    return;
+  case GL_OP_LOAD_IDENTITY:
+    memset(top, 0, 16 * sizeof(float));
+    top[0] = top[5] = top[10] = top[15] = 1.0f;
+    break;
+  case GL_OP_LOAD_MATRIXF:
+    memcpy(top, c->f, 16 * sizeof(float));
+    break;
+  case GL_OP_MULT_MATRIXF:
+    ref_mult(c->f);
+    break;
+  case GL_OP_TRANSLATEF: {
+    float m[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, c->f[0], c->f[1], c->f[2], 1};
+    ref_mult(m);
+    break;
+  }
+  case GL_OP_ORTHOF: {
+    const float *o = c->f; // left, right, bottom, top, near, far
+    float m[16] = {
+      2.0f / (o[1] - o[0]), 0, 0, 0,
+      0, 2.0f / (o[3] - o[2]), 0, 0,
+      0, 0, -2.0f / (o[5] - o[4]), 0,
+      -(o[1] + o[0]) / (o[1] - o[0]), -(o[3] + o[2]) / (o[3] - o[2]), -(o[5] + o[4]) / (o[5] - o[4]), 1
+    };
+    ref_mult(m);
+    break;
+  }
+  case GL_OP_PUSH_MATRIX:
+    if (ref.depth[ref.mode] < MATRIX_STACK_DEPTH - 1) {
+      memcpy(ref.m[ref.mode][ref.depth[ref.mode] + 1], top, 16 * sizeof(float));
+      ref.depth[ref.mode]++;
+    }
+    break;
+  case GL_OP_POP_MATRIX:
+    if (ref.depth[ref.mode])
+      ref.depth[ref.mode]--;
+    break;
+  default:
+    return;
+  }
+  hand_over(ref.m[ref.mode][ref.depth[ref.mode]]);
+}
+
+static void shim_call(const matrix_call *c) {
+  switch (c->op) {
+  case GL_OP_MATRIX_MODE:
+    matrix_stack_mode(c->stack);
+    break;
+  case GL_OP_LOAD_IDENTITY:
+    matrix_stack_load_identity();
+    break;
+  case GL_OP_LOAD_MATRIXF:
+    matrix_stack_load(c->f);
+    break;
+  case GL_OP_MULT_MATRIXF:
+    matrix_stack_mult(c->f);
+    break;
+  case GL_OP_TRANSLATEF:
+    matrix_stack_translate(c->f[0], c->f[1], c->f[2]);
+    break;
+  case GL_OP_ORTHOF:
+    matrix_stack_ortho(c->f[0], c->f[1], c->f[2], c->f[3], c->f[4], c->f[5]);
+    break;
+  case GL_OP_PUSH_MATRIX:
+    matrix_stack_push();
+    break;
+  case GL_OP_POP_MATRIX:
+    matrix_stack_pop();
+    break;
+  default: {
+    uint32_t dirty = matrix_stack_dirty();
+    for (int i = 0; i < MATRIX_STACKS; i++) {
+      if (dirty & (1 << i))
+        hand_over(matrix_stack_top(i));
+    }
+    matrix_stack_clean(dirty);
+    break;
+  }
+  }
+}
+
+static int bench_matrices(reader *r, int repeat) {
+  int num = 0, max = 1024, frames = 0, draws = 0, calls = 0;
+  matrix_call *seq = malloc(max * sizeof(matrix_call));
+  gl_call c;
+  while (r->p < r->end && decode(r, &c)) {
+    matrix_call m = {c.op, 0};
+    switch (c.op) {
+    case GL_OP_FRAME_END:
+      frames++;
+      continue;
+    case GL_OP_MATRIX_MODE:
+      m.stack = c.u[0] == 0x1701 ? MATRIX_PROJECTION : c.u[0] == 0x1702 ? MATRIX_TEXTURE : MATRIX_MODELVIEW;
+      break;
+    case GL_OP_DRAW_ARRAYS:
+    case GL_OP_LIGHTFV:
+      draws++;
+      break;
+    case GL_OP_LOAD_IDENTITY:
+    case GL_OP_LOAD_MATRIXF:
+    case GL_OP_MULT_MATRIXF:
+    case GL_OP_TRANSLATEF:
+    case GL_OP_ORTHOF:
+    case GL_OP_PUSH_MATRIX:
+    case GL_OP_POP_MATRIX:
+      memcpy(m.f, c.f, sizeof(m.f));
+      break;
+    default:
+      continue;
+    }
+    if (c.op != GL_OP_DRAW_ARRAYS && c.op != GL_OP_LIGHTFV)
+      calls++;
+    if (num == max) {
+      max *= 2;
+      seq = realloc(seq, max * sizeof(matrix_call));
+    }
+    seq[num++] = m;
+  }
+  if (!frames) {
+    printf("No complete frame in the stream\n");
+    return 1;
+  }
+
+  // Both start from identity stacks, the way the game finds them at boot
+  for (int s = 0; s < MATRIX_STACKS; s++) {
+    for (int d = 0; d < MATRIX_STACK_DEPTH; d++) {
+      memset(ref.m[s][d], 0, 16 * sizeof(float));
+      ref.m[s][d][0] = ref.m[s][d][5] = ref.m[s][d][10] = ref.m[s][d][15] = 1.0f;
+    }
+  }
+
+  // Agreement at the draws, both walk the sequence once
+  float max_diff = 0.0f;
+  for (int i = 0; i < num; i++) {
+    ref_call(&seq[i]);
+    shim_call(&seq[i]);
+    if (seq[i].op != GL_OP_DRAW_ARRAYS)
+      continue;
+    for (int s = 0; s < MATRIX_STACKS; s++) {
+      const float *a = ref.m[s][ref.depth[s]], *b = matrix_stack_top(s);
+      for (int k = 0; k < 16; k++) {
+        float d = a[k] > b[k] ? a[k] - b[k] : b[k] - a[k];
+        if (d > max_diff)
+          max_diff = d;
+      }
+    }
+  }
+
+  double t0 = now_us();
+  handed_over = 0;
+  for (int p = 0; p < repeat; p++) {
+    for (int i = 0; i < num; i++)
+      ref_call(&seq[i]);
+  }
+  uint32_t ref_handed = handed_over / repeat;
+  double t1 = now_us();
+  handed_over = 0;
+  for (int p = 0; p < repeat; p++) {
+    for (int i = 0; i < num; i++)
+      shim_call(&seq[i]);
+  }
+  uint32_t shim_handed = handed_over / repeat;
+  double t2 = now_us();
+
+  printf("%d frames, per frame: %.1f matrix calls, %.1f draws\n", frames, (double)calls / frames, (double)draws / frames);
+  printf("%-10s %14s %14s %12s\n", "variant", "handed over", "us per frame", "ns per call");
+  printf("%-10s %14.1f %14.2f %12.1f\n", "per call", (double)ref_handed / frames, (t1 - t0) / repeat / frames,
+         calls ? (t1 - t0) * 1000.0 / repeat / calls : 0.0);
+  printf("%-10s %14.1f %14.2f %12.1f\n", "shim", (double)shim_handed / frames, (t2 - t1) / repeat / frames,
+         calls ? (t2 - t1) * 1000.0 / repeat / calls : 0.0);
+  printf("Max difference at draws %g (%s)\n", max_diff,
+#ifdef __ARM_NEON
+         "NEON"
+#else
+         "scalar"
+#endif
+  );
+  free(seq);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  const char *path = NULL;
+  int null_backend = 0, matrices = 0, repeat = 1, summary_only = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--null"))
+      null_backend = 1;
+    else if (!strcmp(argv[i], "--matrices"))
+      matrices = 1;
+    else if (!strcmp(argv[i], "--summary"))
+      summary_only = 1;
+    else if (!strcmp(argv[i], "--repeat") && i + 1 < argc)
+      repeat = atoi(argv[++i]);
+    else
+      path = argv[i];
+  }
+  if (!path || repeat < 1) {
+    printf("Usage: %s <gl_stream.bin> [--null | --matrices] [--repeat n] [--summary]\n", argv[0]);
+    return 1;
+  }
+
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    printf("Could not open %s\n", path);
+    return 1;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *stream = malloc(size);
+  if (fread(stream, 1, size, file) != (size_t)size) {
+    printf("Could not read %s\n", path);
+    return 1;
+  }
+  fclose(file);
+
+  reader r = {stream, stream + size, 0};
+  uint32_t magic = rd_u32(&r), version = rd_u32(&r), width = rd_u32(&r), height = rd_u32(&r);
+  if (r.error || magic != GL_STREAM_MAGIC || version != GL_STREAM_VERSION) {
+    printf("%s is not a version %d GL stream\n", path, GL_STREAM_VERSION);
+    return 1;
+  }
+  const uint8_t *commands = r.p;
+  if (matrices)
+    return bench_matrices(&r, repeat);
+
+  int num_frames = 0, max_frames = 64;
+  frame_stats *frames = calloc(max_frames, sizeof(frame_stats));
+  op_stats ops[GL_OP_COUNT];
+
+  // Every pass replays the whole stream from a blank state, times are averaged over them
+  for (int pass = 0; pass < repeat; pass++) {
+    shadow_state state;
+    memset(&state, 0, sizeof(state));
+    memset(ops, 0, sizeof(ops));
+    r.p = commands;
+    r.error = 0;
+
+    int frame = 0;
+    frame_stats cur;
+    memset(&cur, 0, sizeof(cur));
+    double start = now_us();
+    gl_call c;
+    while (r.p < r.end && decode(&r, &c)) {
+      if (c.op == GL_OP_FRAME_END) {
+        if (frame >= max_frames) {
+          max_frames *= 2;
+          frames = realloc(frames, max_frames * sizeof(frame_stats));
+          memset(&frames[frame], 0, (max_frames - frame) * sizeof(frame_stats));
+        }
+        double end = now_us();
+        cur.frame_us = c.u[0];
+        cur.replay_us = frames[frame].replay_us + (end - start);
+        frames[frame++] = cur;
+        memset(&cur, 0, sizeof(cur));
+        start = now_us();
+        continue;
+      }
+
+      account_call(&c, &cur);
+      ops[c.op].calls++;
+      if (!null_backend && count_call(&state, &c)) {
+        cur.redundant++;
+        ops[c.op].redundant++;
+      }
+    }
+    if (r.error) {
+      printf("Truncated stream after %d frames\n", frame);
+      if (!frame)
+        return 1;
+    }
+    num_frames = frame;
+  }
+
+  printf("%s: %ux%u, %d frames, %s backend\n", path, width, height, num_frames, null_backend ? "null" : "counting");
+  frame_stats total;
+  memset(&total, 0, sizeof(total));
+  if (!summary_only)
+    printf("%6s %7s %6s %8s %9s %10s %10s %10s %10s\n", "frame", "calls", "draws", "vertices", "redundant", "array KB", "tex KB", "replay us", "device us");
+  for (int i = 0; i < num_frames; i++) {
+    frame_stats *f = &frames[i];
+    f->replay_us /= repeat;
+    if (!summary_only)
+      printf("%6d %7u %6u %8u %9u %10.1f %10.1f %10.1f %10u\n", i, f->calls, f->draws, f->vertices, f->redundant,
+             f->array_bytes / 1024.0, f->texture_bytes / 1024.0, f->replay_us, f->frame_us);
+    total.calls += f->calls;
+    total.draws += f->draws;
+    total.vertices += f->vertices;
+    total.redundant += f->redundant;
+    total.array_bytes += f->array_bytes;
+    total.texture_bytes += f->texture_bytes;
+    total.replay_us += f->replay_us;
+    total.frame_us += f->frame_us;
+  }
+  if (!num_frames)
+    return 0;
+
+  printf("\nPer frame: %.1f calls, %.1f draws, %.1f vertices, %.1f redundant (%.1f%%), %.1f KB arrays, %.1f KB textures\n",
+         (double)total.calls / num_frames, (double)total.draws / num_frames, (double)total.vertices / num_frames,
+         (double)total.redundant / num_frames, total.calls ? 100.0 * total.redundant / total.calls : 0.0,
+         total.array_bytes / 1024.0 / num_frames, total.texture_bytes / 1024.0 / num_frames);
+  printf("Replay %.1f us (%.3f us per call), device frame %.1f us\n\n", total.replay_us / num_frames,
+         total.calls ? total.replay_us / total.calls : 0.0, (double)total.frame_us / num_frames);
+
+  printf("%-22s %10s %10s %10s\n", "call", "per frame", "redundant", "share");
+  for (int i = 1; i < GL_OP_COUNT; i++) {
+    if (!ops[i].calls)
+      continue;
+    printf("%-22s %10.1f %9.1f%% %9.1f%%\n", op_names[i], (double)ops[i].calls / num_frames,
+           100.0 * ops[i].redundant / ops[i].calls, 100.0 * ops[i].calls / total.calls);
+  }
+
+  free(frames);
+  free(stream);
+  return 0;
+}
@@ -0,0 +1,110 @@
+/* glyph_bench.c -- host side drawFont() expansion microbenchmark
+ *
+ * Rasterizes a range of code points at several sizes and times the old
+ * whole-square scalar RGBA expansion against glyph_expand(), checking that
+ * both produce the same texture. Build it for ARM to measure the NEON path.
+ *
+ * Usage: glyph_bench <font.ttf> [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "glyph_cache.h"
+
+#define FIRST_CODEPOINT 0x21
+#define NUM_CODEPOINTS 94
+
+static const int sizes[] = {16, 24, 32, 48, 64};
+
+static void expand_reference(const glyph_entry *g, int size, uint32_t *dst) {
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      int gx = x - g->x, gy = y - g->y;
+      uint8_t c = (gx >= 0 && gx < g->w && gy >= 0 && gy < g->h) ? g->coverage[gy * g->w + gx] : 0;
+      dst[y * size + x] = (c << 24) | (c << 16) | (c << 8) | c;
+    }
+  }
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    printf("Usage: %s <font.ttf> [iterations]\n", argv[0]);
+    return 1;
+  }
+  int iterations = argc > 2 ? atoi(argv[2]) : 200;
+
+  FILE *f = fopen(argv[1], "rb");
+  if (!f) {
+    printf("Could not open %s\n", argv[1]);
+    return 1;
+  }
+  fseek(f, 0, SEEK_END);
+  long font_size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  unsigned char *font = malloc(font_size);
+  fread(font, font_size, 1, f);
+  fclose(f);
+
+  stbtt_fontinfo info;
+  if (!stbtt_InitFont(&info, font, 0)) {
+    printf("Invalid font %s\n", argv[1]);
+    return 1;
+  }
+
+  for (int s = 0; s < sizeof(sizes) / sizeof(*sizes); s++) {
+    int size = sizes[s];
+    glyph_entry *glyphs[NUM_CODEPOINTS];
+    for (int i = 0; i < NUM_CODEPOINTS; i++) {
+      glyph_entry m;
+      glyph_measure(&info, FIRST_CODEPOINT + i, size, &m);
+      glyphs[i] = malloc(sizeof(glyph_entry) + m.w * m.h);
+      *glyphs[i] = m;
+      glyph_render(&info, glyphs[i], glyphs[i]->coverage);
+    }
+
+    uint32_t *ref = malloc(size * size * sizeof(uint32_t));
+    uint32_t *out = malloc(size * size * sizeof(uint32_t));
+    for (int i = 0; i < NUM_CODEPOINTS; i++) {
+      expand_reference(glyphs[i], size, ref);
+      memset(out, 0xAA, size * size * sizeof(uint32_t));
+      glyph_expand(glyphs[i], size, out);
+      if (memcmp(ref, out, size * size * sizeof(uint32_t))) {
+        printf("Mismatch for U+%04X at size %d\n", FIRST_CODEPOINT + i, size);
+        return 1;
+      }
+    }
+
+    double t0 = now();
+    for (int n = 0; n < iterations; n++) {
+      for (int i = 0; i < NUM_CODEPOINTS; i++)
+        expand_reference(glyphs[i], size, ref);
+    }
+    double t1 = now();
+    for (int n = 0; n < iterations; n++) {
+      for (int i = 0; i < NUM_CODEPOINTS; i++)
+        glyph_expand(glyphs[i], size, out);
+    }
+    double t2 = now();
+
+    double per_ref = (t1 - t0) * 1e9 / (iterations * NUM_CODEPOINTS);
+    double per_new = (t2 - t1) * 1e9 / (iterations * NUM_CODEPOINTS);
+    printf("size %2d: scalar %8.0f ns/glyph, glyph_expand %8.0f ns/glyph (%.1fx)\n",
+           size, per_ref, per_new, per_ref / per_new);
+
+    for (int i = 0; i < NUM_CODEPOINTS; i++)
+      free(glyphs[i]);
+    free(ref);
+    free(out);
+  }
+
+  return 0;
+}
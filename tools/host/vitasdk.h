@@ -0,0 +1,16 @@
+/* vitasdk.h -- the few kernel calls host builds of loader sources need
+ *
+ * Tools compiling loader files using them provide their own definitions,
+ * usually backed by a simulated clock.
+ */
+
+#ifndef __HOST_VITASDK_H__
+#define __HOST_VITASDK_H__
+
+#include <stdint.h>
+
+uint64_t sceKernelGetProcessTimeWide(void);
+int sceKernelDelayThread(uint32_t delay);
+int sceDisplayWaitVblankStart(void);
+
+#endif
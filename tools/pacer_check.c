@@ -0,0 +1,77 @@
+/* pacer_check.c -- checks of loader/frame_pacer.c against a simulated clock
+ *
+ * The kernel calls are replaced by a clock only advancing when the pacer
+ * sleeps or the fake game spends time on a frame, so hours of process time
+ * run instantly. Each check switches the rate the way setFPS() does when
+ * battles start and end, and fails if a frame waits more than one frame at
+ * the new rate or the frame numbers stop following it.
+ *
+ * Exits with a non zero status if any check fails.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "frame_pacer.h"
+
+static uint64_t clock_us;
+
+uint64_t sceKernelGetProcessTimeWide(void) {
+  return clock_us;
+}
+
+int sceKernelDelayThread(uint32_t delay) {
+  clock_us += (uint64_t)delay + 50; // wake ups are always a bit late
+  return 0;
+}
+
+int sceDisplayWaitVblankStart(void) {
+  clock_us += 16667 - clock_us % 16667;
+  return 0;
+}
+
+// Runs frames taking work_us each at the current rate, returns the longest wait seen
+static uint64_t run(int frames, uint32_t work_us, uint64_t *frame) {
+  uint64_t longest = 0;
+  for (int i = 0; i < frames; i++) {
+    clock_us += work_us;
+    uint64_t start = clock_us;
+    *frame = frame_pacer_wait();
+    if (clock_us - start > longest)
+      longest = clock_us - start;
+  }
+  return longest;
+}
+
+static int check_switch(uint64_t uptime_us, int from, int to) {
+  uint64_t frame;
+  clock_us = uptime_us;
+  frame_pacer_set_rate(from);
+  run(30, 5000, &frame);
+
+  frame_pacer_set_rate(to);
+  uint64_t longest = run(30, 5000, &frame);
+  uint64_t expected = clock_us * to / 1000000;
+  // One frame period plus the simulated oversleep
+  uint64_t limit = 1000000 / to + 100;
+
+  int ok = longest <= limit && frame >= expected - 1 && frame <= expected + 1;
+  printf("%s: %d -> %d fps after %llu s, longest wait %llu us, frame %llu (clock says %llu)\n",
+         ok ? "ok  " : "FAIL", from, to, (unsigned long long)(uptime_us / 1000000),
+         (unsigned long long)longest, (unsigned long long)frame, (unsigned long long)expected);
+  return ok;
+}
+
+int main(void) {
+  static const uint64_t uptimes[] = { 1000000, 600000000, 36000000000ULL };
+  static const int switches[][2] = { { 30, 15 }, { 15, 30 }, { 30, 60 }, { 60, 30 }, { 30, 20 }, { 20, 30 } };
+  int failed = 0;
+
+  for (int i = 0; i < sizeof(uptimes) / sizeof(*uptimes); i++) {
+    for (int j = 0; j < sizeof(switches) / sizeof(*switches); j++)
+      failed += !check_switch(uptimes[i], switches[j][0], switches[j][1]);
+  }
+
+  printf("%d check(s) failed\n", failed);
+  return failed != 0;
+}
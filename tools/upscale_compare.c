@@ -0,0 +1,280 @@
+/* upscale_compare.c -- quality check of the FSR upscaler against native rendering
+ *
+ * Takes a native resolution screenshot, renders a lower internal resolution
+ * from it with an area filter, then upscales it back with the bilinear
+ * stretch used by dynamic resolution and with the EASU + RCAS passes of
+ * loader/upscale.c, ported here line by line. Reports the PSNR of both
+ * against the native image, and optionally writes the three images as PPM
+ * for side by side inspection.
+ *
+ * The timings are CPU ones, only meant to compare the two upscalers with
+ * each other. Frame times on the device are shown by the loader's HUD.
+ *
+ * Usage: upscale_compare <native.png> [scale percent] [output prefix]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stb_image.h"
+
+#define SHARPNESS_STOPS 0.2f // matches UPSCALE_SHARPNESS_STOPS
+
+typedef struct {
+  float r, g, b;
+} rgb;
+
+typedef struct {
+  int w, h;
+  rgb *px;
+} image;
+
+static image image_alloc(int w, int h) {
+  image img = {w, h, calloc(w * h, sizeof(rgb))};
+  return img;
+}
+
+static rgb fetch(const image *img, int x, int y) {
+  x = x < 0 ? 0 : x >= img->w ? img->w - 1 : x;
+  y = y < 0 ? 0 : y >= img->h ? img->h - 1 : y;
+  return img->px[y * img->w + x];
+}
+
+static float clampf(float v, float lo, float hi) {
+  return v < lo ? lo : v > hi ? hi : v;
+}
+
+static image downsample(const image *src, int w, int h) {
+  image dst = image_alloc(w, h);
+  float sx = (float)src->w / w, sy = (float)src->h / h;
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      int x0 = x * sx, x1 = (x + 1) * sx, y0 = y * sy, y1 = (y + 1) * sy;
+      rgb acc = {0, 0, 0};
+      int n = 0;
+      for (int yy = y0; yy < y1 || yy == y0; yy++) {
+        for (int xx = x0; xx < x1 || xx == x0; xx++, n++) {
+          rgb c = fetch(src, xx, yy);
+          acc.r += c.r;
+          acc.g += c.g;
+          acc.b += c.b;
+        }
+      }
+      dst.px[y * w + x] = (rgb){acc.r / n, acc.g / n, acc.b / n};
+    }
+  }
+  return dst;
+}
+
+static image bilinear(const image *src, int w, int h) {
+  image dst = image_alloc(w, h);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      float px = (x + 0.5f) * src->w / w - 0.5f, py = (y + 0.5f) * src->h / h - 0.5f;
+      int fx = floorf(px), fy = floorf(py);
+      float ax = px - fx, ay = py - fy;
+      rgb a = fetch(src, fx, fy), b = fetch(src, fx + 1, fy), c = fetch(src, fx, fy + 1), d = fetch(src, fx + 1, fy + 1);
+      rgb *o = &dst.px[y * w + x];
+      o->r = (a.r * (1 - ax) + b.r * ax) * (1 - ay) + (c.r * (1 - ax) + d.r * ax) * ay;
+      o->g = (a.g * (1 - ax) + b.g * ax) * (1 - ay) + (c.g * (1 - ax) + d.g * ax) * ay;
+      o->b = (a.b * (1 - ax) + b.b * ax) * (1 - ay) + (c.b * (1 - ax) + d.b * ax) * ay;
+    }
+  }
+  return dst;
+}
+
+static float luma(rgb c) {
+  return c.b * 0.5f + (c.r * 0.5f + c.g);
+}
+
+static void easu_set(float *dir, float *len, float w, float lA, float lB, float lC, float lD, float lE) {
+  float lenX = clampf(fabsf(lD - lB) / fmaxf(fmaxf(fabsf(lD - lC), fabsf(lC - lB)), 1.0f / 65536.0f), 0, 1);
+  float lenY = clampf(fabsf(lE - lA) / fmaxf(fmaxf(fabsf(lE - lC), fabsf(lC - lA)), 1.0f / 65536.0f), 0, 1);
+  dir[0] += (lD - lB) * w;
+  dir[1] += (lE - lA) * w;
+  *len += (lenX * lenX + lenY * lenY) * w;
+}
+
+static void easu_tap(rgb *aC, float *aW, float ox, float oy, const float *dir, const float *len, float lob, float clp, rgb c) {
+  float vx = (ox * dir[0] + oy * dir[1]) * len[0];
+  float vy = (oy * dir[0] - ox * dir[1]) * len[1];
+  float d2 = fminf(vx * vx + vy * vy, clp);
+  float wB = 2.0f / 5.0f * d2 - 1.0f;
+  float wA = lob * d2 - 1.0f;
+  wB *= wB;
+  wA *= wA;
+  wB = 25.0f / 16.0f * wB - (25.0f / 16.0f - 1.0f);
+  float w = wB * wA;
+  aC->r += c.r * w;
+  aC->g += c.g * w;
+  aC->b += c.b * w;
+  *aW += w;
+}
+
+static image easu(const image *src, int w, int h) {
+  static const int taps[12][2] = {
+    {0, -1}, {1, -1}, {-1, 0}, {0, 0}, {1, 0}, {2, 0}, {-1, 1}, {0, 1}, {1, 1}, {2, 1}, {0, 2}, {1, 2}
+  };
+  enum { B, C, E, F, G, H, I, J, K, L, N, O };
+
+  image dst = image_alloc(w, h);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      float ppx = (x + 0.5f) * src->w / w - 0.5f, ppy = (y + 0.5f) * src->h / h - 0.5f;
+      int fx = floorf(ppx), fy = floorf(ppy);
+      ppx -= fx;
+      ppy -= fy;
+
+      rgb t[12];
+      float l[12];
+      for (int i = 0; i < 12; i++) {
+        t[i] = fetch(src, fx + taps[i][0], fy + taps[i][1]);
+        l[i] = luma(t[i]);
+      }
+
+      float dir[2] = {0, 0}, len = 0;
+      easu_set(dir, &len, (1 - ppx) * (1 - ppy), l[B], l[E], l[F], l[G], l[J]);
+      easu_set(dir, &len, ppx * (1 - ppy), l[C], l[F], l[G], l[H], l[K]);
+      easu_set(dir, &len, (1 - ppx) * ppy, l[F], l[I], l[J], l[K], l[N]);
+      easu_set(dir, &len, ppx * ppy, l[G], l[J], l[K], l[L], l[O]);
+
+      float dirR = dir[0] * dir[0] + dir[1] * dir[1];
+      int zro = dirR < 1.0f / 32768.0f;
+      dirR = zro ? 1.0f : 1.0f / sqrtf(dirR);
+      dir[0] = zro ? 1.0f : dir[0];
+      dir[0] *= dirR;
+      dir[1] *= dirR;
+      len = len * 0.5f;
+      len *= len;
+      float stretch = (dir[0] * dir[0] + dir[1] * dir[1]) / fmaxf(fabsf(dir[0]), fabsf(dir[1]));
+      float len2[2] = {1.0f + (stretch - 1.0f) * len, 1.0f - 0.5f * len};
+      float lob = 0.5f + ((1.0f / 4.0f - 0.04f) - 0.5f) * len;
+      float clp = 1.0f / lob;
+
+      rgb aC = {0, 0, 0};
+      float aW = 0;
+      for (int i = 0; i < 12; i++)
+        easu_tap(&aC, &aW, taps[i][0] - ppx, taps[i][1] - ppy, dir, len2, lob, clp, t[i]);
+
+      rgb *o = &dst.px[y * w + x];
+      o->r = clampf(aC.r / aW, fminf(fminf(t[F].r, t[G].r), fminf(t[J].r, t[K].r)), fmaxf(fmaxf(t[F].r, t[G].r), fmaxf(t[J].r, t[K].r)));
+      o->g = clampf(aC.g / aW, fminf(fminf(t[F].g, t[G].g), fminf(t[J].g, t[K].g)), fmaxf(fmaxf(t[F].g, t[G].g), fmaxf(t[J].g, t[K].g)));
+      o->b = clampf(aC.b / aW, fminf(fminf(t[F].b, t[G].b), fminf(t[J].b, t[K].b)), fmaxf(fmaxf(t[F].b, t[G].b), fmaxf(t[J].b, t[K].b)));
+    }
+  }
+  return dst;
+}
+
+static float rcas_hit(float b, float d, float e, float f, float h, float *lobe) {
+  float mn4 = fminf(fminf(b, d), fminf(f, h)), mx4 = fmaxf(fmaxf(b, d), fmaxf(f, h));
+  float hit_min = fminf(mn4, e) / (4.0f * mx4 + 1.0f / 65536.0f);
+  float hit_max = (1.0f - fmaxf(mx4, e)) / (4.0f * mn4 - 4.0f - 1.0f / 65536.0f);
+  float l = fmaxf(-hit_min, hit_max);
+  if (l > *lobe)
+    *lobe = l;
+  return l;
+}
+
+static image rcas(const image *src) {
+  image dst = image_alloc(src->w, src->h);
+  float sharpness = exp2f(-SHARPNESS_STOPS);
+  for (int y = 0; y < src->h; y++) {
+    for (int x = 0; x < src->w; x++) {
+      rgb b = fetch(src, x, y - 1), d = fetch(src, x - 1, y), e = fetch(src, x, y), f = fetch(src, x + 1, y), h = fetch(src, x, y + 1);
+      float lobe = -INFINITY;
+      rcas_hit(b.r, d.r, e.r, f.r, h.r, &lobe);
+      rcas_hit(b.g, d.g, e.g, f.g, h.g, &lobe);
+      rcas_hit(b.b, d.b, e.b, f.b, h.b, &lobe);
+      lobe = fmaxf(-0.1875f, fminf(lobe, 0.0f)) * sharpness;
+      float rcp = 1.0f / (4.0f * lobe + 1.0f);
+      rgb *o = &dst.px[y * src->w + x];
+      o->r = (lobe * (b.r + d.r + f.r + h.r) + e.r) * rcp;
+      o->g = (lobe * (b.g + d.g + f.g + h.g) + e.g) * rcp;
+      o->b = (lobe * (b.b + d.b + f.b + h.b) + e.b) * rcp;
+    }
+  }
+  return dst;
+}
+
+static double psnr(const image *a, const image *b) {
+  double err = 0;
+  for (int i = 0; i < a->w * a->h; i++) {
+    double dr = a->px[i].r - b->px[i].r, dg = a->px[i].g - b->px[i].g, db = a->px[i].b - b->px[i].b;
+    err += dr * dr + dg * dg + db * db;
+  }
+  err /= a->w * a->h * 3.0;
+  return err > 0 ? 10.0 * log10(1.0 / err) : INFINITY;
+}
+
+static void write_ppm(const image *img, const char *prefix, const char *name) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s_%s.ppm", prefix, name);
+  FILE *f = fopen(path, "wb");
+  if (!f)
+    return;
+  fprintf(f, "P6\n%d %d\n255\n", img->w, img->h);
+  for (int i = 0; i < img->w * img->h; i++) {
+    unsigned char c[3] = {
+      clampf(img->px[i].r, 0, 1) * 255.0f + 0.5f,
+      clampf(img->px[i].g, 0, 1) * 255.0f + 0.5f,
+      clampf(img->px[i].b, 0, 1) * 255.0f + 0.5f
+    };
+    fwrite(c, 1, 3, f);
+  }
+  fclose(f);
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    printf("Usage: %s <native.png> [scale percent] [output prefix]\n", argv[0]);
+    return 1;
+  }
+
+  int w, h, n;
+  unsigned char *data = stbi_load(argv[1], &w, &h, &n, 3);
+  if (!data) {
+    printf("Could not load %s\n", argv[1]);
+    return 1;
+  }
+  int scale = argc > 2 ? atoi(argv[2]) : 50;
+  if (scale <= 0 || scale > 100)
+    scale = 50;
+
+  image native = image_alloc(w, h);
+  for (int i = 0; i < w * h; i++)
+    native.px[i] = (rgb){data[i * 3] / 255.0f, data[i * 3 + 1] / 255.0f, data[i * 3 + 2] / 255.0f};
+  stbi_image_free(data);
+
+  image low = downsample(&native, w * scale / 100, h * scale / 100);
+  printf("native %dx%d, internal %dx%d\n", w, h, low.w, low.h);
+
+  double t0 = now_ms();
+  image up_bilinear = bilinear(&low, w, h);
+  double t1 = now_ms();
+  image up_easu = easu(&low, w, h);
+  double t2 = now_ms();
+  image up_fsr = rcas(&up_easu);
+  double t3 = now_ms();
+
+  printf("%-10s %8s %10s\n", "upscaler", "PSNR dB", "CPU ms");
+  printf("%-10s %8.2f %10.2f\n", "bilinear", psnr(&native, &up_bilinear), t1 - t0);
+  printf("%-10s %8.2f %10.2f\n", "easu", psnr(&native, &up_easu), t2 - t1);
+  printf("%-10s %8.2f %10.2f\n", "easu+rcas", psnr(&native, &up_fsr), t3 - t1);
+
+  if (argc > 3) {
+    write_ppm(&native, argv[3], "native");
+    write_ppm(&up_bilinear, argv[3], "bilinear");
+    write_ppm(&up_fsr, argv[3], "fsr");
+  }
+
+  return 0;
+}
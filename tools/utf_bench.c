@@ -0,0 +1,169 @@
+/* utf_bench.c -- host side conformance check and benchmark for utf_conv.c
+ *
+ * Runs a corpus of well-formed and ill-formed sequences (overlongs,
+ * surrogates, truncations, out of range code points, unpaired UTF-16
+ * surrogates, undersized outputs) through the transcoders, then measures
+ * their throughput on ASCII, Latin and Japanese text.
+ *
+ * Usage: utf_bench [megabytes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utf_conv.h"
+
+#define R UTF_REPLACEMENT
+
+typedef struct {
+  const char *name;
+  const char *utf8;
+  int len;
+  uint32_t cps[16];
+  int num;
+} utf8_case;
+
+static const utf8_case utf8_cases[] = {
+  {"ascii", "A", 1, {0x41}, 1},
+  {"2 bytes", "\xC2\xA9", 2, {0xA9}, 1},
+  {"3 bytes", "\xE2\x82\xAC", 3, {0x20AC}, 1},
+  {"4 bytes", "\xF0\x9F\x98\x80", 4, {0x1F600}, 1},
+  {"last code point", "\xF4\x8F\xBF\xBF", 4, {0x10FFFF}, 1},
+  {"above U+10FFFF", "\xF4\x90\x80\x80", 4, {R, R, R, R}, 4},
+  {"overlong 2 bytes", "\xC0\xAF", 2, {R, R}, 2},
+  {"overlong 3 bytes", "\xE0\x80\xAF", 3, {R, R, R}, 3},
+  {"overlong 4 bytes", "\xF0\x80\x80\xAF", 4, {R, R, R, R}, 4},
+  {"surrogate", "\xED\xA0\x80", 3, {R, R, R}, 3},
+  {"truncated at end", "\xE2\x82", 2, {R}, 1},
+  {"truncated 3 bytes", "\xE2\x82\x41", 3, {R, 0x41}, 2},
+  {"truncated 4 bytes", "\xF0\x9F\x98\x41", 4, {R, 0x41}, 2},
+  {"lone continuation", "\x80", 1, {R}, 1},
+  {"invalid bytes", "\xFE\xFF", 2, {R, R}, 2},
+  {"maximal subparts", "\x61\xF1\x80\x80\xE1\x80\xC2\x62\x80\x63\x80\xBF\x64", 13,
+   {0x61, R, R, R, 0x62, R, 0x63, R, R, 0x64}, 10},
+};
+
+typedef struct {
+  const char *name;
+  uint16_t utf16[8];
+  int len;
+  const char *utf8;
+} utf16_case;
+
+static const utf16_case utf16_cases[] = {
+  {"mixed", {0x41, 0x20AC, 0xD83D, 0xDE00}, 4, "A\xE2\x82\xAC\xF0\x9F\x98\x80"},
+  {"lone high surrogate", {0xD800, 0x41}, 2, "\xEF\xBF\xBD" "A"},
+  {"lone low surrogate", {0xDC00}, 1, "\xEF\xBF\xBD"},
+  {"high surrogate at end", {0x41, 0xDBFF}, 2, "A\xEF\xBF\xBD"},
+  {"swapped surrogates", {0xDE00, 0xD83D}, 2, "\xEF\xBF\xBD\xEF\xBF\xBD"},
+};
+
+static int failures = 0;
+
+static void check(int ok, const char *name) {
+  if (!ok) {
+    printf("FAIL: %s\n", name);
+    failures++;
+  }
+}
+
+static void run_conformance(void) {
+  for (int c = 0; c < sizeof(utf8_cases) / sizeof(*utf8_cases); c++) {
+    const utf8_case *t = &utf8_cases[c];
+    int ok = 1, num = 0;
+    for (int i = 0; i < t->len;) {
+      uint32_t cp;
+      i += utf8_decode((const uint8_t *)&t->utf8[i], t->len - i, &cp);
+      if (num >= t->num || cp != t->cps[num])
+        ok = 0;
+      num++;
+    }
+    check(ok && num == t->num, t->name);
+
+    // The same sequence through utf8_to_utf16 and back must agree with the decoder
+    uint16_t u16[32];
+    uint8_t back[64], expected[64];
+    int n = utf8_to_utf16((const uint8_t *)t->utf8, t->len, u16, 32);
+    int m = utf16_to_utf8(u16, n, back, 64);
+    int e = 0;
+    for (int i = 0; i < t->num; i++)
+      e += utf8_encode(t->cps[i], &expected[e]);
+    check(m == e && !memcmp(back, expected, e), t->name);
+  }
+
+  for (int c = 0; c < sizeof(utf16_cases) / sizeof(*utf16_cases); c++) {
+    const utf16_case *t = &utf16_cases[c];
+    uint8_t out[64];
+    int n = utf16_to_utf8(t->utf16, t->len, out, 64);
+    check(n == strlen(t->utf8) && !strcmp((char *)out, t->utf8), t->name);
+  }
+
+  // Output capacity includes the terminator and never splits a code point
+  uint16_t u16[4];
+  check(utf8_to_utf16((const uint8_t *)"\xE2\x82\xAC\xF0\x9F\x98\x80", -1, u16, 3) == 1 && u16[1] == 0, "utf16 capacity");
+  uint8_t u8[8];
+  const uint16_t euro_a[] = {0x20AC, 0x41, 0};
+  check(utf16_to_utf8(euro_a, -1, u8, 4) == 3 && u8[3] == 0, "utf8 capacity");
+  check(utf8_to_utf16((const uint8_t *)"", -1, u16, 4) == 0 && u16[0] == 0, "empty string");
+
+  // Long ASCII runs around a multibyte character exercise the vector path boundaries
+  uint8_t text[80];
+  memset(text, 'a', sizeof(text));
+  memcpy(&text[37], "\xE3\x81\x82", 3);
+  uint16_t wide[80];
+  uint8_t narrow[96];
+  int n = utf8_to_utf16(text, sizeof(text), wide, 80);
+  check(n == 78 && wide[37] == 0x3042 && wide[38] == 'a', "ascii runs to utf16");
+  int m = utf16_to_utf8(wide, n, narrow, sizeof(narrow));
+  check(m == sizeof(text) && !memcmp(narrow, text, m), "ascii runs to utf8");
+}
+
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench(const char *name, const char *unit, int mb) {
+  int unit_len = strlen(unit);
+  int len = mb * 1024 * 1024 / unit_len * unit_len;
+  uint8_t *src = malloc(len + 1);
+  for (int i = 0; i < len; i += unit_len)
+    memcpy(&src[i], unit, unit_len);
+  src[len] = 0;
+
+  uint16_t *wide = malloc((len + 1) * sizeof(uint16_t));
+  uint8_t *narrow = malloc(len + 1);
+
+  double t0 = now();
+  int n = utf8_to_utf16(src, len, wide, len + 1);
+  double t1 = now();
+  int m = utf16_to_utf8(wide, n, narrow, len + 1);
+  double t2 = now();
+
+  check(m == len && !memcmp(src, narrow, len), name);
+  printf("%-8s utf8_to_utf16 %7.1f MB/s, utf16_to_utf8 %7.1f MB/s\n", name, len / (t1 - t0) / 1e6, len / (t2 - t1) / 1e6);
+
+  free(src);
+  free(wide);
+  free(narrow);
+}
+
+int main(int argc, char *argv[]) {
+  int mb = argc > 1 ? atoi(argv[1]) : 16;
+
+  run_conformance();
+  if (failures) {
+    printf("%d conformance failures\n", failures);
+    return 1;
+  }
+  printf("Conformance corpus passed\n");
+
+  bench("ascii", "The quick brown fox jumps over the lazy dog. ", mb);
+  bench("latin", "D\xC3\xA9j\xC3\xA0 vu, \xC3\xBC" "ber na\xC3\xAFve fa\xC3\xA7" "ade. ", mb);
+  bench("japanese", "\xE3\x83\x95\xE3\x82\xA1\xE3\x82\xA4\xE3\x83\x8A\xE3\x83\xAB\xE3\x83\x95\xE3\x82\xA1\xE3\x83\xB3\xE3\x82\xBF\xE3\x82\xB8\xE3\x83\xBC", mb);
+
+  return failures != 0;
+}